@@ -132,6 +132,9 @@ typedef struct MotionConnUDP
 	struct sockaddr_storage peer;	/* Allow for IPv4 or IPv6 */
 	socklen_t	peer_len;		/* And remember the actual length */
 
+	/* the kernel refused UDP_SEGMENT for this peer, send packets one by one */
+	bool		noGso;
+
 	/* a queue of maximum length Gp_interconnect_queue_depth */
 	int			pkt_q_capacity; /* max capacity of the queue */
 	int			pkt_q_size;		/* number of packets in the queue */
@@ -155,6 +158,28 @@ typedef struct MotionConnTCP
 	uint64		wakeup_ms;
 
 	char		localHostAndPort[128];
+
+	/*
+	 * shm interconnect only: shared-memory ring carrying the data of a
+	 * same-host connection, NULL if the data goes through the socket.
+	 */
+	struct IcShmRing *shmRing;
+
+	/*
+	 * shm interconnect, sending side: the registration message offered a
+	 * ring, and the receiver's answer has not been read yet.
+	 */
+	bool		shmOffered;
+
+	/*
+	 * tcp interconnect with gp_interconnect_tcp_keep_connections > 0 only:
+	 * eosSent is set once the sender has flushed its end-of-stream, keep
+	 * once the stream has been closed cleanly by the keep handshake, so that
+	 * teardown hands the socket to the connection pool instead of closing
+	 * it.
+	 */
+	bool		eosSent;
+	bool		keep;
 }			MotionConnTCP;
 
 /*
@@ -236,7 +261,8 @@ typedef struct ChunkTransportStateEntryUDP
 #define getMotionConn(pEntry, offset, cconn) \
 	do { \
 		if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_TCP || \
-			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY) { \
+			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY || \
+			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM) { \
 			GetMotionConn(pEntry, MotionConnTCP, offset, cconn) \
 		} else if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_UDPIFC) { \
 			GetMotionConn(pEntry, MotionConnUDP, offset, cconn) \
@@ -250,7 +276,8 @@ typedef struct ChunkTransportStateEntryUDP
 	do { \
 		Assert((pEntry) != NULL);		\
 		if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_TCP || \
-			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY) { \
+			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY || \
+			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM) { \
 			(pEntry)->conns = palloc0((pEntry)->numConns * sizeof(MotionConnTCP)); \
 		} else if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_UDPIFC) { \
 			(pEntry)->conns = palloc0((pEntry)->numConns * sizeof(MotionConnUDP)); \
@@ -284,7 +311,8 @@ typedef struct ChunkTransportStateEntryUDP
 #define getChunkTransportState(transportState, motNodeID, ppEntry) \
 	do { \
 		if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_TCP || \
-			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY) { \
+			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY || \
+			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM) { \
 			GetChunkTransportState(transportState, ChunkTransportStateEntryTCP,motNodeID, ppEntry) \
 		} else if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_UDPIFC) { \
 			GetChunkTransportState(transportState, ChunkTransportStateEntryUDP,motNodeID, ppEntry) \
@@ -313,7 +341,8 @@ typedef struct ChunkTransportStateEntryUDP
 #define getChunkTransportStateNoValid(transportState, motNodeID, ppEntry) \
 	do { \
 		if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_TCP || \
-			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY) { \
+			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY || \
+			CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM) { \
 			GetChunkTransportStateNoValid(transportState, ChunkTransportStateEntryTCP,motNodeID, ppEntry) \
 		} else if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_UDPIFC) { \
 			GetChunkTransportStateNoValid(transportState, ChunkTransportStateEntryUDP,motNodeID, ppEntry) \
@@ -18,6 +18,9 @@
 #include "ic_common.h"
 #include "tcp/ic_tcp.h"
 #include "udp/ic_udpifc.h"
+#include "shm/ic_shm.h"
+#include "miscadmin.h"
+#include "storage/ipc.h"
 
 #ifdef ENABLE_IC_PROXY
 #include "proxy/ic_proxy_server.h"
@@ -25,6 +28,10 @@
 
 PG_MODULE_MAGIC;
 
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+static void ic_shmem_startup(void);
+
 MotionIPCLayer tcp_ipc_layer = {
     .ic_type = INTERCONNECT_TYPE_TCP,
 
@@ -98,7 +105,42 @@ MotionIPCLayer proxy_ipc_layer = {
 
     .GetMotionConnTupleRemapper = GetMotionConnTupleRemapper,
 };
+/*
+ * TCP for remote peers, shared-memory rings for peers on the same host.
+ * See shm/ic_shm.c.
+ */
+MotionIPCLayer shm_ipc_layer = {
+    .ic_type = INTERCONNECT_TYPE_SHM,
+
+    .GetMaxTupleChunkSize = GetMaxTupleChunkSizeTCP,
+    .GetListenPort = GetListenPortTCP,
+
+    .InitMotionLayerIPC = InitMotionIPCLayerTCP,
+    .CleanUpMotionLayerIPC = CleanUpMotionIPCLayerTCP,
+    .WaitInterconnectQuit = WaitInterconnectQuitTCP,
+    .SetupInterconnect = SetupInterconnectTCP,
+    .TeardownInterconnect = TeardownInterconnectTCP,
+
+    .SendTupleChunkToAMS = SendTupleChunkToAMS,
+    .SendChunk = SendChunkTCP,
+    .SendEOS = SendEOSTCP,
+    .SendStopMessage = SendStopMessageTCP,
 
+    .RecvTupleChunkFromAny = RecvTupleChunkFromAnyTCP,
+    .RecvTupleChunkFrom = RecvTupleChunkFromTCP,
+    .RecvTupleChunk = RecvTupleChunkTCP,
+
+    .DirectPutRxBuffer = NULL,
+
+    .DeregisterReadInterest = DeregisterReadInterestTCP,
+    .GetActiveMotionConns = NULL,
+
+    .GetTransportDirectBuffer = GetTransportDirectBuffer,
+    .PutTransportDirectBuffer = PutTransportDirectBuffer,
+    .IcProxyServiceMain = NULL,
+
+    .GetMotionConnTupleRemapper = GetMotionConnTupleRemapper,
+};
 
 MotionIPCLayer udpifc_ipc_layer = {
     .ic_type = INTERCONNECT_TYPE_UDPIFC,
@@ -137,6 +179,21 @@ MotionIPCLayer udpifc_ipc_layer = {
     .GetMotionConnTupleRemapper = GetMotionConnTupleRemapper,
 };
 
+/*
+ * Runs in the postmaster at startup and when it reinitializes after a
+ * backend crash, when none of its backends has an interconnect set up:
+ * remove the rings of the shm interconnect that crashed backends left.
+ */
+static void
+ic_shmem_startup(void)
+{
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	if (!IsUnderPostmaster)
+		ic_shm_remove_orphaned_rings();
+}
+
 void
 _PG_init(void)
 {
@@ -156,10 +213,15 @@ _PG_init(void)
         case INTERCONNECT_TYPE_PROXY:
             CurrentMotionIPCLayer = &proxy_ipc_layer;
             break;    
+        case INTERCONNECT_TYPE_SHM:
+            CurrentMotionIPCLayer = &shm_ipc_layer;
+            break;
         default:
             ereport(ERROR,
 				(errcode_for_file_access(),
 				 errmsg("could not decide interconnect type")));
     }
-    
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = ic_shmem_startup;
 }
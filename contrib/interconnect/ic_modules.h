@@ -17,6 +17,7 @@
 
 extern MotionIPCLayer tcp_ipc_layer;
 extern MotionIPCLayer proxy_ipc_layer;
+extern MotionIPCLayer shm_ipc_layer;
 extern MotionIPCLayer udpifc_ipc_layer;
 
 extern void _PG_init(void);
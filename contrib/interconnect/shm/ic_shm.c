@@ -0,0 +1,446 @@
+/*-------------------------------------------------------------------------
+ * ic_shm.c
+ *	   Shared-memory rings for same-host connections of the TCP interconnect.
+ *
+ * With gp_interconnect_type=shm, the TCP interconnect still sets up one TCP
+ * connection per sender/receiver pair.  The sender offers a ring in its
+ * registration message, together with the identity of its host.  If the
+ * receiver finds its own identity there, it creates a ring in POSIX shared
+ * memory and answers IC_SHM_REPLY_RING, and the sender attaches to it before
+ * sending its first packet; otherwise it answers IC_SHM_REPLY_SOCKET.  The
+ * tuple data of a ring connection then bypasses the kernel socket buffers,
+ * and the TCP connection is only used to wake up a sleeping peer and to
+ * carry the stop message.
+ *
+ * The primary segments on a host are separate postmasters, so neither the
+ * dynamic shared memory facility nor latches (whose state lives in the
+ * shared memory of one instance) can be used between them.  That's why the
+ * rings are plain shm_open() segments and wakeups go through the control
+ * socket, which the interconnect code already select()s on.
+ *
+ * Portions Copyright (c) 2023, HashData Technology Limited.
+ *
+ *
+ * IDENTIFICATION
+ *	    contrib/interconnect/shm/ic_shm.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "ic_shm.h"
+#include "cdb/cdbvars.h"
+#include "common/hashfn.h"
+#include "lib/stringinfo.h"
+#include "storage/fd.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define IC_SHM_RING_MAGIC	0x49435348	/* "ICSH" */
+
+/* where shm_open() keeps its segments, to look for orphaned rings */
+#define IC_SHM_DIR			"/dev/shm"
+#define IC_SHM_PREFIX		"gpic."
+
+static IcShmRing *ic_shm_ring_map(int32 sessionId, int32 icId,
+								  int32 srcPid, int32 dstPid, bool create);
+
+/*
+ * Identity of this host, as far as sharing shm_open() segments goes.
+ *
+ * Two processes can use a ring only if they see the same shm_open()
+ * namespace, which is the /dev/shm mount, of the same boot of the same
+ * machine.  The pid namespace is part of the identity too, because
+ * ic_shm_remove_orphaned_rings() looks at the pids in the ring names.
+ * Addresses say nothing about that: a NAT or a container makes two hosts
+ * look alike, and a multi-homed host has many of them.
+ */
+uint64
+ic_shm_host_id(void)
+{
+	static uint64 hostId = 0;
+	StringInfoData buf;
+	struct stat st;
+	char		hostname[256];
+	FILE	   *file;
+
+	if (hostId != 0)
+		return hostId;
+
+	initStringInfo(&buf);
+
+	file = fopen("/proc/sys/kernel/random/boot_id", "r");
+	if (file != NULL)
+	{
+		char		bootId[64];
+
+		if (fgets(bootId, sizeof(bootId), file) != NULL)
+			appendStringInfoString(&buf, bootId);
+		fclose(file);
+	}
+
+	if (stat(IC_SHM_DIR, &st) == 0)
+		appendStringInfo(&buf, "%lu.%lu;",
+						 (unsigned long) st.st_dev, (unsigned long) st.st_ino);
+
+	if (stat("/proc/self/ns/pid", &st) == 0)
+		appendStringInfo(&buf, "%lu;", (unsigned long) st.st_ino);
+
+	if (gethostname(hostname, sizeof(hostname)) == 0)
+	{
+		hostname[sizeof(hostname) - 1] = '\0';
+		appendStringInfoString(&buf, hostname);
+	}
+
+	hostId = hash_bytes_extended((const unsigned char *) buf.data, buf.len, 0);
+	if (hostId == 0)
+		hostId = 1;
+	pfree(buf.data);
+
+	return hostId;
+}
+
+/*
+ * Remove the rings that crashed backends have left behind.
+ *
+ * A ring is unlinked by both of its ends as soon as they don't need its
+ * name anymore, but a backend that crashes in between leaves it in
+ * IC_SHM_DIR.  This runs in the postmaster at startup and when it
+ * reinitializes after a crash.  Other postmasters of this host may have
+ * rings in use, so only the rings of this host whose creator (the
+ * receiver, the last pid in the name) is gone are removed.
+ */
+void
+ic_shm_remove_orphaned_rings(void)
+{
+	DIR		   *dir;
+	struct dirent *de;
+	char		prefix[64];
+	int			prefixlen;
+	int			removed = 0;
+
+	prefixlen = snprintf(prefix, sizeof(prefix), IC_SHM_PREFIX "%016" INT64_MODIFIER "x.",
+						 ic_shm_host_id());
+
+	dir = AllocateDir(IC_SHM_DIR);
+	if (dir == NULL)
+		return;
+
+	while ((de = ReadDirExtended(dir, IC_SHM_DIR, LOG)) != NULL)
+	{
+		int32		sessionId;
+		int32		icId;
+		int32		srcPid;
+		int32		dstPid;
+		char		name[MAXPGPATH];
+
+		if (strncmp(de->d_name, prefix, prefixlen) != 0 ||
+			sscanf(de->d_name + prefixlen, "%d.%d.%d.%d",
+				   &sessionId, &icId, &srcPid, &dstPid) != 4)
+			continue;
+
+		if (dstPid <= 0 || kill(dstPid, 0) == 0 || errno != ESRCH)
+			continue;
+
+		snprintf(name, sizeof(name), "/%s", de->d_name);
+		if (shm_unlink(name) == 0)
+			removed++;
+	}
+
+	FreeDir(dir);
+
+	if (removed > 0)
+		ereport(LOG,
+				(errmsg("removed %d orphaned interconnect shared memory rings",
+						removed)));
+}
+
+/*
+ * Create the ring of a connection, on the receiving side.
+ *
+ * Returns NULL if the ring cannot be created, the connection then uses the
+ * socket.
+ */
+IcShmRing *
+ic_shm_ring_create(int32 sessionId, int32 icId, int32 srcPid, int32 dstPid)
+{
+	return ic_shm_ring_map(sessionId, icId, srcPid, dstPid, true);
+}
+
+/*
+ * Attach to the ring created by the receiver, on the sending side.
+ *
+ * The name is unlinked as soon as we have mapped it, so the segment goes
+ * away with the last of the two mappings.
+ */
+IcShmRing *
+ic_shm_ring_attach(int32 sessionId, int32 icId, int32 srcPid, int32 dstPid)
+{
+	IcShmRing  *ring = ic_shm_ring_map(sessionId, icId, srcPid, dstPid, false);
+
+	shm_unlink(ring->name);
+
+	return ring;
+}
+
+static IcShmRing *
+ic_shm_ring_map(int32 sessionId, int32 icId, int32 srcPid, int32 dstPid,
+				bool create)
+{
+	IcShmRing  *ring;
+	IcShmRingHeader *hdr;
+	Size		ringsize;
+	Size		mapsize;
+	void	   *addr;
+	int			fd;
+	int			save_errno;
+
+	ring = palloc0(sizeof(IcShmRing));
+	snprintf(ring->name, sizeof(ring->name),
+			 "/" IC_SHM_PREFIX "%016" INT64_MODIFIER "x.%d.%d.%d.%d",
+			 ic_shm_host_id(), sessionId, icId, srcPid, dstPid);
+
+	if (create)
+	{
+		/* The ring must hold at least two full packets. */
+		ringsize = Max((Size) gp_interconnect_shm_ring_size * 1024,
+					   (Size) Gp_max_packet_size * 2);
+		mapsize = offsetof(IcShmRingHeader, data) + ringsize;
+
+		/*
+		 * An existing ring of that name was left over by a crashed backend
+		 * that had the same pid.  Replacing it is safe, the sender only opens
+		 * the ring once we have answered its registration message.
+		 */
+		fd = shm_open(ring->name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+		if (fd < 0 && errno == EEXIST)
+		{
+			shm_unlink(ring->name);
+			fd = shm_open(ring->name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+		}
+		if (fd < 0)
+		{
+			ereport(LOG,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error creating shared memory ring \"%s\": %m",
+							ring->name)));
+			pfree(ring);
+			return NULL;
+		}
+
+		if (ftruncate(fd, mapsize) != 0)
+		{
+			save_errno = errno;
+			close(fd);
+			shm_unlink(ring->name);
+			errno = save_errno;
+			ereport(LOG,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error resizing shared memory ring \"%s\" to %zu bytes: %m",
+							ring->name, mapsize)));
+			pfree(ring);
+			return NULL;
+		}
+	}
+	else
+	{
+		struct stat st;
+
+		fd = shm_open(ring->name, O_RDWR, 0);
+		if (fd < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error opening shared memory ring \"%s\": %m",
+							ring->name)));
+
+		if (fstat(fd, &st) != 0)
+		{
+			save_errno = errno;
+			close(fd);
+			errno = save_errno;
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error opening shared memory ring \"%s\": %m",
+							ring->name)));
+		}
+		mapsize = st.st_size;
+		ringsize = mapsize - offsetof(IcShmRingHeader, data);
+	}
+
+	addr = mmap(NULL, mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	save_errno = errno;
+	close(fd);
+	if (addr == MAP_FAILED)
+	{
+		errno = save_errno;
+		if (create)
+		{
+			shm_unlink(ring->name);
+			ereport(LOG,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error mapping shared memory ring \"%s\": %m",
+							ring->name)));
+			pfree(ring);
+			return NULL;
+		}
+		ereport(ERROR,
+				(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+				 errmsg("interconnect error mapping shared memory ring \"%s\": %m",
+						ring->name)));
+	}
+
+	hdr = (IcShmRingHeader *) addr;
+	ring->hdr = hdr;
+	ring->mappedSize = mapsize;
+	ring->isOwner = create;
+
+	if (create)
+	{
+		hdr->size = ringsize;
+		pg_atomic_init_u64(&hdr->writePos, 0);
+		pg_atomic_init_u64(&hdr->readPos, 0);
+		pg_atomic_init_u32(&hdr->recvWaiting, 0);
+		pg_atomic_init_u32(&hdr->sendWaiting, 0);
+		pg_atomic_init_u32(&hdr->stopRequested, 0);
+		pg_write_barrier();
+		hdr->magic = IC_SHM_RING_MAGIC;
+	}
+	else if (mapsize <= offsetof(IcShmRingHeader, data) ||
+			 hdr->magic != IC_SHM_RING_MAGIC || hdr->size != ringsize)
+	{
+		munmap(addr, mapsize);
+		ereport(ERROR,
+				(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+				 errmsg("interconnect error: invalid shared memory ring \"%s\"",
+						ring->name)));
+	}
+
+	return ring;
+}
+
+/*
+ * Unmap the ring.  This must not fail, it is called from teardown.
+ */
+void
+ic_shm_ring_detach(IcShmRing *ring)
+{
+	if (ring == NULL)
+		return;
+
+	/*
+	 * Let the sender know that nobody will drain the ring anymore, in case
+	 * we are a receiver that is going away in the middle of the stream.
+	 */
+	ic_shm_ring_request_stop(ring);
+
+	if (ring->isOwner)
+		shm_unlink(ring->name);	/* ENOENT if the sender already did */
+
+	munmap(ring->hdr, ring->mappedSize);
+	pfree(ring);
+}
+
+/*
+ * Append one packet to the ring.
+ *
+ * Returns false, without copying anything, if there is not enough free
+ * space; the caller then has to wait for the receiver.  Packets are never
+ * split across two calls, so that the receiver always sees whole packets.
+ */
+bool
+ic_shm_ring_put(IcShmRing *ring, const uint8 *data, int len)
+{
+	IcShmRingHeader *hdr = ring->hdr;
+	uint64		writePos = pg_atomic_read_u64(&hdr->writePos);
+	uint64		readPos = pg_atomic_read_u64(&hdr->readPos);
+	uint32		offset;
+	uint32		first;
+
+	Assert(len > 0 && len <= hdr->size);
+
+	if (hdr->size - (writePos - readPos) < (uint64) len)
+		return false;
+
+	/* don't overwrite data before the receiver is done reading it */
+	pg_read_barrier();
+
+	offset = writePos % hdr->size;
+	first = Min((uint32) len, hdr->size - offset);
+	memcpy(hdr->data + offset, data, first);
+	if (first < len)
+		memcpy(hdr->data, data + first, len - first);
+
+	/* publish the data before the new position */
+	pg_write_barrier();
+	pg_atomic_write_u64(&hdr->writePos, writePos + len);
+
+	return true;
+}
+
+/*
+ * Returns the length of the next packet in the ring, 0 if it is empty.
+ *
+ * Every packet starts with its total length as a uint32, see flushBuffer()
+ * in ic_tcp.c.
+ */
+int
+ic_shm_ring_next_packet(IcShmRing *ring)
+{
+	IcShmRingHeader *hdr = ring->hdr;
+	uint64		readPos = pg_atomic_read_u64(&hdr->readPos);
+	uint64		writePos = pg_atomic_read_u64(&hdr->writePos);
+	uint32		offset;
+	uint32		first;
+	uint32		len;
+
+	if (writePos == readPos)
+		return 0;
+
+	/* read the data only after having seen the position */
+	pg_read_barrier();
+
+	offset = readPos % hdr->size;
+	first = Min((uint32) sizeof(uint32), hdr->size - offset);
+	memcpy(&len, hdr->data + offset, first);
+	if (first < sizeof(uint32))
+		memcpy(((char *) &len) + first, hdr->data, sizeof(uint32) - first);
+
+	if (len < sizeof(uint32) || len > writePos - readPos)
+		ereport(ERROR,
+				(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+				 errmsg("interconnect error: corrupted shared memory ring \"%s\"",
+						ring->name),
+				 errdetail("packet length %u, " UINT64_FORMAT " bytes available",
+						   len, writePos - readPos)));
+
+	return (int) len;
+}
+
+/*
+ * Consume the next packet, of the length returned by
+ * ic_shm_ring_next_packet(), into dest.
+ */
+void
+ic_shm_ring_get(IcShmRing *ring, uint8 *dest, int len)
+{
+	IcShmRingHeader *hdr = ring->hdr;
+	uint64		readPos = pg_atomic_read_u64(&hdr->readPos);
+	uint32		offset;
+	uint32		first;
+
+	offset = readPos % hdr->size;
+	first = Min((uint32) len, hdr->size - offset);
+	memcpy(dest, hdr->data + offset, first);
+	if (first < len)
+		memcpy(dest + first, hdr->data, len - first);
+
+	/* finish reading before handing the space back to the sender */
+	pg_memory_barrier();
+	pg_atomic_write_u64(&hdr->readPos, readPos + len);
+}
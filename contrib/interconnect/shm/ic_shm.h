@@ -0,0 +1,164 @@
+/*-------------------------------------------------------------------------
+ * ic_shm.h
+ *	  Shared-memory rings for same-host connections of the TCP interconnect.
+ *
+ * Portions Copyright (c) 2023, HashData Technology Limited.
+ *
+ *
+ * IDENTIFICATION
+ *	    contrib/interconnect/shm/ic_shm.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef IC_SHM_H
+#define IC_SHM_H
+
+#include "postgres.h"
+
+#include "port/atomics.h"
+
+/*
+ * Doorbell bytes sent over the TCP connection of a shared-memory route.
+ *
+ * The TCP connection is kept as a control channel: the sender rings the
+ * receiver with IC_SHM_DOORBELL_DATA when it publishes data while the
+ * receiver sleeps, and the receiver rings the sender with
+ * IC_SHM_DOORBELL_SPACE when it frees space while the sender sleeps.  The
+ * receiver still uses 'S' to ask the sender to stop.
+ */
+#define IC_SHM_DOORBELL_DATA	'D'
+#define IC_SHM_DOORBELL_SPACE	'W'
+
+/*
+ * Answer of the receiver to a registration message that offers a ring: it
+ * has created the ring and the sender must attach to it, or the two ends
+ * are not on the same host (or the ring could not be created) and the data
+ * goes through the socket.  It is the first byte the receiver sends.
+ */
+#define IC_SHM_REPLY_RING		'R'
+#define IC_SHM_REPLY_SOCKET		'N'
+
+/*
+ * Header of a ring, at the start of the shared mapping.
+ *
+ * There is exactly one producer (the sending QE) and one consumer (the
+ * receiving QE or QD).  writePos and readPos only ever grow, the offset in
+ * the data area is taken modulo size.  They live on separate cache lines so
+ * that the two sides don't keep stealing each other's line.
+ */
+typedef struct IcShmRingHeader
+{
+	uint32		magic;
+	uint32		size;			/* size of the data area, in bytes */
+
+	char		pad1[PG_CACHE_LINE_SIZE - 2 * sizeof(uint32)];
+
+	pg_atomic_uint64 writePos;	/* advanced by the sender only */
+	pg_atomic_uint32 recvWaiting;	/* receiver is about to sleep */
+	pg_atomic_uint32 stopRequested; /* receiver wants no more data */
+
+	char		pad2[PG_CACHE_LINE_SIZE - sizeof(pg_atomic_uint64) - 2 * sizeof(pg_atomic_uint32)];
+
+	pg_atomic_uint64 readPos;	/* advanced by the receiver only */
+	pg_atomic_uint32 sendWaiting;	/* sender is about to sleep */
+
+	char		pad3[PG_CACHE_LINE_SIZE - sizeof(pg_atomic_uint64) - sizeof(pg_atomic_uint32)];
+
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} IcShmRingHeader;
+
+/*
+ * Process-local handle of a mapped ring.
+ */
+typedef struct IcShmRing
+{
+	IcShmRingHeader *hdr;
+	Size		mappedSize;
+	bool		isOwner;		/* created by us, we must unlink it */
+	char		name[96];
+} IcShmRing;
+
+extern uint64 ic_shm_host_id(void);
+extern void ic_shm_remove_orphaned_rings(void);
+
+extern IcShmRing *ic_shm_ring_create(int32 sessionId, int32 icId,
+									 int32 srcPid, int32 dstPid);
+extern IcShmRing *ic_shm_ring_attach(int32 sessionId, int32 icId,
+									 int32 srcPid, int32 dstPid);
+extern void ic_shm_ring_detach(IcShmRing *ring);
+
+extern bool ic_shm_ring_put(IcShmRing *ring, const uint8 *data, int len);
+extern int	ic_shm_ring_next_packet(IcShmRing *ring);
+extern void ic_shm_ring_get(IcShmRing *ring, uint8 *dest, int len);
+
+/*
+ * Sleep protocol.  Before sleeping on the control socket, a side announces
+ * it with ic_shm_ring_arm_*() and re-checks the ring; the other side checks
+ * the flag after publishing its change and rings the doorbell if it was set.
+ * The full barriers on both sides make sure that at least one of them sees
+ * the other's update.
+ */
+static inline bool
+ic_shm_ring_has_data(IcShmRing *ring)
+{
+	return pg_atomic_read_u64(&ring->hdr->writePos) !=
+		pg_atomic_read_u64(&ring->hdr->readPos);
+}
+
+static inline void
+ic_shm_ring_arm_recv(IcShmRing *ring)
+{
+	pg_atomic_write_u32(&ring->hdr->recvWaiting, 1);
+	pg_memory_barrier();
+}
+
+static inline void
+ic_shm_ring_disarm_recv(IcShmRing *ring)
+{
+	pg_atomic_write_u32(&ring->hdr->recvWaiting, 0);
+}
+
+static inline void
+ic_shm_ring_arm_send(IcShmRing *ring)
+{
+	pg_atomic_write_u32(&ring->hdr->sendWaiting, 1);
+	pg_memory_barrier();
+}
+
+static inline void
+ic_shm_ring_disarm_send(IcShmRing *ring)
+{
+	pg_atomic_write_u32(&ring->hdr->sendWaiting, 0);
+}
+
+/* Returns true if the sender has to ring the receiver's doorbell. */
+static inline bool
+ic_shm_ring_receiver_needs_wakeup(IcShmRing *ring)
+{
+	pg_memory_barrier();
+	return pg_atomic_read_u32(&ring->hdr->recvWaiting) != 0 &&
+		pg_atomic_exchange_u32(&ring->hdr->recvWaiting, 0) != 0;
+}
+
+/* Returns true if the receiver has to ring the sender's doorbell. */
+static inline bool
+ic_shm_ring_sender_needs_wakeup(IcShmRing *ring)
+{
+	pg_memory_barrier();
+	return pg_atomic_read_u32(&ring->hdr->sendWaiting) != 0 &&
+		pg_atomic_exchange_u32(&ring->hdr->sendWaiting, 0) != 0;
+}
+
+static inline void
+ic_shm_ring_request_stop(IcShmRing *ring)
+{
+	pg_atomic_write_u32(&ring->hdr->stopRequested, 1);
+}
+
+static inline bool
+ic_shm_ring_stop_requested(IcShmRing *ring)
+{
+	return pg_atomic_read_u32(&ring->hdr->stopRequested) != 0;
+}
+
+#endif							/* IC_SHM_H */
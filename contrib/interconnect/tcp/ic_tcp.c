@@ -18,6 +18,7 @@
 #include "ic_tcp.h"
 #include "ic_internal.h"
 #include "ic_common.h"
+#include "shm/ic_shm.h"
 #include "common/ip.h"
 #include "nodes/execnodes.h"	/* ExecSlice, SliceTable */
 #include "nodes/pg_list.h"
@@ -26,6 +27,7 @@
 #include "libpq/libpq-be.h"
 #include "postmaster/postmaster.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 
 #include "cdb/cdbselect.h"
 #include "cdb/tupchunklist.h"
@@ -83,6 +85,43 @@ int			TCP_listenerFd;
 /* TCP listen port */
 int32		tcp_listener_port;
 
+/*
+ * Persistent connections.
+ *
+ * With gp_interconnect_tcp_keep_connections > 0, a connection whose stream
+ * ended cleanly is not closed at teardown but kept in keptConns, and the
+ * next statement that connects the same sender process to the same receiver
+ * process sends its registration message over it instead of connecting
+ * again.  Two processes carry at most one stream between them per
+ * statement, so the registration message, which names the slices and the
+ * interconnect instance, delimits the streams and the packet format is
+ * unchanged.
+ *
+ * A stream ends cleanly when the receiver has read the sender's
+ * end-of-stream: instead of shutting down its side of the socket, the
+ * receiver answers with STREAM_KEEP_MESSAGE, which the sender waits for in
+ * waitOnOutbound().  Only the sender closes idle connections, the oldest
+ * ones first once it keeps too many; the receiver notices and drops its end
+ * the next time it waits for incoming connections.
+ */
+typedef struct KeptConn
+{
+	int			sockfd;
+	bool		outgoing;
+
+	/* the receiving process of an outgoing connection */
+	int32		contentId;
+	int32		listenerPort;
+	int32		pid;
+
+	char		remoteHostAndPort[128];
+	char		localHostAndPort[128];
+}			KeptConn;
+
+#define STREAM_KEEP_MESSAGE 'K'
+
+static List *keptConns = NIL;
+
 
 static ChunkTransportStateEntry * startOutgoingConnections(ChunkTransportState * transportStates,
 														   ExecSlice * sendSlice,
@@ -102,9 +141,23 @@ static void flushInterconnectListenerBacklog(void);
 
 static void waitOnOutbound(ChunkTransportStateEntry * pEntry);
 
+static bool keepConnectionsEnabled(void);
+static void keepConnection(MotionConn * conn, bool outgoing);
+static bool takeKeptConnection(MotionConn * conn);
+static MotionConn * takeKeptIncomingConnection(KeptConn * kept);
+static void closeKeptConnections(void);
+
 static bool flushBuffer(ChunkTransportState * transportStates,
 						ChunkTransportStateEntry * pEntry, MotionConn * conn, int16 motionId);
 
+static void readPacketShm(MotionConn * conn, IcShmRing * ring,
+						  ChunkTransportState * transportStates);
+static bool flushBufferShm(ChunkTransportState * transportStates,
+						   MotionConn * conn, IcShmRing * ring);
+static bool drainShmDoorbell(MotionConn * conn);
+static void ringShmDoorbell(MotionConn * conn, char doorbell);
+static bool readShmReply(ChunkTransportState * transportStates, MotionConn * conn);
+
 #ifdef AMS_VERBOSE_LOGGING
 static void dumpEntryConnections(int elevel, ChunkTransportStateEntry * pEntry);
 static void print_connection(ChunkTransportState * transportStates, int fd, const char *msg);
@@ -307,6 +360,8 @@ CleanUpMotionIPCLayerTCP(void)
 	if (TCP_listenerFd >= 0)
 		closesocket(TCP_listenerFd);
 
+	closeKeptConnections();
+
 	/* be safe and reset global state variables. */
 	tcp_listener_port = 0;
 	TCP_listenerFd = -1;
@@ -337,6 +392,13 @@ readPacket(MotionConn * conn, ChunkTransportState * transportStates)
 	bool		gotHeader = false,
 				gotPacket = false;
 	mpp_fd_set	rset;
+	MotionConnTCP *tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+
+	if (tcp_conn->shmRing)
+	{
+		readPacketShm(conn, tcp_conn->shmRing, transportStates);
+		return;
+	}
 
 #ifdef AMS_VERBOSE_LOGGING
 	elog(DEBUG5, "readpacket: (fd %d) (max %d) outstanding bytes %d", conn->sockfd, Gp_max_packet_size, conn->recvBytes);
@@ -468,6 +530,134 @@ readPacket(MotionConn * conn, ChunkTransportState * transportStates)
 #endif
 }
 
+/*
+ * readPacketShm
+ *
+ * readPacket() for a connection whose data comes through a shared-memory
+ * ring.  The ring holds whole packets, so we always get exactly one of them
+ * into conn->pBuff; the TCP connection is only watched for the sender's
+ * doorbell and for the sender going away.
+ */
+static void
+readPacketShm(MotionConn * conn, IcShmRing * ring,
+			  ChunkTransportState * transportStates)
+{
+	mpp_fd_set	rset;
+	bool		closed = false;
+	int			retry = 0;
+	int			len;
+	int			n;
+
+	Assert(conn->recvBytes == 0);
+
+	while ((len = ic_shm_ring_next_packet(ring)) == 0)
+	{
+		struct timeval timeout = tval;
+
+		/* see if user canceled and stuff like that */
+		ML_CHECK_FOR_INTERRUPTS(transportStates->teardownActive);
+
+		if (closed)
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error: connection closed prematurely"),
+					 errdetail("from Remote Connection: contentId=%d at %s",
+							   conn->remoteContentId, conn->remoteHostAndPort)));
+
+		/* check for the QD cancel for every 2 seconds */
+		if (retry++ > 4)
+		{
+			retry = 0;
+
+			/* check to see if the dispatcher should cancel */
+			if (Gp_role == GP_ROLE_DISPATCH)
+				checkForCancelFromQD(transportStates);
+		}
+
+		ic_shm_ring_arm_recv(ring);
+		if (ic_shm_ring_has_data(ring))
+			continue;
+
+		MPP_FD_ZERO(&rset);
+		MPP_FD_SET(conn->sockfd, &rset);
+		n = select(conn->sockfd + 1, (fd_set *) &rset, NULL, NULL, &timeout);
+		if (n < 0 && errno != EINTR)
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error reading an incoming packet"),
+					 errdetail("select from seg%d at %s: %m",
+							   conn->remoteContentId,
+							   conn->remoteHostAndPort)));
+
+		if (n > 0)
+			closed = !drainShmDoorbell(conn);
+	}
+	ic_shm_ring_disarm_recv(ring);
+
+	if (len > Gp_max_packet_size)
+		ereport(ERROR,
+				(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+				 errmsg("interconnect error reading an incoming packet"),
+				 errdetail("packet of %d bytes from seg%d at %s exceeds the maximum of %d",
+						   len, conn->remoteContentId,
+						   conn->remoteHostAndPort, Gp_max_packet_size)));
+
+	ic_shm_ring_get(ring, conn->pBuff, len);
+	conn->msgPos = conn->pBuff;
+	conn->msgSize = len;
+	conn->recvBytes = len;
+
+	if (ic_shm_ring_sender_needs_wakeup(ring))
+		ringShmDoorbell(conn, IC_SHM_DOORBELL_SPACE);
+}
+
+/*
+ * drainShmDoorbell
+ *
+ * Consume the doorbell bytes pending on the control socket of a
+ * shared-memory connection.  Returns false if the peer has closed it.
+ */
+static bool
+drainShmDoorbell(MotionConn * conn)
+{
+	char		buf[64];
+	int			n;
+
+	for (;;)
+	{
+		n = recv(conn->sockfd, buf, sizeof(buf), 0);
+		if (n > 0)
+			continue;
+		if (n == 0)
+			return false;
+		if (errno == EINTR)
+			continue;
+		if (errno == EWOULDBLOCK || errno == EAGAIN)
+			return true;
+
+		ereport(ERROR,
+				(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+				 errmsg("interconnect error reading an incoming packet"),
+				 errdetail("read from seg%d at %s: %m",
+						   conn->remoteContentId,
+						   conn->remoteHostAndPort)));
+	}
+}
+
+/*
+ * ringShmDoorbell
+ *
+ * Wake up the peer of a shared-memory connection.  A full socket buffer
+ * means that the peer has plenty of doorbells to find already, and any other
+ * error shows up on the next read, so failures are ignored here.
+ */
+static void
+ringShmDoorbell(MotionConn * conn, char doorbell)
+{
+	while (send(conn->sockfd, &doorbell, 1, 0) < 0 && errno == EINTR)
+		;
+}
+
 static void
 flushIncomingData(int fd)
 {
@@ -484,6 +674,224 @@ flushIncomingData(int fd)
 	} while (bytes > 0);
 }
 
+/*
+ * keepConnectionsEnabled
+ *
+ * Do streams that end cleanly leave their connection open for the next
+ * statement?  See the comments on KeptConn.
+ */
+static bool
+keepConnectionsEnabled(void)
+{
+	return gp_interconnect_tcp_keep_connections > 0 &&
+		CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_TCP;
+}
+
+/*
+ * keepConnection
+ *
+ * Move the socket of a connection whose stream ended cleanly into
+ * keptConns.  Outgoing connections beyond gp_interconnect_tcp_keep_connections
+ * are closed, oldest first.
+ */
+static void
+keepConnection(MotionConn * conn, bool outgoing)
+{
+	MotionConnTCP *tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+	MemoryContext oldContext;
+	KeptConn   *kept;
+	ListCell   *cell;
+	int			noutgoing = 0;
+
+	Assert(conn->sockfd >= 0);
+
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+
+	kept = palloc0(sizeof(KeptConn));
+	kept->sockfd = conn->sockfd;
+	kept->outgoing = outgoing;
+	if (outgoing)
+	{
+		kept->contentId = conn->cdbProc->contentid;
+		kept->listenerPort = conn->cdbProc->listenerPort;
+		kept->pid = conn->cdbProc->pid;
+	}
+	strlcpy(kept->remoteHostAndPort, conn->remoteHostAndPort,
+			sizeof(kept->remoteHostAndPort));
+	strlcpy(kept->localHostAndPort, tcp_conn->localHostAndPort,
+			sizeof(kept->localHostAndPort));
+
+	keptConns = lappend(keptConns, kept);
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (gp_log_interconnect >= GPVARS_VERBOSITY_DEBUG)
+		elog(DEBUG4, "Interconnect keeping %s connection %s sockfd=%d",
+			 outgoing ? "outgoing" : "incoming", conn->remoteHostAndPort,
+			 conn->sockfd);
+
+	conn->sockfd = -1;
+
+	if (!outgoing)
+		return;
+
+	/* the list is in the order the connections were kept */
+	foreach(cell, keptConns)
+	{
+		if (((KeptConn *) lfirst(cell))->outgoing)
+			noutgoing++;
+	}
+	foreach(cell, keptConns)
+	{
+		if (noutgoing <= gp_interconnect_tcp_keep_connections)
+			break;
+
+		kept = (KeptConn *) lfirst(cell);
+		if (!kept->outgoing)
+			continue;
+
+		closesocket(kept->sockfd);
+		pfree(kept);
+		keptConns = foreach_delete_current(keptConns, cell);
+		noutgoing--;
+	}
+}
+
+/*
+ * takeKeptConnection
+ *
+ * Look for a kept connection to the receiving process of an outgoing
+ * MotionConn.  If there is one, and the receiver has not closed it in the
+ * meantime, install its socket in conn and return true.
+ */
+static bool
+takeKeptConnection(MotionConn * conn)
+{
+	CdbProcess *cdbProc = conn->cdbProc;
+	ListCell   *cell;
+
+	foreach(cell, keptConns)
+	{
+		KeptConn   *kept = (KeptConn *) lfirst(cell);
+		char		c;
+		int			n;
+
+		if (!kept->outgoing ||
+			kept->contentId != cdbProc->contentid ||
+			kept->listenerPort != cdbProc->listenerPort ||
+			kept->pid != cdbProc->pid)
+			continue;
+
+		keptConns = foreach_delete_current(keptConns, cell);
+
+		/*
+		 * An idle connection has nothing to read; anything else means that
+		 * the receiver is gone.
+		 */
+		while ((n = recv(kept->sockfd, &c, 1, MSG_PEEK)) < 0 && errno == EINTR)
+			;
+		if (n < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
+		{
+			conn->sockfd = kept->sockfd;
+			pfree(kept);
+			return true;
+		}
+
+		if (gp_log_interconnect >= GPVARS_VERBOSITY_DEBUG)
+			elog(DEBUG4, "Interconnect dropping closed kept connection %s sockfd=%d",
+				 kept->remoteHostAndPort, kept->sockfd);
+
+		closesocket(kept->sockfd);
+		pfree(kept);
+		return false;
+	}
+
+	return false;
+}
+
+/*
+ * takeKeptIncomingConnection
+ *
+ * Called when a kept incoming connection becomes read-ready.  If the sender
+ * has started a new stream on it, return a newly palloc'ed MotionConn ready
+ * for readRegisterMessage(), like acceptIncomingConnection() does.  If the
+ * sender has closed it, close our end and return NULL.  Either way the
+ * connection is no longer kept.
+ */
+static MotionConn *
+takeKeptIncomingConnection(KeptConn * kept)
+{
+	MotionConn *conn;
+	MotionConnTCP *tcp_conn;
+	char		c;
+	int			n;
+
+	Assert(!kept->outgoing);
+
+	keptConns = list_delete_ptr(keptConns, kept);
+
+	while ((n = recv(kept->sockfd, &c, 1, MSG_PEEK)) < 0 && errno == EINTR)
+		;
+	if (n <= 0)
+	{
+		if (gp_log_interconnect >= GPVARS_VERBOSITY_DEBUG)
+			elog(DEBUG4, "Interconnect dropping closed kept connection %s sockfd=%d",
+				 kept->remoteHostAndPort, kept->sockfd);
+
+		closesocket(kept->sockfd);
+		pfree(kept);
+		return NULL;
+	}
+
+	conn = palloc0(sizeof(MotionConnTCP));
+	conn->sockfd = kept->sockfd;
+	conn->pBuff = palloc(Gp_max_packet_size);
+	conn->msgSize = sizeof(RegisterMessage);
+	conn->recvBytes = 0;
+	conn->msgPos = conn->pBuff;
+	conn->tupleCount = 0;
+	conn->stillActive = false;
+	conn->state = mcsRecvRegMsg;
+	conn->remoteContentId = -2;
+	conn->remapper = CreateTupleRemapper();
+
+	tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+
+	strlcpy(conn->remoteHostAndPort, kept->remoteHostAndPort,
+			sizeof(conn->remoteHostAndPort));
+	strlcpy(tcp_conn->localHostAndPort, kept->localHostAndPort,
+			sizeof(tcp_conn->localHostAndPort));
+
+	if (gp_log_interconnect >= GPVARS_VERBOSITY_DEBUG)
+		elog(DEBUG4, "Interconnect got new stream on kept connection "
+			 "from remote=%s to local=%s sockfd=%d",
+			 conn->remoteHostAndPort, tcp_conn->localHostAndPort, conn->sockfd);
+
+	pfree(kept);
+	return conn;
+}
+
+/*
+ * closeKeptConnections
+ *
+ * Close every kept connection.
+ */
+static void
+closeKeptConnections(void)
+{
+	ListCell   *cell;
+
+	foreach(cell, keptConns)
+	{
+		KeptConn   *kept = (KeptConn *) lfirst(cell);
+
+		closesocket(kept->sockfd);
+		pfree(kept);
+	}
+	list_free(keptConns);
+	keptConns = NIL;
+}
+
 /* Function startOutgoingConnections() is used to initially kick-off any outgoing
  * connections for mySlice.
  *
@@ -608,6 +1016,22 @@ setupOutgoingConnection(ChunkTransportState * transportStates, ChunkTransportSta
 		conn->sockfd = -1;
 	}
 
+	/* Start the stream on a connection kept by an earlier statement. */
+	if (keepConnectionsEnabled() && takeKeptConnection(conn))
+	{
+		if (gp_log_interconnect >= GPVARS_VERBOSITY_DEBUG)
+			ereport(DEBUG1, (errmsg("Interconnect reusing connection to seg%d slice%d %s "
+									"pid=%d sockfd=%d",
+									conn->remoteContentId,
+									pEntry->recvSlice->sliceIndex,
+									conn->remoteHostAndPort,
+									conn->cdbProc->pid,
+									conn->sockfd)));
+
+		sendRegisterMessage(transportStates, pEntry, conn);
+		return;
+	}
+
 #ifdef ENABLE_IC_PROXY
 	if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY)
 	{
@@ -845,6 +1269,20 @@ sendRegisterMessage(ChunkTransportState * transportStates, ChunkTransportStateEn
 		regMsg->srcSessionId = gp_session_id;
 		regMsg->srcCommandCount = sliceTbl->ic_instance_id;
 
+		/*
+		 * shm interconnect: offer the receiver to hand it the data through a
+		 * shared-memory ring, if it turns out to be on this host.  Its answer
+		 * is read by readShmReply() before the first packet.
+		 */
+		regMsg->srcShmRing = 0;
+		regMsg->srcHostId = 0;
+		tcp_conn->shmOffered = false;
+		if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM)
+		{
+			regMsg->srcShmRing = 1;
+			regMsg->srcHostId = ic_shm_host_id();
+			tcp_conn->shmOffered = true;
+		}
 
 		conn->state = mcsSendRegMsg;
 		conn->msgPos = conn->pBuff;
@@ -973,6 +1411,8 @@ readRegisterMessage(ChunkTransportState * transportStates,
 	msg.srcPid = regMsg->srcPid;
 	msg.srcSessionId = regMsg->srcSessionId;
 	msg.srcCommandCount = regMsg->srcCommandCount;
+	msg.srcShmRing = regMsg->srcShmRing;
+	msg.srcHostId = regMsg->srcHostId;
 
 	/* Check for valid message format. */
 	if (msg.msgBytes != sizeof(*regMsg))
@@ -1092,6 +1532,38 @@ readRegisterMessage(ChunkTransportState * transportStates,
 	newConn->cdbProc = cdbproc;
 	newConn->remoteContentId = msg.srcContentId;
 
+	/*
+	 * The sender offers a shared-memory ring.  Set it up if the sender is on
+	 * this host, and tell it where the data goes.
+	 */
+	if (msg.srcShmRing)
+	{
+		MotionConnTCP *new_tcp_conn = CONTAINER_OF(newConn, MotionConnTCP, mConn);
+		char		reply = IC_SHM_REPLY_SOCKET;
+
+		if (msg.srcHostId == ic_shm_host_id())
+		{
+			new_tcp_conn->shmRing = ic_shm_ring_create(msg.srcSessionId,
+													   msg.srcCommandCount,
+													   msg.srcPid,
+													   MyProcPid);
+			if (new_tcp_conn->shmRing)
+				reply = IC_SHM_REPLY_RING;
+		}
+
+		while (send(newConn->sockfd, &reply, 1, 0) != 1)
+		{
+			if (errno == EINTR)
+				continue;
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error answering registration message from seg%d at %s",
+							msg.srcContentId, newConn->remoteHostAndPort),
+					 errdetail("write pid=%d sockfd=%d: %m",
+							   msg.srcPid, newConn->sockfd)));
+		}
+	}
+
 	/*
 	 * The caller's MotionConn object is no longer valid.
 	 */
@@ -1314,6 +1786,10 @@ SetupTCPInterconnect(EState *estate)
 	Assert(sliceTable &&
 		   mySlice->sliceIndex == sliceTable->localSlice);
 
+	/* connections kept before gp_interconnect_tcp_keep_connections was reset */
+	if (!keepConnectionsEnabled())
+		closeKeptConnections();
+
 	gp_set_monotonic_begin_time(&startTime);
 
 	/* now we'll do some setup for each of our Receiving Motion Nodes. */
@@ -1463,6 +1939,18 @@ SetupTCPInterconnect(EState *estate)
 
 			MPP_FD_SET(TCP_listenerFd, &rset);
 			highsock = TCP_listenerFd;
+
+			/* A sender may also start its stream on a kept connection. */
+			foreach(cell, keptConns)
+			{
+				KeptConn   *kept = (KeptConn *) lfirst(cell);
+
+				if (kept->outgoing)
+					continue;
+
+				MPP_FD_SET(kept->sockfd, &rset);
+				highsock = Max(highsock, kept->sockfd);
+			}
 		}
 
 		/* Inbound connections awaiting registration message */
@@ -1765,6 +2253,35 @@ SetupTCPInterconnect(EState *estate)
 			}
 		}
 
+		/*
+		 * Streams starting on kept connections, or senders closing them.
+		 * These are ready for ReadRegisterMessage() just like the accepted
+		 * ones below.
+		 */
+		if (keptConns != NIL)
+		{
+			List	   *ready = NIL;
+
+			foreach(cell, keptConns)
+			{
+				KeptConn   *kept = (KeptConn *) lfirst(cell);
+
+				if (!kept->outgoing && MPP_FD_ISSET(kept->sockfd, &rset))
+				{
+					n--;
+					ready = lappend(ready, kept);
+				}
+			}
+
+			foreach(cell, ready)
+			{
+				conn = takeKeptIncomingConnection((KeptConn *) lfirst(cell));
+				if (conn != NULL)
+					interconnect_context->incompleteConns = lappend(interconnect_context->incompleteConns, conn);
+			}
+			list_free(ready);
+		}
+
 		/*
 		 * Someone tickling our listener port?  Accept pending connections.
 		 */
@@ -2059,8 +2576,17 @@ TeardownTCPInterconnect(ChunkTransportState * transportStates, bool hasErrors)
 
 		for (i = 0; i < pEntry->numConns; i++)
 		{
+			MotionConnTCP *tcp_conn;
+
 			getMotionConn(pEntry, i, &conn);
-			if (conn->sockfd >= 0)
+			tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+
+			/*
+			 * A receiver that reads our end-of-stream answers with the keep
+			 * message, so leave the connection open for that.
+			 */
+			if (conn->sockfd >= 0 &&
+				!(keepConnectionsEnabled() && tcp_conn->eosSent && !hasErrors))
 				shutdown(conn->sockfd, SHUT_WR);
 
 			/* free up the tuple remapper */
@@ -2096,15 +2622,28 @@ TeardownTCPInterconnect(ChunkTransportState * transportStates, bool hasErrors)
 		 */
 		for (i = 0; i < pEntry->numConns; i++)
 		{
+			MotionConnTCP *tcp_conn;
+
 			getMotionConn(pEntry, i, &conn);
+			tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
 
 			if (conn->sockfd >= 0)
 			{
-				flushIncomingData(conn->sockfd);
-				shutdown(conn->sockfd, SHUT_WR);
+				/*
+				 * The sender knows that we keep it, see
+				 * DeregisterReadInterestTCP.  After an error, close it anyway:
+				 * the sender finds out the next time it tries to reuse it.
+				 */
+				if (tcp_conn->keep && keepConnectionsEnabled() && !hasErrors)
+					keepConnection(conn, false);
+				else
+				{
+					flushIncomingData(conn->sockfd);
+					shutdown(conn->sockfd, SHUT_WR);
 
-				closesocket(conn->sockfd);
-				conn->sockfd = -1;
+					closesocket(conn->sockfd);
+					conn->sockfd = -1;
+				}
 
 				/* free up the tuple remapper */
 				if (conn->remapper)
@@ -2114,6 +2653,12 @@ TeardownTCPInterconnect(ChunkTransportState * transportStates, bool hasErrors)
 				}
 
 			}
+
+			if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM)
+			{
+				ic_shm_ring_detach(tcp_conn->shmRing);
+				tcp_conn->shmRing = NULL;
+			}
 		}
 		removeChunkTransportState(transportStates, aSlice->sliceIndex);
 		pfree(pEntry->conns);
@@ -2147,12 +2692,27 @@ TeardownTCPInterconnect(ChunkTransportState * transportStates, bool hasErrors)
 
 		for (i = 0; i < pEntry->numConns; i++)
 		{
+			MotionConnTCP *tcp_conn;
+
 			getMotionConn(pEntry, i, &conn);
+			tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
 
 			if (conn->sockfd >= 0)
 			{
-				closesocket(conn->sockfd);
-				conn->sockfd = -1;
+				/* the receiver has answered our end-of-stream with keep */
+				if (tcp_conn->keep && keepConnectionsEnabled())
+					keepConnection(conn, true);
+				else
+				{
+					closesocket(conn->sockfd);
+					conn->sockfd = -1;
+				}
+			}
+
+			if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM)
+			{
+				ic_shm_ring_detach(tcp_conn->shmRing);
+				tcp_conn->shmRing = NULL;
 			}
 		}
 		pEntry = removeChunkTransportState(transportStates, mySlice->sliceIndex);
@@ -2478,6 +3038,20 @@ waitOnOutbound(ChunkTransportStateEntry * pEntry)
 				/* ready to read. */
 				count = recv(conn->sockfd, &buf, sizeof(buf), 0);
 
+				/* shm interconnect: the receiver freed ring space, not done */
+				if (count == 1 && buf == IC_SHM_DOORBELL_SPACE)
+					continue;
+
+				/* the receiver got our end-of-stream and keeps the connection */
+				if (count == 1 && buf == STREAM_KEEP_MESSAGE)
+				{
+					CONTAINER_OF(conn, MotionConnTCP, mConn)->keep = true;
+
+					MPP_FD_CLR(conn->sockfd, &waitset);
+					conn_count--;
+					continue;
+				}
+
 				if (count == 0 || count == 1)	/* done ! */
 				{
 					/* got a stop message */
@@ -2515,6 +3089,7 @@ DeregisterReadInterestTCP(ChunkTransportState * transportStates,
 {
 	ChunkTransportStateEntry *pEntry = NULL;
 	MotionConn *conn = NULL;
+	MotionConnTCP *tcp_conn = NULL;
 
 	if (!transportStates)
 	{
@@ -2526,6 +3101,11 @@ DeregisterReadInterestTCP(ChunkTransportState * transportStates,
 
 	getChunkTransportState(transportStates, motNodeID, &pEntry);
 	getMotionConn(pEntry, srcRoute, &conn);
+	tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+
+	/* the stream has ended already, and the connection is kept */
+	if (tcp_conn->keep)
+		return;
 
 	if (gp_log_interconnect >= GPVARS_VERBOSITY_DEBUG)
 	{
@@ -2546,8 +3126,25 @@ DeregisterReadInterestTCP(ChunkTransportState * transportStates,
 	 * that Teardown should complete, otherwise we deadlock the entire query
 	 * (QEs wait in their Teardown calls, while the QD waits for them to
 	 * finish)
+	 *
+	 * If the whole stream has been read, the sender can instead be told that
+	 * the connection is kept for the next statement.
 	 */
-	shutdown(conn->sockfd, SHUT_WR);
+	if (keepConnectionsEnabled() &&
+		!conn->stopRequested &&
+		conn->recvBytes == 0)
+	{
+		char		m = STREAM_KEEP_MESSAGE;
+		ssize_t		written;
+
+		while ((written = send(conn->sockfd, &m, sizeof(m), 0)) < 0 &&
+			   errno == EINTR)
+			;
+		tcp_conn->keep = (written == sizeof(m));
+	}
+
+	if (!tcp_conn->keep)
+		shutdown(conn->sockfd, SHUT_WR);
 
 	MPP_FD_CLR(conn->sockfd, &pEntry->readSet);
 	return;
@@ -2579,6 +3176,15 @@ SendStopMessageTCP(ChunkTransportState * transportStates, int16 motNodeID)
 		if (conn->sockfd >= 0 &&
 			MPP_FD_ISSET(conn->sockfd, &pEntry->readSet))
 		{
+			MotionConnTCP *tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+
+			/* a sender writing into a ring only looks at the socket when it waits */
+			if (tcp_conn->shmRing)
+				ic_shm_ring_request_stop(tcp_conn->shmRing);
+
+			/* the stream is cut short, the connection cannot be kept */
+			conn->stopRequested = true;
+
 			/* someone is trying to send stuff to us, let's stop 'em */
 			while ((written = send(conn->sockfd, &m, sizeof(m), 0)) < 0)
 			{
@@ -2808,11 +3414,15 @@ RecvTupleChunkFromAnyTCP(ChunkTransportState * transportStates,
 		 */
 		for (i = 0; i < pEntry->entry.numConns; i++)
 		{
+			MotionConnTCP *tcp_conn;
+
 			getMotionConn(&pEntry->entry, i, &conn);
+			tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
 
 			if (conn->sockfd >= 0 &&
 				MPP_FD_ISSET(conn->sockfd, &rset) &&
-				conn->recvBytes != 0)
+				(conn->recvBytes != 0 ||
+				 (tcp_conn->shmRing && ic_shm_ring_has_data(tcp_conn->shmRing))))
 			{
 				/* we have data on this socket, let's short-circuit our select */
 				MPP_FD_ZERO(&rset);
@@ -2824,6 +3434,42 @@ RecvTupleChunkFromAnyTCP(ChunkTransportState * transportStates,
 		if (skipSelect)
 			break;
 
+		/*
+		 * Connections that come through a shared-memory ring signal new data
+		 * with a doorbell on their socket, tell the senders that we are
+		 * about to wait for it.
+		 */
+		if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM)
+		{
+			for (i = 0; i < pEntry->entry.numConns; i++)
+			{
+				MotionConnTCP *tcp_conn;
+
+				getMotionConn(&pEntry->entry, i, &conn);
+				tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+
+				if (tcp_conn->shmRing && conn->sockfd >= 0 &&
+					MPP_FD_ISSET(conn->sockfd, &rset))
+				{
+					ic_shm_ring_arm_recv(tcp_conn->shmRing);
+					if (ic_shm_ring_has_data(tcp_conn->shmRing))
+						skipSelect = true;
+				}
+			}
+			if (skipSelect)
+			{
+				/* raced with a sender, the next round picks its data up */
+				for (i = 0; i < pEntry->entry.numConns; i++)
+				{
+					getMotionConn(&pEntry->entry, i, &conn);
+					if (CONTAINER_OF(conn, MotionConnTCP, mConn)->shmRing)
+						ic_shm_ring_disarm_recv(CONTAINER_OF(conn, MotionConnTCP, mConn)->shmRing);
+				}
+				n = 0;
+				continue;
+			}
+		}
+
 		/*
 		 * Also monitor the events on dispatch fds, eg, errors or sequence
 		 * request from QEs.
@@ -2883,6 +3529,37 @@ RecvTupleChunkFromAnyTCP(ChunkTransportState * transportStates,
 		if (waitFds)
 			pfree(waitFds);
 
+		/*
+		 * A readable socket of a shared-memory connection only means that
+		 * its ring has data if it wasn't just a stale doorbell.  Keep it in
+		 * the set if the sender closed it, so that RecvTupleChunkTCP()
+		 * reports the error.
+		 */
+		if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM)
+		{
+			for (i = 0; i < pEntry->entry.numConns; i++)
+			{
+				MotionConnTCP *tcp_conn;
+
+				getMotionConn(&pEntry->entry, i, &conn);
+				tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+
+				if (tcp_conn->shmRing == NULL || conn->sockfd < 0 ||
+					!MPP_FD_ISSET(conn->sockfd, &pEntry->entry.readSet))
+					continue;
+
+				ic_shm_ring_disarm_recv(tcp_conn->shmRing);
+
+				if (n > 0 && MPP_FD_ISSET(conn->sockfd, &rset) &&
+					drainShmDoorbell(conn) &&
+					!ic_shm_ring_has_data(tcp_conn->shmRing))
+				{
+					MPP_FD_CLR(conn->sockfd, &rset);
+					n--;
+				}
+			}
+		}
+
 #ifdef AMS_VERBOSE_LOGGING
 		elog(DEBUG5, "RecvTupleChunkFromAnyTCP() select() returned %d ready sockets", n);
 #endif
@@ -2978,7 +3655,11 @@ SendEOSTCP(ChunkTransportState * transportStates,
 		getMotionConn(pEntry, i, &conn);
 
 		if (conn->sockfd >= 0 && conn->state == mcsStarted)
-			flushBuffer(transportStates, pEntry, conn, motNodeID);
+		{
+			MotionConnTCP *tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+
+			tcp_conn->eosSent = flushBuffer(transportStates, pEntry, conn, motNodeID);
+		}
 
 #ifdef AMS_VERBOSE_LOGGING
 		elog(DEBUG5, "SendEOSTCP() Leaving");
@@ -2997,6 +3678,7 @@ flushBuffer(ChunkTransportState * transportStates,
 				sent = 0;
 	mpp_fd_set	wset;
 	mpp_fd_set	rset;
+	MotionConnTCP *tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
 
 #ifdef AMS_VERBOSE_LOGGING
 	{
@@ -3008,6 +3690,16 @@ flushBuffer(ChunkTransportState * transportStates,
 	}
 #endif
 
+	/* shm interconnect: find out where the data goes first */
+	if (tcp_conn->shmOffered && !readShmReply(transportStates, conn))
+	{
+		conn->stillActive = false;
+		return false;
+	}
+
+	if (tcp_conn->shmRing)
+		return flushBufferShm(transportStates, conn, tcp_conn->shmRing);
+
 	/* first set header length */
 	*(uint32 *) conn->pBuff = conn->msgSize;
 
@@ -3159,6 +3851,167 @@ flushBuffer(ChunkTransportState * transportStates,
 
 	return true;
 }
+/*
+ * readShmReply
+ *
+ * Read the receiver's answer to the ring offered in our registration
+ * message, and attach to the ring if it has created one.  The answer is the
+ * first byte the receiver sends, it comes right after the receiver has read
+ * the registration message.  Returns false if the receiver went away
+ * instead.
+ */
+static bool
+readShmReply(ChunkTransportState * transportStates, MotionConn * conn)
+{
+	MotionConnTCP *tcp_conn = CONTAINER_OF(conn, MotionConnTCP, mConn);
+	mpp_fd_set	rset;
+	char		reply;
+	int			n;
+
+	for (;;)
+	{
+		struct timeval timeout = tval;
+
+		n = recv(conn->sockfd, &reply, sizeof(reply), 0);
+		if (n == 1)
+			break;
+		if (n == 0)
+			return false;
+		if (errno != EINTR && errno != EWOULDBLOCK && errno != EAGAIN)
+		{
+			if (transportStates->teardownActive)
+				return false;
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error reading the answer to the registration message"),
+					 errdetail("read from seg%d at %s: %m",
+							   conn->remoteContentId,
+							   conn->remoteHostAndPort)));
+		}
+
+		ML_CHECK_FOR_INTERRUPTS(transportStates->teardownActive);
+
+		MPP_FD_ZERO(&rset);
+		MPP_FD_SET(conn->sockfd, &rset);
+		n = select(conn->sockfd + 1, (fd_set *) &rset, NULL, NULL, &timeout);
+		if (n < 0 && errno != EINTR)
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error reading the answer to the registration message"),
+					 errdetail("select from seg%d at %s: %m",
+							   conn->remoteContentId,
+							   conn->remoteHostAndPort)));
+	}
+
+	tcp_conn->shmOffered = false;
+
+	if (reply == IC_SHM_REPLY_RING)
+		tcp_conn->shmRing = ic_shm_ring_attach(gp_session_id,
+											   transportStates->sliceTable->ic_instance_id,
+											   MyProcPid,
+											   conn->cdbProc->pid);
+	else if (reply != IC_SHM_REPLY_SOCKET)
+		return false;
+
+	return true;
+}
+
+/*
+ * flushBufferShm
+ *
+ * flushBuffer() for a connection to a receiver on the same host: append the
+ * packet to the shared-memory ring, waiting for the receiver to make room
+ * if needed.  Returns false if the receiver asked us to stop.
+ */
+static bool
+flushBufferShm(ChunkTransportState * transportStates,
+			   MotionConn * conn, IcShmRing * ring)
+{
+	mpp_fd_set	rset;
+	char		buf;
+	int			n;
+
+	/* first set header length */
+	*(uint32 *) conn->pBuff = conn->msgSize;
+
+	for (;;)
+	{
+		struct timeval timeout = tval;
+
+		if (ic_shm_ring_stop_requested(ring))
+		{
+#ifdef AMS_VERBOSE_LOGGING
+			print_connection(transportStates, conn->sockfd, "stop from");
+#endif
+			conn->stillActive = false;
+			return false;
+		}
+
+		if (ic_shm_ring_put(ring, conn->pBuff, conn->msgSize))
+			break;
+
+		ML_CHECK_FOR_INTERRUPTS(transportStates->teardownActive);
+
+		/* the ring is full, sleep until the receiver rings us */
+		ic_shm_ring_arm_send(ring);
+		if (ic_shm_ring_put(ring, conn->pBuff, conn->msgSize))
+			break;
+
+		MPP_FD_ZERO(&rset);
+		MPP_FD_SET(conn->sockfd, &rset);
+		n = select(conn->sockfd + 1, (fd_set *) &rset, NULL, NULL, &timeout);
+		if (n < 0)
+		{
+			int			select_errno = errno;
+
+			if (select_errno == EINTR)
+				continue;
+
+			/*
+			 * if we got an error in teardown, ignore it: treat it as a stop
+			 * message
+			 */
+			if (transportStates->teardownActive)
+			{
+				conn->stillActive = false;
+				return false;
+			}
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error writing an outgoing packet: %m"),
+					 errdetail("Error during select() call (error: %d), for remote connection: contentId=%d at %s",
+							   select_errno, conn->remoteContentId,
+							   conn->remoteHostAndPort)));
+		}
+		if (n == 0)
+			continue;
+
+		/*
+		 * Anything other than the receiver's doorbell is a stop message, or
+		 * the receiver has torn down the interconnect.
+		 */
+		n = recv(conn->sockfd, &buf, sizeof(buf), 0);
+		if (n < 0 && (errno == EINTR || errno == EWOULDBLOCK || errno == EAGAIN))
+			continue;
+		if (n != 1 || buf != IC_SHM_DOORBELL_SPACE)
+		{
+#ifdef AMS_VERBOSE_LOGGING
+			print_connection(transportStates, conn->sockfd, "stop from");
+#endif
+			conn->stillActive = false;
+			return false;
+		}
+	}
+	ic_shm_ring_disarm_send(ring);
+
+	if (ic_shm_ring_receiver_needs_wakeup(ring))
+		ringShmDoorbell(conn, IC_SHM_DOORBELL_DATA);
+
+	conn->tupleCount = 0;
+	conn->msgSize = PACKET_HEADER_SIZE;
+
+	return true;
+}
 
 /* The Function sendChunk() is used to send a tcItem to a single
  * destination. Tuples often are *very small* we aggregate in our
@@ -49,6 +49,9 @@ typedef struct RegisterMessage
 	int32		srcPid;
 	int32		srcSessionId;
 	int32		srcCommandCount;
+	int32		srcShmRing;		/* shm interconnect: sender offers a
+								 * shared-memory ring, see ic_shm.c */
+	uint64		srcHostId;		/* shm interconnect: ic_shm_host_id() */
 }			RegisterMessage;
 
 extern int	GetMaxTupleChunkSizeTCP(void);
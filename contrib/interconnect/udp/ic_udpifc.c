@@ -34,6 +34,7 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 
 #include "access/transam.h"
 #include "access/xact.h"
@@ -293,6 +294,12 @@ struct ReceiveControlInfo
 	 * concurrent cursor cases.
 	 */
 	DistributedTransactionId lastDXatId;
+
+	/*
+	 * Buffer the background thread receives coalesced datagrams into, NULL
+	 * if UDP_GRO is not enabled on the listener.
+	 */
+	char	   *groBuffer;
 };
 
 /*
@@ -536,6 +543,24 @@ static ICGlobalControlInfo ic_control_info;
 
 #define MAX_SEQS_IN_DISORDER_ACK (4)
 
+/*
+ * UDP segmentation offload, see gp_interconnect_udp_segmentation_offload.
+ *
+ * The sender passes runs of equally sized packets to the kernel in a single
+ * sendmsg() with UDP_SEGMENT, and the kernel (or the NIC) cuts them back into
+ * one datagram per packet.  The receiver enables UDP_GRO on the listener, so
+ * the kernel may hand it several datagrams of a flow in one recvmsg(); they
+ * are split at the segment size it reports.  Every datagram is still a single
+ * interconnect packet on the wire, so the sequence/ack protocol is unchanged.
+ */
+#if defined(__linux__) && defined(UDP_SEGMENT) && defined(UDP_GRO)
+#define IC_UDP_OFFLOAD
+#endif
+
+#define GSO_MAX_SEGMENTS (64)
+#define GSO_MAX_BYTES (65535 - 40 - 8)	/* room for IPv6 and UDP headers */
+#define GRO_BUFFER_SIZE (65536)
+
 /*
  * UnackQueueRing
  *
@@ -743,6 +768,9 @@ static void checkQDConnectionAlive(void);
 
 
 static void *rxThreadFunc(void *arg);
+static int	recvFromListener(icpkthdr *pkt, struct sockaddr_storage *peer, socklen_t *peerlen, int *segment_size);
+static void handleRxPacket(icpkthdr **ppkt, int read_count, struct sockaddr_storage *peer, socklen_t peerlen);
+static void handleCoalescedPackets(icpkthdr **ppkt, int read_count, int segment_size, struct sockaddr_storage *peer, socklen_t peerlen);
 
 static bool handleMismatch(icpkthdr *pkt, struct sockaddr_storage *peer, int peer_len);
 static void handleAckedPacket(MotionConn *ackConn, ICBuffer *buf, uint64 now);
@@ -758,6 +786,7 @@ static inline void addCRC(icpkthdr *pkt);
 static inline bool checkCRC(icpkthdr *pkt);
 static void sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, MotionConn *conn);
 static void sendOnce(ChunkTransportState *transportStates, ChunkTransportStateEntry *pChunkEntry, ICBuffer *buf, MotionConn *conn);
+static void sendBatch(ChunkTransportState *transportStates, ChunkTransportStateEntry *pChunkEntry, ICBuffer **bufs, int nbufs, MotionConn *conn);
 static inline uint64 computeExpirationPeriod(MotionConn *conn, uint32 retry);
 
 static ICBuffer *getSndBuffer(MotionConn *conn);
@@ -1453,6 +1482,19 @@ InitMotionUDPIFC(int *listenerSocketFd, int32 *listenerPort)
 	setupUDPListeningSocket(listenerSocketFd, listenerPort, &txFamily);
 	setupUDPListeningSocket(&ICSenderSocket, &ICSenderPort, &ICSenderFamily);
 
+	rx_control_info.groBuffer = NULL;
+#ifdef IC_UDP_OFFLOAD
+	if (gp_interconnect_udp_segmentation_offload)
+	{
+		int			on = 1;
+
+		if (setsockopt(*listenerSocketFd, IPPROTO_UDP, UDP_GRO, &on, sizeof(on)) == 0)
+			rx_control_info.groBuffer = palloc(GRO_BUFFER_SIZE);
+		else
+			elog(LOG, "could not enable UDP_GRO on the interconnect listener: %m");
+	}
+#endif
+
 	/* Initialize receive control data. */
 	resetMainThreadWaiting(&rx_control_info.mainWaitingState);
 
@@ -1551,6 +1593,9 @@ static inline void CleanupMotionUDPIFC(void)
 	pfree(snd_control_info.ackBuffer);
 	snd_control_info.ackBuffer = NULL;
 
+	/* the buffer for coalesced datagrams goes with the memory context */
+	rx_control_info.groBuffer = NULL;
+
 	MemoryContextDelete(ic_control_info.memContext);
 
 	if (ICSenderSocket >= 0)
@@ -2733,6 +2778,7 @@ startOutgoingUDPConnections(ChunkTransportState *transportStates,
 			conn->sentSeq = 0;
 			conn->receivedAckSeq = 0;
 			conn->consumedSeq = 0;
+			conn->noGso = false;
 			conn->mConn.pBuff = (uint8 *) conn->curBuff->pkt;
 			conn->mConn.state = mcsSetupOutgoingConnection;
 			conn->route = i++;
@@ -4921,6 +4967,100 @@ xmit_retry:
 	return;
 }
 
+/*
+ * sendBatch
+ * 		Send a run of packets of the same connection with a single sendmsg(),
+ * 		letting the kernel segment it (UDP_SEGMENT).
+ *
+ * All the packets must have the size of the first one, except the last one
+ * which may be shorter.  If the kernel refuses the offload, e.g. because the
+ * segments do not fit in the MTU of the route, we stop using it for this
+ * connection and send the packets one by one.
+ */
+static void
+sendBatch(ChunkTransportState *transportStates, ChunkTransportStateEntry *pChunkEntry,
+		  ICBuffer **bufs, int nbufs, MotionConn *mConn)
+{
+	MotionConnUDP *conn = CONTAINER_OF(mConn, MotionConnUDP, mConn);
+	int			i;
+
+#ifdef IC_UDP_OFFLOAD
+	if (nbufs > 1 && !conn->noGso)
+	{
+		ChunkTransportStateEntryUDP *pEntry;
+		struct msghdr msg;
+		struct iovec iov[GSO_MAX_SEGMENTS];
+		char		control[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr *cmsg;
+		uint16_t	gso_size = bufs[0]->pkt->len;
+		ssize_t		n;
+		int			save_errno;
+
+		pEntry = CONTAINER_OF(pChunkEntry, ChunkTransportStateEntryUDP, entry);
+		Assert(nbufs <= GSO_MAX_SEGMENTS);
+
+		for (i = 0; i < nbufs; i++)
+		{
+			iov[i].iov_base = bufs[i]->pkt;
+			iov[i].iov_len = bufs[i]->pkt->len;
+		}
+
+		memset(&msg, 0, sizeof(msg));
+		memset(control, 0, sizeof(control));
+		msg.msg_name = &conn->peer;
+		msg.msg_namelen = conn->peer_len;
+		msg.msg_iov = iov;
+		msg.msg_iovlen = nbufs;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_UDP;
+		cmsg->cmsg_type = UDP_SEGMENT;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+		memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(uint16_t));
+
+xmit_retry:
+		n = sendmsg(pEntry->txfd, &msg, 0);
+		if (n >= 0)
+			return;
+
+		save_errno = errno;
+
+		if (errno == EINTR)
+			goto xmit_retry;
+
+		if (errno == EAGAIN)	/* no space ? not an error. */
+			return;
+
+		/* see sendOnce() */
+		if (errno == EPERM)
+		{
+			ereport(LOG,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("Interconnect error writing an outgoing packet: %m"),
+					 errdetail("error during sendmsg() for Remote Connection: contentId=%d at %s",
+							   conn->mConn.remoteContentId, conn->mConn.remoteHostAndPort)));
+			return;
+		}
+
+		if (errno != EINVAL && errno != EIO && errno != EMSGSIZE && errno != EOPNOTSUPP)
+			ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+							errmsg("Interconnect error writing an outgoing packet: %m"),
+							errdetail("error during sendmsg() call (error:%d).\n"
+									  "For Remote Connection: contentId=%d at %s",
+									  save_errno, conn->mConn.remoteContentId,
+									  conn->mConn.remoteHostAndPort)));
+
+		elog(DEBUG1, "UDP segmentation offload refused for Remote Connection contentId=%d at %s: %m",
+			 conn->mConn.remoteContentId, conn->mConn.remoteHostAndPort);
+		conn->noGso = true;
+	}
+#endif
+
+	for (i = 0; i < nbufs; i++)
+		sendOnce(transportStates, pChunkEntry, bufs[i], &conn->mConn);
+}
 
 /*
  * handleStopMsgs
@@ -5037,9 +5177,22 @@ sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEnt
 {
 	MotionConnUDP *conn = NULL;
 	MotionConnUDP *buffConn = NULL;
+	ICBuffer   *batch[GSO_MAX_SEGMENTS];
+	int			nbatch = 0;
+	int			batchBytes = 0;
+	bool		useGso = false;
 
 	conn = CONTAINER_OF(mConn, MotionConnUDP, mConn);
 
+#ifdef IC_UDP_OFFLOAD
+	useGso = gp_interconnect_udp_segmentation_offload && !conn->noGso;
+#endif
+#ifdef USE_ASSERT_CHECKING
+	/* fault injection drops single packets, see sendOnce() */
+	if (gp_udpic_dropxmit_percent != 0)
+		useGso = false;
+#endif
+
 	while (conn->capacity > 0 && icBufferListLength(&conn->sndQueue) > 0)
 	{
 		ICBuffer   *buf = NULL;
@@ -5089,7 +5242,29 @@ sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEnt
 		updateStats(TPE_DATA_PKT_SEND, conn, buf->pkt);
 #endif
 
-		sendOnce(transportStates, pEntry, buf, &conn->mConn);
+		if (!useGso)
+			sendOnce(transportStates, pEntry, buf, &conn->mConn);
+		else
+		{
+			/*
+			 * A batch is cut at the size of its first packet, so it can only
+			 * be extended by packets that are not larger, and only while the
+			 * last one is still full-sized.
+			 */
+			if (nbatch > 0 &&
+				(nbatch == GSO_MAX_SEGMENTS ||
+				 batchBytes + buf->pkt->len > GSO_MAX_BYTES ||
+				 buf->pkt->len > batch[0]->pkt->len ||
+				 batch[nbatch - 1]->pkt->len < batch[0]->pkt->len))
+			{
+				sendBatch(transportStates, pEntry, batch, nbatch, &conn->mConn);
+				nbatch = 0;
+				batchBytes = 0;
+			}
+
+			batch[nbatch++] = buf;
+			batchBytes += buf->pkt->len;
+		}
 		ic_statistics.sndPktNum++;
 
 #ifdef AMS_VERBOSE_LOGGING
@@ -5098,6 +5273,9 @@ sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEnt
 		buffConn = CONTAINER_OF(buf->conn, MotionConnUDP, mConn);
 		buffConn->sentSeq = buf->pkt->seq;
 	}
+
+	if (nbatch > 0)
+		sendBatch(transportStates, pEntry, batch, nbatch, &conn->mConn);
 }
 
 /*
@@ -6474,6 +6652,239 @@ handleDataPacket(MotionConn *mConn, icpkthdr *pkt, struct sockaddr_storage *peer
 	return true;
 }
 
+/*
+ * recvFromListener
+ * 		Called by rx thread to read from the listener.
+ *
+ * Returns what recvfrom() would.  Normally the packet is read into pkt and
+ * *segment_size is set to 0.  If UDP_GRO is enabled and the kernel has
+ * coalesced several datagrams, they are left in rx_control_info.groBuffer
+ * instead, and *segment_size is set to their size; see
+ * handleCoalescedPackets().
+ */
+static int
+recvFromListener(icpkthdr *pkt, struct sockaddr_storage *peer, socklen_t *peerlen,
+				 int *segment_size)
+{
+#ifdef IC_UDP_OFFLOAD
+	if (rx_control_info.groBuffer != NULL)
+	{
+		struct msghdr msg;
+		struct iovec iov[2];
+		struct cmsghdr *cmsg;
+		char		control[CMSG_SPACE(sizeof(int))];
+		int			n;
+
+		/*
+		 * Most reads are a single datagram, so read into pkt first, the same
+		 * as recvfrom() below, and let only what does not fit spill over to
+		 * the rest of groBuffer.
+		 */
+		iov[0].iov_base = (char *) pkt;
+		iov[0].iov_len = Gp_max_packet_size;
+		iov[1].iov_base = rx_control_info.groBuffer + Gp_max_packet_size;
+		iov[1].iov_len = GRO_BUFFER_SIZE - Gp_max_packet_size;
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = peer;
+		msg.msg_namelen = *peerlen;
+		msg.msg_iov = iov;
+		msg.msg_iovlen = 2;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		n = recvmsg(UDP_listenerFd, &msg, 0);
+		if (n < 0)
+			return n;
+
+		*peerlen = msg.msg_namelen;
+
+		/* a datagram that was not coalesced comes without the cmsg */
+		*segment_size = 0;
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+				memcpy(segment_size, CMSG_DATA(cmsg), sizeof(int));
+		}
+		if (*segment_size <= 0 || *segment_size >= n)
+		{
+			*segment_size = 0;
+
+			/*
+			 * recvfrom() would have truncated it to the size of pkt, drop it
+			 * here instead: the rest is not in pkt.
+			 */
+			if (n > Gp_max_packet_size)
+			{
+				if (DEBUG1 >= log_min_messages)
+					write_log("Interconnect error: datagram too long (%d bytes)", n);
+				return 0;
+			}
+			return n;
+		}
+
+		/* make the coalesced datagrams contiguous in groBuffer */
+		memcpy(rx_control_info.groBuffer, pkt, Min(n, Gp_max_packet_size));
+
+		return n;
+	}
+#endif
+
+	*segment_size = 0;
+	return recvfrom(UDP_listenerFd, (char *) pkt, Gp_max_packet_size, 0,
+					(struct sockaddr *) peer, peerlen);
+}
+
+/*
+ * handleCoalescedPackets
+ * 		Called by rx thread to split what recvFromListener() has read into
+ * 		rx_control_info.groBuffer and handle the packets one by one.
+ *
+ * All the datagrams are segment_size bytes long, except maybe the last one.
+ */
+static void
+handleCoalescedPackets(icpkthdr **ppkt, int read_count, int segment_size,
+					   struct sockaddr_storage *peer, socklen_t peerlen)
+{
+	int			offset;
+
+	for (offset = 0; offset < read_count; offset += segment_size)
+	{
+		int			len = Min(segment_size, read_count - offset);
+
+		if (len < sizeof(icpkthdr) || len > Gp_max_packet_size)
+		{
+			if (DEBUG1 >= log_min_messages)
+				write_log("Interconnect error: bad coalesced datagram (%d of %d bytes)", len, read_count);
+			continue;
+		}
+
+		if (*ppkt == NULL)
+		{
+			pthread_mutex_lock(&ic_control_info.lock);
+			*ppkt = getRxBuffer(&rx_buffer_pool);
+			pthread_mutex_unlock(&ic_control_info.lock);
+
+			/* as in rxThreadFunc(); the senders resend the rest */
+			if (*ppkt == NULL)
+			{
+				setRxThreadError(ENOMEM);
+				return;
+			}
+		}
+
+		memcpy(*ppkt, rx_control_info.groBuffer + offset, len);
+		handleRxPacket(ppkt, len, peer, peerlen);
+	}
+}
+
+/*
+ * handleRxPacket
+ * 		Called by rx thread to handle a packet read from the listener.
+ *
+ * If the packet is kept (queued on its connection), *ppkt is set to NULL,
+ * otherwise the caller can reuse the buffer.
+ */
+static void
+handleRxPacket(icpkthdr **ppkt, int read_count, struct sockaddr_storage *peer,
+			   socklen_t peerlen)
+{
+	icpkthdr   *pkt = *ppkt;
+	MotionConn *conn = NULL;
+
+	/* length must be >= 0 */
+	if (pkt->len < 0)
+	{
+		if (DEBUG3 >= log_min_messages)
+			write_log("received inbound with negative length");
+		return;
+	}
+
+	if (pkt->len != read_count)
+	{
+		if (DEBUG3 >= log_min_messages)
+			write_log("received inbound packet [%d], short: read %d bytes, pkt->len %d", pkt->seq, read_count, pkt->len);
+		return;
+	}
+
+	/*
+	 * check the CRC of the payload.
+	 */
+	if (gp_interconnect_full_crc)
+	{
+		if (!checkCRC(pkt))
+		{
+			pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &ic_statistics.crcErrors, 1);
+			if (DEBUG2 >= log_min_messages)
+				write_log("received network data error, dropping bad packet, user data unaffected.");
+			return;
+		}
+	}
+
+#ifdef AMS_VERBOSE_LOGGING
+	logPkt("GOT MESSAGE", pkt);
+#endif
+
+	bool		wakeup_mainthread = false;
+	AckSendParam param;
+
+	memset(&param, 0, sizeof(AckSendParam));
+
+	/*
+	 * Get the connection for the pkt.
+	 *
+	 * The connection hash table should be locked until finishing the
+	 * processing of the packet to avoid the connection
+	 * addition/removal from the hash table during the mean time.
+	 */
+
+	pthread_mutex_lock(&ic_control_info.lock);
+	conn = findConnByHeader(&ic_control_info.connHtab, pkt);
+
+	if (conn != NULL)
+	{
+		/* Handling a regular packet */
+		if (handleDataPacket(conn, pkt, peer, &peerlen, &param, &wakeup_mainthread))
+			*ppkt = NULL;
+		ic_statistics.recvPktNum++;
+	}
+	else
+	{
+		/*
+		 * There may have two kinds of Mismatched packets: a) Past
+		 * packets from previous command after I was torn down b)
+		 * Future packets from current command before my connections
+		 * are built.
+		 *
+		 * The handling logic is to "Ack the past and Nak the future".
+		 */
+		if ((pkt->flags & UDPIC_FLAGS_RECEIVER_TO_SENDER) == 0)
+		{
+			if (DEBUG1 >= log_min_messages)
+				write_log("mismatched packet received, seq %d, srcpid %d, dstpid %d, icid %d, sid %d", pkt->seq, pkt->srcPid, pkt->dstPid, pkt->icId, pkt->sessionId);
+
+#ifdef AMS_VERBOSE_LOGGING
+			logPkt("Got a Mismatched Packet", pkt);
+#endif
+
+			if (handleMismatch(pkt, peer, peerlen))
+				*ppkt = NULL;
+			ic_statistics.mismatchNum++;
+		}
+	}
+	pthread_mutex_unlock(&ic_control_info.lock);
+
+	if (wakeup_mainthread)
+		SetLatch(&ic_control_info.latch);
+
+	/*
+	 * real ack sending is after lock release to decrease the lock
+	 * holding time.
+	 */
+	if (param.msg.len != 0)
+		sendAckWithParam(&param);
+}
+
 /*
  * rxThreadFunc
  * 		Main function of the receive background thread.
@@ -6564,15 +6975,14 @@ rxThreadFunc(void *arg)
 			/* we've got something interesting to read */
 			/* handle incoming */
 			/* ready to read on our socket */
-			MotionConn *conn = NULL;
 			int			read_count = 0;
+			int			segment_size = 0;
 
 			struct sockaddr_storage peer;
 			socklen_t	peerlen;
 
 			peerlen = sizeof(peer);
-			read_count = recvfrom(UDP_listenerFd, (char *) pkt, Gp_max_packet_size, 0,
-								  (struct sockaddr *) &peer, &peerlen);
+			read_count = recvFromListener(pkt, &peer, &peerlen, &segment_size);
 
 			if (pg_atomic_read_u32(&ic_control_info.shutdown) == 1)
 			{
@@ -6620,97 +7030,10 @@ rxThreadFunc(void *arg)
 			 */
 			skip_poll = true;
 
-			/* length must be >= 0 */
-			if (pkt->len < 0)
-			{
-				if (DEBUG3 >= log_min_messages)
-					write_log("received inbound with negative length");
-				continue;
-			}
-
-			if (pkt->len != read_count)
-			{
-				if (DEBUG3 >= log_min_messages)
-					write_log("received inbound packet [%d], short: read %d bytes, pkt->len %d", pkt->seq, read_count, pkt->len);
-				continue;
-			}
-
-			/*
-			 * check the CRC of the payload.
-			 */
-			if (gp_interconnect_full_crc)
-			{
-				if (!checkCRC(pkt))
-				{
-					pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &ic_statistics.crcErrors, 1);
-					if (DEBUG2 >= log_min_messages)
-						write_log("received network data error, dropping bad packet, user data unaffected.");
-					continue;
-				}
-			}
-
-#ifdef AMS_VERBOSE_LOGGING
-			logPkt("GOT MESSAGE", pkt);
-#endif
-
-			bool		wakeup_mainthread = false;
-			AckSendParam param;
-
-			memset(&param, 0, sizeof(AckSendParam));
-
-			/*
-			 * Get the connection for the pkt.
-			 *
-			 * The connection hash table should be locked until finishing the
-			 * processing of the packet to avoid the connection
-			 * addition/removal from the hash table during the mean time.
-			 */
-
-			pthread_mutex_lock(&ic_control_info.lock);
-			conn = findConnByHeader(&ic_control_info.connHtab, pkt);
-
-			if (conn != NULL)
-			{
-				/* Handling a regular packet */
-				if (handleDataPacket(conn, pkt, &peer, &peerlen, &param, &wakeup_mainthread))
-					pkt = NULL;
-				ic_statistics.recvPktNum++;
-			}
+			if (segment_size == 0)
+				handleRxPacket(&pkt, read_count, &peer, peerlen);
 			else
-			{
-				/*
-				 * There may have two kinds of Mismatched packets: a) Past
-				 * packets from previous command after I was torn down b)
-				 * Future packets from current command before my connections
-				 * are built.
-				 *
-				 * The handling logic is to "Ack the past and Nak the future".
-				 */
-				if ((pkt->flags & UDPIC_FLAGS_RECEIVER_TO_SENDER) == 0)
-				{
-					if (DEBUG1 >= log_min_messages)
-						write_log("mismatched packet received, seq %d, srcpid %d, dstpid %d, icid %d, sid %d", pkt->seq, pkt->srcPid, pkt->dstPid, pkt->icId, pkt->sessionId);
-
-#ifdef AMS_VERBOSE_LOGGING
-					logPkt("Got a Mismatched Packet", pkt);
-#endif
-
-					if (handleMismatch(pkt, &peer, peerlen))
-						pkt = NULL;
-					ic_statistics.mismatchNum++;
-				}
-			}
-			pthread_mutex_unlock(&ic_control_info.lock);
-
-			if (wakeup_mainthread)
-				SetLatch(&ic_control_info.latch);
-
-			/*
-			 * real ack sending is after lock release to decrease the lock
-			 * holding time.
-			 */
-			if (param.msg.len != 0)
-				sendAckWithParam(&param);
+				handleCoalescedPackets(&pkt, read_count, segment_size, &peer, peerlen);
 		}
 
 		/* pthread_yield(); */
@@ -0,0 +1,144 @@
+/* contrib/pg_stat_statements/pg_stat_statements--1.9--1.9-gp1.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pg_stat_statements UPDATE TO '1.9-gp1'" to load this file. \quit
+
+/*
+ * Segment-side statistics.
+ *
+ * The query id is dispatched to the QEs as part of the plan, so every
+ * segment that has pg_stat_statements in shared_preload_libraries keeps its
+ * own entries for the slices it executed.  Note that a segment runs one
+ * executor per slice, so "calls" on a segment counts slice executions, not
+ * statements.
+ */
+CREATE FUNCTION pg_stat_statements_segments(
+    OUT gp_segment_id int4,
+    OUT userid oid,
+    OUT dbid oid,
+    OUT toplevel bool,
+    OUT queryid bigint,
+    OUT calls int8,
+    OUT total_exec_time float8,
+    OUT max_exec_time float8,
+    OUT rows int8,
+    OUT shared_blks_hit int8,
+    OUT shared_blks_read int8,
+    OUT shared_blks_dirtied int8,
+    OUT shared_blks_written int8,
+    OUT local_blks_hit int8,
+    OUT local_blks_read int8,
+    OUT temp_blks_read int8,
+    OUT temp_blks_written int8,
+    OUT blk_read_time float8,
+    OUT blk_write_time float8,
+    OUT wal_bytes numeric
+)
+RETURNS SETOF record
+AS $$
+  SELECT gp_execution_segment(), userid, dbid, toplevel, queryid,
+         calls, total_exec_time, max_exec_time, rows,
+         shared_blks_hit, shared_blks_read, shared_blks_dirtied,
+         shared_blks_written, local_blks_hit, local_blks_read,
+         temp_blks_read, temp_blks_written, blk_read_time, blk_write_time,
+         wal_bytes
+    FROM pg_stat_statements(false);
+$$
+LANGUAGE SQL VOLATILE EXECUTE ON ALL SEGMENTS;
+
+CREATE VIEW pg_stat_statements_segments AS
+  SELECT * FROM pg_stat_statements_segments();
+
+GRANT SELECT ON pg_stat_statements_segments TO PUBLIC;
+
+/*
+ * Cluster-wide view: coordinator entries merged with the per-segment totals
+ * of the same normalized statement.  Segment entries are matched regardless
+ * of "toplevel", since a statement nested in a function on the coordinator
+ * is still a top-level executor run on the segments.  The seg_* columns are
+ * summed over all segments; seg_max_exec_time and seg_avg_exec_time are
+ * taken over the per-segment totals, and their ratio is the skew.
+ */
+CREATE VIEW gp_stat_statements AS
+  WITH per_segment AS (
+    SELECT gp_segment_id, userid, dbid, queryid,
+           sum(total_exec_time) AS total_exec_time,
+           sum(rows) AS rows,
+           sum(shared_blks_hit) AS shared_blks_hit,
+           sum(shared_blks_read) AS shared_blks_read,
+           sum(shared_blks_dirtied) AS shared_blks_dirtied,
+           sum(shared_blks_written) AS shared_blks_written,
+           sum(local_blks_hit) AS local_blks_hit,
+           sum(local_blks_read) AS local_blks_read,
+           sum(temp_blks_read) AS temp_blks_read,
+           sum(temp_blks_written) AS temp_blks_written,
+           sum(blk_read_time) AS blk_read_time,
+           sum(blk_write_time) AS blk_write_time,
+           sum(wal_bytes) AS wal_bytes
+      FROM pg_stat_statements_segments()
+     GROUP BY gp_segment_id, userid, dbid, queryid
+  ), cluster AS (
+    SELECT userid, dbid, queryid,
+           count(*) AS segments,
+           sum(total_exec_time) AS seg_total_exec_time,
+           max(total_exec_time) AS seg_max_exec_time,
+           avg(total_exec_time) AS seg_avg_exec_time,
+           sum(rows) AS seg_rows,
+           sum(shared_blks_hit) AS seg_shared_blks_hit,
+           sum(shared_blks_read) AS seg_shared_blks_read,
+           sum(shared_blks_dirtied) AS seg_shared_blks_dirtied,
+           sum(shared_blks_written) AS seg_shared_blks_written,
+           sum(local_blks_hit) AS seg_local_blks_hit,
+           sum(local_blks_read) AS seg_local_blks_read,
+           sum(temp_blks_read) AS seg_temp_blks_read,
+           sum(temp_blks_written) AS seg_temp_blks_written,
+           sum(blk_read_time) AS seg_blk_read_time,
+           sum(blk_write_time) AS seg_blk_write_time,
+           sum(wal_bytes) AS seg_wal_bytes
+      FROM per_segment
+     GROUP BY userid, dbid, queryid
+  )
+  SELECT c.userid, c.dbid, c.toplevel, c.queryid, c.query,
+         c.calls, c.total_exec_time, c.mean_exec_time, c.rows,
+         coalesce(s.segments, 0) AS segments,
+         s.seg_total_exec_time, s.seg_max_exec_time, s.seg_avg_exec_time,
+         CASE WHEN s.seg_avg_exec_time > 0
+              THEN s.seg_max_exec_time / s.seg_avg_exec_time
+         END AS seg_exec_time_skew,
+         s.seg_rows,
+         s.seg_shared_blks_hit, s.seg_shared_blks_read,
+         s.seg_shared_blks_dirtied, s.seg_shared_blks_written,
+         s.seg_local_blks_hit, s.seg_local_blks_read,
+         s.seg_temp_blks_read, s.seg_temp_blks_written,
+         s.seg_blk_read_time, s.seg_blk_write_time, s.seg_wal_bytes
+    FROM pg_stat_statements(true) c
+    LEFT JOIN cluster s
+      ON s.userid = c.userid AND s.dbid = c.dbid AND s.queryid = c.queryid;
+
+GRANT SELECT ON gp_stat_statements TO PUBLIC;
+
+/* Reset the statistics on the coordinator and on all segments */
+CREATE FUNCTION pg_stat_statements_reset_segments(IN userid Oid DEFAULT 0,
+	IN dbid Oid DEFAULT 0,
+	IN queryid bigint DEFAULT 0
+)
+RETURNS SETOF int4
+AS $$
+  SELECT gp_execution_segment() FROM pg_stat_statements_reset($1, $2, $3);
+$$
+LANGUAGE SQL VOLATILE EXECUTE ON ALL SEGMENTS;
+
+CREATE FUNCTION gp_stat_statements_reset(IN userid Oid DEFAULT 0,
+	IN dbid Oid DEFAULT 0,
+	IN queryid bigint DEFAULT 0
+)
+RETURNS void
+AS $$
+  SELECT count(*) FROM pg_stat_statements_reset_segments($1, $2, $3);
+  SELECT pg_stat_statements_reset($1, $2, $3);
+$$
+LANGUAGE SQL VOLATILE EXECUTE ON COORDINATOR;
+
+-- Don't want these to be available to non-superusers.
+REVOKE ALL ON FUNCTION pg_stat_statements_reset_segments(Oid, Oid, bigint) FROM PUBLIC;
+REVOKE ALL ON FUNCTION gp_stat_statements_reset(Oid, Oid, bigint) FROM PUBLIC;
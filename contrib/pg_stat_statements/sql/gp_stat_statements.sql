@@ -0,0 +1,47 @@
+--
+-- Segment-side statistics and the cluster-wide view
+--
+CREATE EXTENSION pg_stat_statements;
+SELECT extversion FROM pg_extension WHERE extname = 'pg_stat_statements';
+
+SET pg_stat_statements.track_utility = FALSE;
+SELECT gp_stat_statements_reset();
+
+CREATE TABLE gpss_t (a int, b int) DISTRIBUTED BY (a);
+INSERT INTO gpss_t SELECT i, i FROM generate_series(1, 100) i;
+
+SELECT count(*) FROM gpss_t;
+SELECT count(*) FROM gpss_t;
+
+-- every segment ran the scan of both executions
+SELECT count(DISTINCT s.gp_segment_id) =
+       (SELECT count(*) FROM gp_segment_configuration
+         WHERE role = 'p' AND content >= 0) AS all_segments,
+       min(s.calls) AS min_calls
+  FROM pg_stat_statements_segments s
+  JOIN pg_stat_statements c USING (queryid)
+ WHERE c.query = 'SELECT count(*) FROM gpss_t';
+
+-- the segment totals are merged into the coordinator entry
+SELECT query, calls, rows,
+       segments = (SELECT count(*) FROM gp_segment_configuration
+                    WHERE role = 'p' AND content >= 0) AS all_segments,
+       seg_total_exec_time >= seg_max_exec_time AS seg_totals
+  FROM gp_stat_statements
+ WHERE query = 'SELECT count(*) FROM gpss_t';
+
+-- statements that run on the coordinator only have no segment counters
+SELECT 'coordinator only' AS t;
+SELECT query, calls, segments, seg_total_exec_time IS NULL AS no_seg_time
+  FROM gp_stat_statements
+ WHERE query = 'SELECT $1 AS t';
+
+-- reset clears the coordinator and the segments
+SELECT queryid AS gpss_queryid FROM pg_stat_statements
+ WHERE query = 'SELECT count(*) FROM gpss_t' \gset
+SELECT gp_stat_statements_reset();
+SELECT count(*) FROM pg_stat_statements WHERE queryid = :gpss_queryid;
+SELECT count(*) FROM pg_stat_statements_segments WHERE queryid = :gpss_queryid;
+
+DROP TABLE gpss_t;
+DROP EXTENSION pg_stat_statements;
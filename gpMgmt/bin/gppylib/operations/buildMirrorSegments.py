@@ -65,7 +65,8 @@ gDatabaseFiles = [
 #   failoverSegment = segment to recover "to"
 # In other words, we are recovering the failedSegment to the failoverSegment using the liveSegment.
 class GpMirrorToBuild:
-    def __init__(self, failedSegment, liveSegment, failoverSegment, forceFullSynchronization):
+    def __init__(self, failedSegment, liveSegment, failoverSegment, forceFullSynchronization,
+                 differentialSynchronization=False):
         checkNotNone("forceFullSynchronization", forceFullSynchronization)
 
         # We need to call this validate function here because addmirrors directly calls GpMirrorToBuild.
@@ -82,6 +83,13 @@ class GpMirrorToBuild:
         """
         self.__forceFullSynchronization = forceFullSynchronization
 
+        """
+        __differentialSynchronization is true if the existing segment directory should be brought up to
+           date by copying only the files and file ranges that differ from the live segment, for when
+           pg_rewind cannot be used but most of the data on the failed segment is still good
+        """
+        self.__differentialSynchronization = differentialSynchronization
+
     def getFailedSegment(self):
         """
         returns the segment that failed. This can be None, for example when adding mirrors
@@ -116,6 +124,14 @@ class GpMirrorToBuild:
 
         return False
 
+    def isDifferentialSynchronization(self):
+        """
+        Returns whether or not this segment to recover will be recovered using differential
+        resynchronization.  This is only possible in place; a new segment location has no data to
+        compare against, so it is always fully resynchronized.
+        """
+        return self.__differentialSynchronization and not self.isFullSynchronization()
+
 
 class GpMirrorListToBuild:
     class Progress:
@@ -123,7 +139,8 @@ class GpMirrorListToBuild:
         INPLACE = 1
         SEQUENTIAL = 2
 
-    def __init__(self, toBuild, pool, quiet, parallelDegree, additionalWarnings=None, logger=logger, forceoverwrite=False, progressMode=Progress.INPLACE, parallelPerHost=gp.DEFAULT_SEGHOST_NUM_WORKERS):
+    def __init__(self, toBuild, pool, quiet, parallelDegree, additionalWarnings=None, logger=logger, forceoverwrite=False, progressMode=Progress.INPLACE, parallelPerHost=gp.DEFAULT_SEGHOST_NUM_WORKERS,
+                 copyStreams=1):
         self.__mirrorsToBuild = toBuild
         self.__pool = pool
         self.__quiet = quiet
@@ -132,6 +149,8 @@ class GpMirrorListToBuild:
         # true for gprecoverseg and false for gpexpand and gpaddmirrors
         self.__forceoverwrite = forceoverwrite
         self.__parallelPerHost = parallelPerHost
+        # rsync streams per segment for full and differential recovery
+        self.__copyStreams = copyStreams
         self.__additionalWarnings = additionalWarnings or []
         self.segments_to_mark_down = []
         self.mirrorsToStart = []
@@ -399,7 +418,7 @@ class GpMirrorListToBuild:
             unix.Chmod.local('set permissions on blank dir', subDir, '0700')
 
     def _run_recovery(self): #TODO add tests ?
-        recovery_info_by_host = recoveryinfo.build_recovery_info(self.__mirrorsToBuild)
+        recovery_info_by_host = recoveryinfo.build_recovery_info(self.__mirrorsToBuild, self.__copyStreams)
 
         def createSegRecoveryCommand(host_name, cmd_label, validate_only):
             recovery_info_list = recovery_info_by_host[host_name]
@@ -124,13 +124,15 @@ class GpRecoverSegmentProgram:
             return GpSegmentRebalanceOperation(gpEnv, gpArray, self.__options.parallelDegree, self.__options.parallelPerHost)
         else:
             instance = RecoveryTripletsFactory.instance(gpArray, self.__options.recoveryConfigFile, self.__options.newRecoverHosts)
-            segs = [GpMirrorToBuild(t.failed, t.live, t.failover, self.__options.forceFullResynchronization) for t in instance.getTriplets()]
+            segs = [GpMirrorToBuild(t.failed, t.live, t.failover, self.__options.forceFullResynchronization,
+                                    self.__options.differentialResynchronization) for t in instance.getTriplets()]
             return GpMirrorListToBuild(segs, self.__pool, self.__options.quiet,
                                        self.__options.parallelDegree,
                                        instance.getInterfaceHostnameWarnings(),
                                        forceoverwrite=True,
                                        progressMode=self.getProgressMode(),
-                                       parallelPerHost=self.__options.parallelPerHost)
+                                       parallelPerHost=self.__options.parallelPerHost,
+                                       copyStreams=self.__options.copyStreams)
 
     def syncPackages(self, new_hosts):
         # The design decision here is to squash any exceptions resulting from the
@@ -261,6 +263,16 @@ class GpRecoverSegmentProgram:
         if optionCnt > 1:
             raise ProgramArgumentValidationException("Only one of -i, -p, and -r may be specified")
 
+        if self.__options.differentialResynchronization:
+            if self.__options.forceFullResynchronization:
+                raise ProgramArgumentValidationException("Only one of -F and --differential may be specified")
+            if self.__options.newRecoverHosts is not None or self.__options.rebalanceSegments:
+                raise ProgramArgumentValidationException("--differential cannot be used with -p or -r")
+
+        if self.__options.copyStreams < 1 or self.__options.copyStreams > gp.MAX_SEGHOST_NUM_WORKERS:
+            raise ProgramArgumentValidationException(
+                "Invalid copyStreams value provided with --copy-streams argument: %d" % self.__options.copyStreams)
+
         faultProberInterface.getFaultProber().initializeProber(gpEnv.getCoordinatorPort())
 
         confProvider = configInterface.getConfigurationProvider().initializeProvider(gpEnv.getCoordinatorPort())
@@ -453,6 +465,16 @@ class GpRecoverSegmentProgram:
                          dest="forceFullResynchronization",
                          metavar="<forceFullResynchronization>",
                          help="Force full segment resynchronization")
+        addTo.add_option('--differential', default=False, action='store_true',
+                         dest="differentialResynchronization",
+                         help="Resynchronize segments in place by copying only the files and file "
+                              "ranges that differ from the primary")
+        addTo.add_option('--copy-streams', type="int", default=1,
+                         dest="copyStreams",
+                         metavar="<copyStreams>",
+                         help="Number of parallel rsync streams to copy each segment with during full "
+                              "or differential recovery. With more than 1, full recovery uses rsync "
+                              "instead of pg_basebackup. Valid values are: 1-%d" % gp.MAX_SEGHOST_NUM_WORKERS)
         addTo.add_option("-B", None, type="int", default=gp.DEFAULT_COORDINATOR_NUM_WORKERS,
                          dest="parallelDegree",
                          metavar="<parallelDegree>",
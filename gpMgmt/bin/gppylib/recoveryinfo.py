@@ -7,12 +7,13 @@ from gppylib import gplog
 class RecoveryInfo(object):
     """
     This class encapsulates the information needed on a segment host
-    to run full/incremental recovery for a segment.
+    to run full/incremental/differential recovery for a segment.
 
     Note: we don't have target hostname, since an object of this class will be accessed by the target host directly
     """
     def __init__(self, target_datadir, target_port, target_segment_dbid, source_hostname, source_port,
-                 is_full_recovery, progress_file):
+                 is_full_recovery, progress_file, source_datadir=None, is_differential_recovery=False,
+                 copy_streams=1):
         self.target_datadir = target_datadir
         self.target_port = target_port
         self.target_segment_dbid = target_segment_dbid
@@ -23,6 +24,18 @@ class RecoveryInfo(object):
         self.is_full_recovery = is_full_recovery
         self.progress_file = progress_file
 
+        # Only differential recovery reads the source data directory (it
+        # rsyncs from it); pg_basebackup and pg_rewind go through the port.
+        self.source_datadir = source_datadir
+        self.is_differential_recovery = is_differential_recovery
+
+        # Number of rsync streams the files are split across. With more than
+        # one, full recovery copies with rsync instead of pg_basebackup.
+        self.copy_streams = copy_streams
+
+    def is_parallel_full_recovery(self):
+        return self.is_full_recovery and self.copy_streams > 1
+
     def __str__(self):
         return json.dumps(self, default=lambda o: o.__dict__)
 
@@ -37,11 +50,12 @@ def deserialize_recovery_info_list(serialized_string):
     deserialized_list = json.loads(serialized_string)
     return [RecoveryInfo(**i) for i in deserialized_list]
 
-def build_recovery_info(mirrors_to_build):
+def build_recovery_info(mirrors_to_build, copy_streams=1):
     """
     This function is used to format recovery information to send to each segment host
 
     @param mirrors_to_build:  list of mirrors that need recovery
+    @param copy_streams:  number of parallel streams to copy each segment with
 
     @return A dictionary with the following format:
 
@@ -57,7 +71,12 @@ def build_recovery_info(mirrors_to_build):
         target_segment = to_recover.getFailoverSegment() or to_recover.getFailedSegment()
 
         # TODO: move the progress file naming to gpsegrecovery
-        process_name = 'pg_basebackup' if to_recover.isFullSynchronization() else 'pg_rewind'
+        if to_recover.isFullSynchronization() and copy_streams <= 1:
+            process_name = 'pg_basebackup'
+        elif to_recover.isFullSynchronization() or to_recover.isDifferentialSynchronization():
+            process_name = 'rsync'
+        else:
+            process_name = 'pg_rewind'
         progress_file = '{}/{}.{}.dbid{}.out'.format(gplog.get_logger_dir(), process_name, timestamp,
                                              target_segment.getSegmentDbId())
 
@@ -69,5 +88,6 @@ def build_recovery_info(mirrors_to_build):
             target_segment.getSegmentDataDirectory(), target_segment.getSegmentPort(),
             target_segment.getSegmentDbId(), source_segment.getSegmentHostName(),
             source_segment.getSegmentPort(), to_recover.isFullSynchronization(),
-            progress_file))
+            progress_file, source_segment.getSegmentDataDirectory(),
+            to_recover.isDifferentialSynchronization(), copy_streams))
     return recovery_info_by_host
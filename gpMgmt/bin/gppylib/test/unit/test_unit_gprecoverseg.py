@@ -28,6 +28,8 @@ class Options:
         self.parallelDegree = 1
         self.parallelPerHost = 1
         self.forceFullResynchronization = None
+        self.differentialResynchronization = False
+        self.copyStreams = 1
         self.persistent_check = None
         self.quiet = None
         self.interactive = False
@@ -1,7 +1,9 @@
 from contextlib import redirect_stderr
 from mock import call, Mock, patch, ANY
 import io
+import os
 import sys
+import tempfile
 
 from .gp_unittest import GpTestCase
 import gpsegrecovery
@@ -198,6 +200,224 @@ class FullRecoveryTestCase(GpTestCase):
         self.assertEqual(0, self.mock_logger.exception.call_count)
 
 
+class DifferentialRecoveryTestCase(GpTestCase):
+    def setUp(self):
+        self.mock_logger = Mock(spec=['log', 'info', 'debug', 'error', 'warn', 'exception'])
+        self.mock_conn = Mock()
+        self.apply_patches([
+            patch('gpsegrecovery.dbconn.DbURL'),
+            patch('gpsegrecovery.dbconn.connect', return_value=self.mock_conn),
+            patch('gpsegrecovery.dbconn.query'),
+            patch('gpsegrecovery.dbconn.querySingleton', return_value='START WAL LOCATION: 0/2000028\n'),
+            patch('gpsegrecovery.getUserName', return_value='gpadmin'),
+            patch('gpsegrecovery.DifferentialRecovery.map_tablespaces', return_value=[]),
+            patch('gpsegrecovery.DifferentialRecovery.run_rsync'),
+        ])
+        self.mock_query = self.get_mock_from_apply_patch('query')
+        self.mock_query_singleton = self.get_mock_from_apply_patch('querySingleton')
+        self.mock_run_rsync = self.get_mock_from_apply_patch('run_rsync')
+
+        self.datadir = tempfile.TemporaryDirectory()
+        with open(os.path.join(self.datadir.name, 'postgresql.auto.conf'), 'w') as f:
+            f.write("# Do not edit this file manually!\n")
+
+        self.seg_recovery_info = RecoveryInfo(self.datadir.name, 50000, 2, 'sdw1', 40000,
+                                              False, '/test_progress_file', '/data/primary0', True)
+        self.differential_recovery_cmd = gpsegrecovery.DifferentialRecovery(
+            name='test differential recovery', recovery_info=self.seg_recovery_info,
+            logger=self.mock_logger)
+
+    def tearDown(self):
+        self.datadir.cleanup()
+        super(DifferentialRecoveryTestCase, self).tearDown()
+
+    def _read(self, filename):
+        with open(os.path.join(self.datadir.name, filename)) as f:
+            return f.read()
+
+    def test_differential_run_passes(self):
+        self.differential_recovery_cmd.run()
+
+        self.assertTrue(self.differential_recovery_cmd.get_results().wasSuccessful())
+        self.mock_query.assert_any_call(self.mock_conn, "SELECT pg_start_backup("
+                                                        "'gprecoverseg differential dbid 2', true, false)")
+        self.mock_query_singleton.assert_called_once_with(self.mock_conn,
+                                                          "SELECT labelfile FROM pg_stop_backup(false)")
+        self.assertEqual([call('/data/primary0', self.datadir.name,
+                               excludes=gpsegrecovery.DifferentialRecovery.EXCLUDED_PATHS),
+                          call('/data/primary0/pg_wal', os.path.join(self.datadir.name, 'pg_wal'))],
+                         self.mock_run_rsync.call_args_list)
+        self.assertEqual(1, self.mock_conn.close.call_count)
+
+        self.assertEqual('START WAL LOCATION: 0/2000028\n', self._read('backup_label'))
+        self.assertTrue(os.path.exists(os.path.join(self.datadir.name, 'standby.signal')))
+        self.assertEqual("# Do not edit this file manually!\n"
+                         "primary_conninfo = 'user=gpadmin host=sdw1 port=40000 application_name=gp_walreceiver'\n"
+                         "primary_slot_name = 'internal_wal_replication_slot'\n",
+                         self._read('postgresql.auto.conf'))
+        self.mock_logger.info.assert_called_with("Successfully ran differential recovery for dbid: 2")
+
+    def test_differential_rsync_failure_stops_backup(self):
+        self.mock_run_rsync.side_effect = [Exception('rsync failed')]
+
+        self.differential_recovery_cmd.run()
+
+        self.assertFalse(self.differential_recovery_cmd.get_results().wasSuccessful())
+        self.assertEqual('rsync failed', self.differential_recovery_cmd.get_results().stderr)
+        self.mock_query_singleton.assert_called_once_with(self.mock_conn,
+                                                          "SELECT labelfile FROM pg_stop_backup(false)")
+        self.assertEqual(1, self.mock_conn.close.call_count)
+        self.assertFalse(os.path.exists(os.path.join(self.datadir.name, 'standby.signal')))
+
+
+    @patch('gpsegrecovery.WorkerPool')
+    @patch('gpsegrecovery.DifferentialRecovery.list_source_files')
+    def test_differential_parallel_copy_balances_streams(self, mock_list_files, mock_pool):
+        mock_list_files.side_effect = [[(100, 'base/1/1'), (10, 'base/1/2'), (60, 'global/1')],
+                                       [(50, 'GPDB_1_302610183/16384/1.1')]]
+        directories = [('/data/primary0', self.datadir.name, ['/pg_wal']),
+                       ('/tblspc/1', '/tblspc/2', [])]
+        files_from = {}
+        progress_file = os.path.join(self.datadir.name, 'progress')
+        stream_progress_files = set()
+
+        def add_command(cmd):
+            # The file lists are removed once the copy is done
+            for path in cmd.cmdStr.split("--files-from ")[1:]:
+                path = path.split(' ', 1)[0]
+                with open(path) as f:
+                    files_from[(cmd.name, os.path.basename(path))] = f.read()
+            # Every stream has a progress file of its own, and every rsync
+            # of the stream counts from 0
+            for rsync in cmd.cmdStr.split(" && "):
+                path = rsync.split(" >> ")[1].split(' ', 1)[0]
+                stream_progress_files.add(path)
+                with open(path, 'a') as f:
+                    f.write('              0   0%    0.00kB/s    0:00:00  \r'
+                            '             10 100%   10.00kB/s    0:00:01 (xfr#1, to-chk=0/1)\n')
+        mock_pool.return_value.addCommand.side_effect = add_command
+        mock_pool.return_value.join.side_effect = [False, True]
+
+        self.seg_recovery_info.copy_streams = 2
+        self.seg_recovery_info.progress_file = progress_file
+        self.differential_recovery_cmd.copy_files_in_parallel(directories)
+
+        mock_pool.assert_called_once_with(numWorkers=2, logger=self.mock_logger)
+        self.assertEqual({('rsync stream 0 for dbid 2', '0.0'): 'base/1/1\nbase/1/2\n',
+                          ('rsync stream 1 for dbid 2', '1.0'): 'global/1\n',
+                          ('rsync stream 1 for dbid 2', '1.1'): 'GPDB_1_302610183/16384/1.1\n'},
+                         files_from)
+        mock_pool.return_value.check_results.assert_called_once_with()
+        mock_pool.return_value.haltWork.assert_called_once_with()
+
+        # The streams' output ends up in the segment's progress file, followed
+        # by the sum of the three rsyncs
+        self.assertEqual({progress_file + '.stream0', progress_file + '.stream1'}, stream_progress_files)
+        self.assertFalse(any(os.path.exists(path) for path in stream_progress_files))
+        with open(progress_file, newline='') as f:
+            lines = f.read().split('\n')
+        self.assertEqual(['             30  13%   (2 streams)', '             30  13%   (2 streams)', ''],
+                         [lines[0], lines[-2], lines[-1]])
+        self.assertEqual(1 + 3 + 1 + 1, len(lines))
+
+    def test_stream_copied_bytes_adds_up_rsyncs(self):
+        progress_file = os.path.join(self.datadir.name, 'progress.stream0')
+        self.assertEqual(0, gpsegrecovery.DifferentialRecovery.stream_copied_bytes(progress_file))
+
+        with open(progress_file, 'w') as f:
+            f.write('      1,048,576  50%    1.00MB/s    0:00:01 (xfr#1, to-chk=1/2)\r'
+                    '      2,097,152 100%    1.00MB/s    0:00:02 (xfr#2, to-chk=0/2)\n'
+                    'rsync: [sender] send_files failed to open "base/1/2": Permission denied (13)\n'
+                    '          4,096 100%    4.00kB/s    0:00:01 (xfr#1, to-chk=5/6)\r'
+                    '         65,536   3%   64.00kB/s    0:00:01 (xfr#2, to-chk=4/6)')
+        self.assertEqual(2097152 + 65536,
+                         gpsegrecovery.DifferentialRecovery.stream_copied_bytes(progress_file))
+
+    @patch('gpsegrecovery.DifferentialRecovery.copy_files_in_parallel')
+    def test_differential_parallel_run_passes(self, mock_copy_files):
+        self.seg_recovery_info.copy_streams = 4
+
+        self.differential_recovery_cmd.run()
+
+        self.assertTrue(self.differential_recovery_cmd.get_results().wasSuccessful())
+        mock_copy_files.assert_called_once_with([('/data/primary0', self.datadir.name,
+                                                  gpsegrecovery.DifferentialRecovery.EXCLUDED_PATHS)])
+        # The final pass still deletes what the primary no longer has
+        self.assertEqual([call('/data/primary0', self.datadir.name,
+                               excludes=gpsegrecovery.DifferentialRecovery.EXCLUDED_PATHS),
+                          call('/data/primary0/pg_wal', os.path.join(self.datadir.name, 'pg_wal'))],
+                         self.mock_run_rsync.call_args_list)
+
+    def test_rsync_cmd_str_tolerates_vanished_files(self):
+        self.assertEqual("{ rsync --archive --inplace --no-whole-file --info=progress2 --checksum --delete "
+                         "--exclude /pg_wal sdw1:/data/primary0/ /data/mirror0/ >> /test_progress_file 2>&1 "
+                         "|| [ $? -eq 24 ]; }",
+                         self.differential_recovery_cmd.rsync_cmd_str('/data/primary0', '/data/mirror0',
+                                                                      ['/pg_wal'], ['--delete']))
+
+
+class ParallelFullRecoveryTestCase(GpTestCase):
+    def setUp(self):
+        self.mock_logger = Mock(spec=['log', 'info', 'debug', 'error', 'warn', 'exception'])
+        self.mock_conn = Mock()
+        self.apply_patches([
+            patch('gpsegrecovery.dbconn.DbURL'),
+            patch('gpsegrecovery.dbconn.connect', return_value=self.mock_conn),
+            patch('gpsegrecovery.dbconn.query'),
+            patch('gpsegrecovery.dbconn.querySingleton', return_value='START WAL LOCATION: 0/2000028\n'),
+            patch('gpsegrecovery.getUserName', return_value='gpadmin'),
+            patch('gpsegrecovery.Command.run'),
+            patch('gpsegrecovery.DifferentialRecovery.copy_files_in_parallel'),
+            patch('gpsegrecovery.DifferentialRecovery.run_rsync'),
+        ])
+        self.mock_query = self.get_mock_from_apply_patch('query')
+        self.mock_copy_files = self.get_mock_from_apply_patch('copy_files_in_parallel')
+
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.datadir = os.path.join(self.tmpdir.name, 'mirror0')
+        self.seg_recovery_info = RecoveryInfo(self.datadir, 50000, 2, 'sdw1', 40000,
+                                              True, '/test_progress_file', '/data/primary0', False, 8)
+        self.full_recovery_cmd = gpsegrecovery.ParallelFullRecovery(
+            name='test parallel full recovery', recovery_info=self.seg_recovery_info,
+            logger=self.mock_logger)
+
+    def tearDown(self):
+        self.tmpdir.cleanup()
+        super(ParallelFullRecoveryTestCase, self).tearDown()
+
+    def _read(self, filename):
+        with open(os.path.join(self.datadir, filename)) as f:
+            return f.read()
+
+    @patch('gpsegrecovery.Command.get_results')
+    def test_parallel_full_run_passes(self, mock_get_results):
+        tblspc_dir = os.path.join(self.tmpdir.name, 'tblspc')
+        mock_get_results.return_value.stdout = '16384 {}/1\n'.format(tblspc_dir)
+
+        self.full_recovery_cmd.run()
+
+        self.assertTrue(self.full_recovery_cmd.get_results().wasSuccessful())
+        self.mock_query.assert_any_call(self.mock_conn, "SELECT pg_start_backup("
+                                                        "'gprecoverseg full dbid 2', true, false)")
+        # The tablespace directory is mapped to the mirror's dbid
+        self.assertEqual(os.path.join(tblspc_dir, '2'),
+                         os.readlink(os.path.join(self.datadir, 'pg_tblspc', '16384')))
+        self.mock_copy_files.assert_called_once_with([
+            ('/data/primary0', self.datadir, gpsegrecovery.DifferentialRecovery.EXCLUDED_PATHS),
+            (os.path.join(tblspc_dir, '1'), os.path.join(tblspc_dir, '2'), [])])
+        self.assertEqual('START WAL LOCATION: 0/2000028\n', self._read('backup_label'))
+        self.assertEqual('gp_dbid=2\n', self._read('internal.auto.conf'))
+        self.assertTrue(os.path.exists(os.path.join(self.datadir, 'standby.signal')))
+        self.mock_logger.info.assert_called_with("Successfully ran full recovery for dbid: 2")
+
+    def test_rsync_cmd_str_ignores_times(self):
+        self.assertEqual("{ rsync --archive --inplace --no-whole-file --info=progress2 --ignore-times --delete "
+                         "sdw1:/data/primary0/ /data/mirror0/ >> /test_progress_file 2>&1 "
+                         "|| [ $? -eq 24 ]; }",
+                         self.full_recovery_cmd.rsync_cmd_str('/data/primary0', '/data/mirror0',
+                                                              [], ['--delete']))
+
+
 class SegRecoveryTestCase(GpTestCase):
     def setUp(self):
         self.mock_logger = Mock(spec=['log', 'info', 'debug', 'error', 'warn', 'exception'])
@@ -297,6 +517,22 @@ class SegRecoveryTestCase(GpTestCase):
         self._assert_validation_full_call(cmd_list[0], self.full_r1)
         self._assert_setup_incr_call(cmd_list[1], self.incr_r2)
 
+    def test_get_recovery_cmds_differential_recoveryinfo(self):
+        diff_r1 = RecoveryInfo('target_data_dir5', 5005, 5, 'source_hostname5',
+                               6005, False, '/tmp/progress_file5', 'source_data_dir5', True)
+        cmd_list = SegRecovery().get_recovery_cmds([diff_r1, self.incr_r1], False, self.mock_logger)
+        self.assertTrue(isinstance(cmd_list[0], gpsegrecovery.DifferentialRecovery))
+        self.assertEqual(diff_r1, cmd_list[0].recovery_info)
+        self._assert_setup_incr_call(cmd_list[1], self.incr_r1)
+
+    def test_get_recovery_cmds_parallel_full_recoveryinfo(self):
+        full_r3 = RecoveryInfo('target_data_dir5', 5005, 5, 'source_hostname5',
+                               6005, True, '/tmp/progress_file5', 'source_data_dir5', False, 4)
+        cmd_list = SegRecovery().get_recovery_cmds([full_r3, self.full_r1], False, self.mock_logger)
+        self.assertTrue(isinstance(cmd_list[0], gpsegrecovery.ParallelFullRecovery))
+        self.assertEqual(full_r3, cmd_list[0].recovery_info)
+        self._assert_validation_full_call(cmd_list[1], self.full_r1)
+
     def test_get_recovery_cmds_mix_recoveryinfo_forceoverwrite(self):
         cmd_list = SegRecovery().get_recovery_cmds([
             self.full_r1, self.incr_r2], True, self.mock_logger)
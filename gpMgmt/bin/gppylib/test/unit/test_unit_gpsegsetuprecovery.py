@@ -204,6 +204,36 @@ class SetupForIncrementalRecoveryTestCase(GpTestCase):
         self._assert_cmd_failed("Failed while trying to remove postmaster.pid.")
 
 
+class SetupForDifferentialRecoveryTestCase(GpTestCase):
+    def setUp(self):
+        self.mock_logger = Mock(spec=['log', 'info', 'debug', 'error', 'warn', 'exception'])
+        self.seg_recovery_info = RecoveryInfo('/data/mirror0', 50000, 2, 'sdw1', 40000,
+                                              False, '/test_progress_file', '/data/primary0', True)
+        self.setup_for_differential_recovery_cmd = gpsegsetuprecovery.SetupForDifferentialRecovery(
+            name='setup for differential recovery', recovery_info=self.seg_recovery_info, logger=self.mock_logger)
+
+    def tearDown(self):
+        super(SetupForDifferentialRecoveryTestCase, self).tearDown()
+
+    def test_setup_removes_pid_passes(self):
+        with tempfile.TemporaryDirectory() as d:
+            self.seg_recovery_info.target_datadir = d
+            open("{}/PG_VERSION".format(d), 'w').close()
+            open("{}/postmaster.pid".format(d), 'w').close()
+            self.setup_for_differential_recovery_cmd.run()
+            self.assertFalse(os.path.exists("{}/postmaster.pid".format(d)))
+        self.assertEqual(0, self.setup_for_differential_recovery_cmd.get_results().rc)
+        self.assertTrue(self.setup_for_differential_recovery_cmd.get_results().wasSuccessful())
+
+    def test_setup_empty_datadir_fails(self):
+        with tempfile.TemporaryDirectory() as d:
+            self.seg_recovery_info.target_datadir = d
+            self.setup_for_differential_recovery_cmd.run()
+        self.assertEqual(1, self.setup_for_differential_recovery_cmd.get_results().rc)
+        self.assertIn("does not contain a data directory; use full recovery instead",
+                      self.setup_for_differential_recovery_cmd.get_results().stderr)
+
+
 class SegSetupRecoveryTestCase(GpTestCase):
     def setUp(self):
         self.mock_logger = Mock(spec=['log', 'info', 'debug', 'error', 'warn', 'exception'])
@@ -308,6 +338,14 @@ class SegSetupRecoveryTestCase(GpTestCase):
         self._assert_validation_full_call(cmd_list[0], self.full_r1)
         self._assert_setup_incr_call(cmd_list[1], self.incr_r2)
 
+    def test_get_setup_cmds_differential_recoveryinfo(self):
+        diff_r1 = RecoveryInfo('target_data_dir5', 5005, 5, 'source_hostname5',
+                               6005, False, '/tmp/progress_file5', 'source_data_dir5', True)
+        cmd_list = SegSetupRecovery().get_setup_cmds([diff_r1, self.incr_r1], False, self.mock_logger)
+        self.assertTrue(isinstance(cmd_list[0], gpsegsetuprecovery.SetupForDifferentialRecovery))
+        self.assertEqual(diff_r1, cmd_list[0].recovery_info)
+        self._assert_setup_incr_call(cmd_list[1], self.incr_r1)
+
     def test_get_setup_cmds_mix_recoveryinfo_forceoverwrite(self):
         cmd_list = SegSetupRecovery().get_setup_cmds([
             self.full_r1, self.incr_r2], True, self.mock_logger)
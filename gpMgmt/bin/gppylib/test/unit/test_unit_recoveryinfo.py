@@ -44,27 +44,33 @@ class BuildRecoveryInfoTestCase(GpTestCase):
                 "mirrors_to_build": [GpMirrorToBuild(self.m3, self.p3, None, True),
                                      GpMirrorToBuild(self.m4, self.p4, None, False)],
                 "expected": {'sdw3': [RecoveryInfo('/data/mirror3', 7000, 7, 'sdw2', 3000,
-                                                   True, '/tmp/logdir/pg_basebackup.111.dbid7.out'),
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid7.out',
+                                                   '/data/primary3', False),
                                       RecoveryInfo('/data/mirror4', 8000, 8, 'sdw3', 4000,
-                                                   False, '/tmp/logdir/pg_rewind.111.dbid8.out')]}
+                                                   False, '/tmp/logdir/pg_rewind.111.dbid8.out',
+                                                   '/data/primary4', False)]}
             },
             {
                 "name": "single_target_hosts_suggest_full_and_incr_with_failover",
                 "mirrors_to_build": [GpMirrorToBuild(self.m1, self.p1, self.m5, True),
                                      GpMirrorToBuild(self.m2, self.p2, self.m6, False)],
                 "expected": {'sdw4': [RecoveryInfo('/data/mirror5', 9000, 5, 'sdw1', 1000,
-                                                   True, '/tmp/logdir/pg_basebackup.111.dbid5.out'),
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid5.out',
+                                                   '/data/primary1', False),
                                       RecoveryInfo('/data/mirror6', 10000, 6, 'sdw2', 2000,
-                                                   True, '/tmp/logdir/pg_basebackup.111.dbid6.out')]}
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid6.out',
+                                                   '/data/primary2', False)]}
             },
             {
                 "name": "multiple_target_hosts_suggest_full",
                 "mirrors_to_build": [GpMirrorToBuild(self.m1, self.p1, None, True),
                                      GpMirrorToBuild(self.m2, self.p2, None, True)],
                 "expected": {'sdw2': [RecoveryInfo('/data/mirror1', 5000, 5, 'sdw1', 1000,
-                                                  True, '/tmp/logdir/pg_basebackup.111.dbid5.out')],
+                                                  True, '/tmp/logdir/pg_basebackup.111.dbid5.out',
+                                                  '/data/primary1', False)],
                              'sdw1': [RecoveryInfo('/data/mirror2', 6000, 6, 'sdw2', 2000,
-                                                  True, '/tmp/logdir/pg_basebackup.111.dbid6.out')]}
+                                                  True, '/tmp/logdir/pg_basebackup.111.dbid6.out',
+                                                  '/data/primary2', False)]}
             },
             {
                 "name": "multiple_target_hosts_suggest_full_and_incr",
@@ -72,20 +78,25 @@ class BuildRecoveryInfoTestCase(GpTestCase):
                                      GpMirrorToBuild(self.m3, self.p3, None, False),
                                      GpMirrorToBuild(self.m4, self.p4, None, True)],
                 "expected": {'sdw2': [RecoveryInfo('/data/mirror1', 5000, 5, 'sdw1', 1000,
-                                                   True, '/tmp/logdir/pg_basebackup.111.dbid5.out')],
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid5.out',
+                                                   '/data/primary1', False)],
                              'sdw3': [RecoveryInfo('/data/mirror3', 7000, 7, 'sdw2', 3000,
-                                                   False, '/tmp/logdir/pg_rewind.111.dbid7.out'),
+                                                   False, '/tmp/logdir/pg_rewind.111.dbid7.out',
+                                                   '/data/primary3', False),
                                       RecoveryInfo('/data/mirror4', 8000, 8, 'sdw3', 4000,
-                                                   True, '/tmp/logdir/pg_basebackup.111.dbid8.out')]}
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid8.out',
+                                                   '/data/primary4', False)]}
             },
             {
                 "name": "multiple_target_hosts_suggest_incr_failover_same_as_failed",
                 "mirrors_to_build": [GpMirrorToBuild(self.m1, self.p1, self.m1, False),
                                      GpMirrorToBuild(self.m2, self.p2, self.m2, False)],
                 "expected": {'sdw2': [RecoveryInfo('/data/mirror1', 5000, 5, 'sdw1', 1000,
-                                                  True, '/tmp/logdir/pg_basebackup.111.dbid5.out')],
+                                                  True, '/tmp/logdir/pg_basebackup.111.dbid5.out',
+                                                  '/data/primary1', False)],
                              'sdw1': [RecoveryInfo('/data/mirror2', 6000, 6, 'sdw2', 2000,
-                                                  True, '/tmp/logdir/pg_basebackup.111.dbid6.out')]}
+                                                  True, '/tmp/logdir/pg_basebackup.111.dbid6.out',
+                                                  '/data/primary2', False)]}
             },
             {
                 "name": "multiple_target_hosts_suggest_full_failover_same_as_failed",
@@ -93,11 +104,14 @@ class BuildRecoveryInfoTestCase(GpTestCase):
                                      GpMirrorToBuild(self.m3, self.p3, self.m3, True),
                                      GpMirrorToBuild(self.m4, self.p4, None, True)],
                 "expected": {'sdw2': [RecoveryInfo('/data/mirror1', 5000, 5, 'sdw1', 1000,
-                                                  True, '/tmp/logdir/pg_basebackup.111.dbid5.out')],
+                                                  True, '/tmp/logdir/pg_basebackup.111.dbid5.out',
+                                                  '/data/primary1', False)],
                              'sdw3': [RecoveryInfo('/data/mirror3', 7000, 7, 'sdw2', 3000,
-                                                   True, '/tmp/logdir/pg_basebackup.111.dbid7.out'),
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid7.out',
+                                                   '/data/primary3', False),
                                       RecoveryInfo('/data/mirror4', 8000, 8, 'sdw3', 4000,
-                                                   True, '/tmp/logdir/pg_basebackup.111.dbid8.out')]}
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid8.out',
+                                                   '/data/primary4', False)]}
             },
             {
                 "name": "multiple_target_hosts_suggest_full_and_incr",
@@ -106,19 +120,49 @@ class BuildRecoveryInfoTestCase(GpTestCase):
                                      GpMirrorToBuild(self.m3, self.p3, self.m3, False),
                                      GpMirrorToBuild(self.m4, self.p4, self.m8, True)],
                 "expected": {'sdw4': [RecoveryInfo('/data/mirror5', 9000, 5, 'sdw1', 1000,
-                                                   True, '/tmp/logdir/pg_basebackup.111.dbid5.out'),
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid5.out',
+                                                   '/data/primary1', False),
                                       ],
                              'sdw1': [RecoveryInfo('/data/mirror2', 6000, 6,
                                                    'sdw2', 2000, False,
-                                                   '/tmp/logdir/pg_rewind.111.dbid6.out'),
+                                                   '/tmp/logdir/pg_rewind.111.dbid6.out',
+                                                   '/data/primary2', False),
                                       RecoveryInfo('/data/mirror8', 12000, 8,
                                                    'sdw3', 4000, True,
-                                                   '/tmp/logdir/pg_basebackup.111.dbid8.out')],
+                                                   '/tmp/logdir/pg_basebackup.111.dbid8.out',
+                                                   '/data/primary4', False)],
                              'sdw3': [RecoveryInfo('/data/mirror3', 7000, 7, 'sdw2', 3000,
-                                                   True, '/tmp/logdir/pg_basebackup.111.dbid7.out')]
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid7.out',
+                                                   '/data/primary3', False)]
                              }
             },
-
+            {
+                "name": "differential_in_place_and_full_with_failover",
+                "mirrors_to_build": [GpMirrorToBuild(self.m1, self.p1, None, False, True),
+                                     GpMirrorToBuild(self.m2, self.p2, self.m6, False, True)],
+                "expected": {'sdw2': [RecoveryInfo('/data/mirror1', 5000, 5, 'sdw1', 1000,
+                                                   False, '/tmp/logdir/rsync.111.dbid5.out',
+                                                   '/data/primary1', True)],
+                             'sdw4': [RecoveryInfo('/data/mirror6', 10000, 6, 'sdw2', 2000,
+                                                   True, '/tmp/logdir/pg_basebackup.111.dbid6.out',
+                                                   '/data/primary2', False)]}
+            },
+            {
+                "name": "copy_streams_full_incr_and_differential",
+                "copy_streams": 4,
+                "mirrors_to_build": [GpMirrorToBuild(self.m1, self.p1, self.m5, True),
+                                     GpMirrorToBuild(self.m2, self.p2, None, False),
+                                     GpMirrorToBuild(self.m3, self.p3, None, False, True)],
+                "expected": {'sdw4': [RecoveryInfo('/data/mirror5', 9000, 5, 'sdw1', 1000,
+                                                   True, '/tmp/logdir/rsync.111.dbid5.out',
+                                                   '/data/primary1', False, 4)],
+                             'sdw1': [RecoveryInfo('/data/mirror2', 6000, 6, 'sdw2', 2000,
+                                                   False, '/tmp/logdir/pg_rewind.111.dbid6.out',
+                                                   '/data/primary2', False, 4)],
+                             'sdw3': [RecoveryInfo('/data/mirror3', 7000, 7, 'sdw2', 3000,
+                                                   False, '/tmp/logdir/rsync.111.dbid7.out',
+                                                   '/data/primary3', True, 4)]}
+            },
         ]
         self.run_tests(tests)
 
@@ -127,6 +171,6 @@ class BuildRecoveryInfoTestCase(GpTestCase):
             with self.subTest(msg=test["name"]):
                 self.mock_datetime = self.get_mock_from_apply_patch('datetime')
                 self.mock_datetime.today.return_value.strftime = Mock(side_effect=['111', '222'])
-                actual_ri_by_host = build_recovery_info(test['mirrors_to_build'])
+                actual_ri_by_host = build_recovery_info(test['mirrors_to_build'], test.get('copy_streams', 1))
                 self.assertEqual(test['expected'], actual_ri_by_host)
                 self.mock_datetime.today.return_value.strftime.assert_called_once()
@@ -1,8 +1,17 @@
 #!/usr/bin/env python3
 
+import heapq
+import os
+import pipes
+import shutil
+import tempfile
+from collections import defaultdict
+
 from gppylib.commands.pg import PgBaseBackup, PgRewind
 from recovery_base import RecoveryBase
-from gppylib.commands.base import set_cmd_results, Command
+from gppylib.commands.base import set_cmd_results, Command, WorkerPool, REMOTE
+from gppylib.commands.unix import getUserName
+from gppylib.db import dbconn
 
 
 class FullRecovery(Command):
@@ -82,6 +91,352 @@ class IncrementalRecovery(Command):
             self.recovery_info.target_segment_dbid))
 
 
+class DifferentialRecovery(Command):
+    """
+    Bring an existing mirror data directory up to date with its primary
+    without copying everything, for when pg_rewind can't be used.
+
+    The files are copied with rsync, whose delta transfer compares rolling
+    checksums of the blocks of each file on both sides and only sends the
+    ranges that differ. Unchanged relation files, and append-only segfiles
+    that have only grown since the mirror went down, cost little more than
+    reading them on both hosts. The copy is made between pg_start_backup()
+    and pg_stop_backup() on the primary, the WAL written in the meantime is
+    copied afterwards, and the mirror then recovers from the backup label
+    like after pg_basebackup.
+    """
+
+    # Same as what pg_basebackup leaves out, see basebackup.c, plus the
+    # files that belong to the mirror itself.
+    EXCLUDED_PATHS = ['/pg_wal', '/pg_tblspc',
+                      '/pg_replslot/*', '/pg_dynshmem/*', '/pg_notify/*', '/pg_serial/*',
+                      '/pg_snapshots/*', '/pg_subtrans/*', '/pg_stat_tmp/*', '/log/*',
+                      '/backups', '/db_dumps', '/promote',
+                      '/postmaster.pid', '/postmaster.opts',
+                      '/backup_label', '/backup_label.old', '/tablespace_map', '/backup_manifest',
+                      '/postgresql.auto.conf.tmp', '/current_logfiles.tmp', 'pg_internal.init*',
+                      'pgsql_tmp*', '/internal.auto.conf', '/standby.signal', '/recovery.signal']
+
+    recovery_type = 'differential'
+
+    # Seconds between the progress lines of parallel copies
+    PROGRESS_INTERVAL = 1
+
+    # rsync's quick check skips a file whose size and modification time
+    # match, without reading it. A mirror's relation files can differ from
+    # the primary's with the same size and time, such as a page written in
+    # place within the same second, so compare the content of every file.
+    quick_check_args = ['--checksum']
+
+    def __init__(self, name, recovery_info, logger):
+        self.name = name
+        self.recovery_info = recovery_info
+        self.replicationSlotName = 'internal_wal_replication_slot'
+        cmdStr = ''
+        Command.__init__(self, self.name, cmdStr)
+        self.logger = logger
+
+    @set_cmd_results
+    def run(self):
+        self.logger.info("Running {} recovery with progress output temporarily in {}".format(
+            self.recovery_type, self.recovery_info.progress_file))
+
+        dburl = dbconn.DbURL(hostname=self.recovery_info.source_hostname,
+                             port=self.recovery_info.source_port, dbname='template1')
+        conn = dbconn.connect(dburl, utility=True)
+        try:
+            conn.autocommit = True
+
+            # Make sure the primary keeps the WAL the mirror will need, from
+            # the backup start until the mirror starts streaming.
+            dbconn.query(conn, "SELECT pg_create_physical_replication_slot('{0}', true) "
+                               "WHERE NOT EXISTS (SELECT 1 FROM pg_replication_slots "
+                               "WHERE slot_name = '{0}')".format(self.replicationSlotName))
+
+            dbconn.query(conn, "SELECT pg_start_backup('gprecoverseg {} dbid {}', true, false)"
+                         .format(self.recovery_type, self.recovery_info.target_segment_dbid))
+            try:
+                self.sync_directories([(self.recovery_info.source_datadir, self.recovery_info.target_datadir,
+                                        self.EXCLUDED_PATHS)] + self.map_tablespaces())
+            finally:
+                backup_label = dbconn.querySingleton(conn, "SELECT labelfile FROM pg_stop_backup(false)")
+        finally:
+            conn.close()
+
+        self.sync_wal()
+        self.write_recovery_files(backup_label)
+
+        self.logger.info("Successfully ran {} recovery for dbid: {}".format(
+            self.recovery_type, self.recovery_info.target_segment_dbid))
+
+    def map_tablespaces(self):
+        """
+        Tablespace directories have the dbid of the segment in their path, so
+        the links in pg_tblspc differ between the primary and the mirror.
+        Returns a (source, target, excludes) entry for the directory behind
+        every link of the primary and the one behind the corresponding link
+        of the mirror, creating the link the same way pg_basebackup
+        --target-gp-dbid would when the mirror doesn't have it yet.
+        """
+        cmd = Command('list tablespaces of dbid {}'.format(self.recovery_info.target_segment_dbid),
+                      "find {} -mindepth 1 -maxdepth 1 -type l -printf '%f %l\\n'".format(
+                          pipes.quote(os.path.join(self.recovery_info.source_datadir, 'pg_tblspc'))),
+                      ctxt=REMOTE, remoteHost=self.recovery_info.source_hostname)
+        cmd.run(validateAfter=True)
+
+        source_links = dict(line.split(' ', 1) for line in cmd.get_results().stdout.splitlines() if line)
+        target_tblspc_dir = os.path.join(self.recovery_info.target_datadir, 'pg_tblspc')
+        if not os.path.isdir(target_tblspc_dir):
+            os.makedirs(target_tblspc_dir, 0o700)
+
+        directories = []
+        for spcoid, source_location in sorted(source_links.items()):
+            target_link = os.path.join(target_tblspc_dir, spcoid)
+            if not os.path.islink(target_link):
+                target_location = os.path.join(os.path.dirname(source_location.rstrip('/')),
+                                               str(self.recovery_info.target_segment_dbid))
+                self.logger.info("Creating tablespace {} directory {}".format(spcoid, target_location))
+                if not os.path.isdir(target_location):
+                    os.makedirs(target_location, 0o700)
+                os.symlink(target_location, target_link)
+            directories.append((source_location, os.readlink(target_link), []))
+
+        # A tablespace dropped while the mirror was down
+        for spcoid in os.listdir(target_tblspc_dir):
+            if spcoid not in source_links:
+                self.logger.info("Removing link to tablespace {} that no longer exists on the primary"
+                                 .format(spcoid))
+                os.unlink(os.path.join(target_tblspc_dir, spcoid))
+
+        return directories
+
+    def sync_directories(self, directories):
+        """
+        directories is a list of (source_dir, target_dir, excludes).
+
+        With more than one copy stream the files are first copied in
+        parallel, and the pass below then only finds them up to date. It is
+        still what deletes the files the primary no longer has and creates
+        the symlinks and empty directories, which no file list covers.
+        """
+        if self.recovery_info.copy_streams > 1:
+            self.copy_files_in_parallel(directories)
+
+        for source_dir, target_dir, excludes in directories:
+            self.run_rsync(source_dir, target_dir, excludes=excludes)
+
+    def copy_files_in_parallel(self, directories):
+        """
+        Split the regular files of all directories, relation and append-only
+        segfiles alike, across copy_streams rsync processes. A single rsync
+        is bound by one ssh stream and one reader and writer; several of them
+        keep more disks and network queues busy. Each file goes to the stream
+        with the fewest bytes so far, largest files first, so the streams
+        finish at about the same time even with a few huge segfiles.
+
+        Every stream writes its rsync output to a progress file of its own,
+        since the progress lines of several rsync processes would interleave
+        in one file. The progress file of the segment gets the sum of the
+        streams instead.
+        """
+        streams = self.recovery_info.copy_streams
+        files = []
+        for i, (source_dir, _, _) in enumerate(directories):
+            files.extend((size, path, i) for size, path in self.list_source_files(source_dir))
+        files.sort(reverse=True)
+        total_size = sum(size for size, _, _ in files)
+
+        file_lists = [defaultdict(list) for _ in range(streams)]
+        stream_sizes = [(0, n) for n in range(streams)]
+        for size, path, i in files:
+            total, n = heapq.heappop(stream_sizes)
+            file_lists[n][i].append(path)
+            heapq.heappush(stream_sizes, (total + size, n))
+
+        self.logger.info("Copying {} files of dbid {} with {} streams".format(
+            len(files), self.recovery_info.target_segment_dbid, streams))
+
+        list_dir = tempfile.mkdtemp(prefix='gpsegrecovery.dbid{}.'.format(self.recovery_info.target_segment_dbid))
+        progress_files = []
+        pool = WorkerPool(numWorkers=streams, logger=self.logger)
+        try:
+            for n, lists in enumerate(file_lists):
+                cmd_strs = []
+                progress_file = '{}.stream{}'.format(self.recovery_info.progress_file, n)
+                for i, paths in sorted(lists.items()):
+                    files_from = os.path.join(list_dir, '{}.{}'.format(n, i))
+                    with open(files_from, 'w') as f:
+                        f.writelines(path + '\n' for path in paths)
+                    source_dir, target_dir, excludes = directories[i]
+                    cmd_strs.append(self.rsync_cmd_str(source_dir, target_dir, excludes,
+                                                       ['--files-from', files_from],
+                                                       progress_file=progress_file))
+                if cmd_strs:
+                    progress_files.append(progress_file)
+                    pool.addCommand(Command('rsync stream {} for dbid {}'.format(
+                        n, self.recovery_info.target_segment_dbid), ' && '.join(cmd_strs)))
+            while not pool.join(self.PROGRESS_INTERVAL):
+                self.write_parallel_progress(progress_files, total_size)
+            pool.check_results()
+        finally:
+            pool.haltWork()
+            shutil.rmtree(list_dir, ignore_errors=True)
+            self.write_parallel_progress(progress_files, total_size, collect=True)
+
+    def write_parallel_progress(self, progress_files, total_size, collect=False):
+        """
+        Append a line in the format of rsync --info=progress2 with the bytes
+        all streams have copied so far. gprecoverseg shows the last line of
+        the progress file.
+
+        With collect, the streams are done: their output, including any rsync
+        errors, is moved to the progress file of the segment first.
+        """
+        copied = sum(self.stream_copied_bytes(path) for path in progress_files)
+        if collect:
+            self.collect_stream_progress(progress_files)
+        percent = min(100, copied * 100 // total_size) if total_size else 100
+        with open(self.recovery_info.progress_file, 'a') as f:
+            f.write('{:>15,} {:>3}%   ({} streams)\n'.format(copied, percent,
+                                                          self.recovery_info.copy_streams))
+
+    @staticmethod
+    def stream_copied_bytes(progress_file):
+        """
+        Returns the bytes a stream has copied according to the rsync
+        --info=progress2 lines in its progress file. A stream runs one rsync
+        per directory, and the count of each starts over from 0.
+        """
+        try:
+            with open(progress_file, 'rb') as f:
+                output = f.read().decode('utf-8', 'replace')
+        except IOError:
+            return 0
+
+        done = current = 0
+        for line in output.replace('\r', '\n').split('\n'):
+            tokens = line.split()
+            if len(tokens) > 1 and tokens[1].endswith('%') and tokens[0].replace(',', '').isdigit():
+                count = int(tokens[0].replace(',', ''))
+                if count < current:
+                    done += current
+                current = count
+        return done + current
+
+    def collect_stream_progress(self, progress_files):
+        with open(self.recovery_info.progress_file, 'ab') as out:
+            for path in progress_files:
+                try:
+                    with open(path, 'rb') as f:
+                        shutil.copyfileobj(f, out)
+                    os.remove(path)
+                except IOError:
+                    pass
+
+    def list_source_files(self, source_dir):
+        """
+        Returns (size, path relative to source_dir) of the regular files under
+        source_dir on the primary. pg_wal is synced on its own afterwards, and
+        find doesn't follow the links in pg_tblspc. Files that vanish while
+        find runs are left to the final rsync pass.
+        """
+        cmd = Command('list files of dbid {}'.format(self.recovery_info.target_segment_dbid),
+                      "cd {} && {{ find . -path ./pg_wal -prune -o -type f -printf '%s %P\\n' 2>/dev/null || true; }}".format(
+                          pipes.quote(source_dir)),
+                      ctxt=REMOTE, remoteHost=self.recovery_info.source_hostname)
+        cmd.run(validateAfter=True)
+
+        files = []
+        for line in cmd.get_results().stdout.splitlines():
+            if line:
+                size, path = line.split(' ', 1)
+                files.append((int(size), path))
+        return files
+
+    def sync_wal(self):
+        self.run_rsync(os.path.join(self.recovery_info.source_datadir, 'pg_wal'),
+                       os.path.join(self.recovery_info.target_datadir, 'pg_wal'))
+
+    def write_recovery_files(self, backup_label):
+        datadir = self.recovery_info.target_datadir
+
+        with open(os.path.join(datadir, 'backup_label'), 'w') as f:
+            f.write(backup_label)
+
+        # postgresql.auto.conf now is the primary's; point it back at the
+        # primary, as pg_basebackup --write-recovery-conf does.
+        conninfo = "user={} host={} port={} application_name=gp_walreceiver".format(
+            getUserName(), self.recovery_info.source_hostname, self.recovery_info.source_port)
+        with open(os.path.join(datadir, 'postgresql.auto.conf'), 'a') as f:
+            f.write("primary_conninfo = '{}'\n".format(conninfo.replace("'", "''")))
+            f.write("primary_slot_name = '{}'\n".format(self.replicationSlotName))
+
+        open(os.path.join(datadir, 'standby.signal'), 'w').close()
+
+    def run_rsync(self, source_dir, target_dir, excludes=()):
+        cmd = Command('rsync for dbid {}'.format(self.recovery_info.target_segment_dbid),
+                      self.rsync_cmd_str(source_dir, target_dir, excludes, ['--delete']))
+        cmd.run(validateAfter=True)
+
+    def rsync_cmd_str(self, source_dir, target_dir, excludes, extra_args, progress_file=None):
+        # --inplace rewrites only the changed blocks of a file, rather than
+        # building a new copy of every multi-gigabyte file that differs.
+        # --no-whole-file keeps the delta transfer on when both segments are
+        # on the same host.
+        cmd_tokens = ['rsync', '--archive', '--inplace', '--no-whole-file', '--info=progress2']
+        cmd_tokens.extend(self.quick_check_args)
+        cmd_tokens.extend(extra_args)
+        for path in excludes:
+            cmd_tokens.extend(['--exclude', path])
+        cmd_tokens.append('{}:{}/'.format(self.recovery_info.source_hostname, source_dir))
+        cmd_tokens.append('{}/'.format(target_dir))
+
+        # Exit code 24 means some files vanished while being copied, such
+        # as temporary files; the backup doesn't need them, like
+        # pg_basebackup skips them too.
+        return '{{ {} >> {} 2>&1 || [ $? -eq 24 ]; }}'.format(' '.join(pipes.quote(t) for t in cmd_tokens),
+                                                             pipes.quote(progress_file or self.recovery_info.progress_file))
+
+
+class ParallelFullRecovery(DifferentialRecovery):
+    """
+    Full recovery that copies the data directory and tablespaces with
+    several rsync streams instead of through pg_basebackup's single
+    connection. This is a differential recovery that copies every file:
+    gprecoverseg overwrites the mirror's data directory in place, so
+    whatever the target still holds is not trusted.
+
+    pg_basebackup verifies the data checksums of the pages it sends and
+    reports the ones that fail. rsync only makes sure that every file
+    arrives as it was read, so a page that is already corrupt on the
+    primary is copied without a warning. Running pg_checksums on the copy
+    doesn't replace that check either: pages written during the copy are
+    torn until the mirror replays the WAL.
+    """
+
+    recovery_type = 'full'
+
+    # Send every file instead of skipping the ones whose size and time
+    # match; the existing files are only used as the basis of the delta
+    # transfer. Comparing checksums first would read every file once more.
+    quick_check_args = ['--ignore-times']
+
+    def map_tablespaces(self):
+        if not os.path.isdir(self.recovery_info.target_datadir):
+            os.makedirs(self.recovery_info.target_datadir, 0o700)
+        return super(ParallelFullRecovery, self).map_tablespaces()
+
+    def write_recovery_files(self, backup_label):
+        super(ParallelFullRecovery, self).write_recovery_files(backup_label)
+
+        # What pg_basebackup --target-gp-dbid writes; differential recovery
+        # keeps the mirror's own copy.
+        internal_conf = os.path.join(self.recovery_info.target_datadir, 'internal.auto.conf')
+        if not os.path.exists(internal_conf):
+            with open(internal_conf, 'w') as f:
+                f.write("gp_dbid={}\n".format(self.recovery_info.target_segment_dbid))
+
+
 #TODO we may not need this class
 class SegRecovery(object):
     def __init__(self):
@@ -93,11 +448,19 @@ class SegRecovery(object):
     def get_recovery_cmds(self, seg_recovery_info_list, forceoverwrite, logger):
         cmd_list = []
         for seg_recovery_info in seg_recovery_info_list:
-            if seg_recovery_info.is_full_recovery:
+            if seg_recovery_info.is_parallel_full_recovery():
+                cmd = ParallelFullRecovery(name='Run parallel copy',
+                                           recovery_info=seg_recovery_info,
+                                           logger=logger)
+            elif seg_recovery_info.is_full_recovery:
                 cmd = FullRecovery(name='Run pg_basebackup',
                                    recovery_info=seg_recovery_info,
                                    forceoverwrite=forceoverwrite,
                                    logger=logger)
+            elif seg_recovery_info.is_differential_recovery:
+                cmd = DifferentialRecovery(name='Run differential recovery',
+                                           recovery_info=seg_recovery_info,
+                                           logger=logger)
             else:
                 cmd = IncrementalRecovery(name='Run pg_rewind',
                                           recovery_info=seg_recovery_info,
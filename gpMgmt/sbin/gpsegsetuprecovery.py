@@ -58,6 +58,20 @@ class SetupForIncrementalRecovery(Command):
         self.remove_postmaster_pid()
 
 
+class SetupForDifferentialRecovery(SetupForIncrementalRecovery):
+    @set_cmd_results
+    def run(self):
+        # Differential recovery only makes sense for a data directory that
+        # still holds a copy of the segment.
+        if not os.path.exists(os.path.join(self.recovery_info.target_datadir, 'PG_VERSION')):
+            raise ValidationException("for segment with port {}: Segment directory '{}' does not contain "
+                                      "a data directory; use full recovery instead"
+                                      .format(self.recovery_info.target_port,
+                                              self.recovery_info.target_datadir))
+
+        self.remove_postmaster_pid()
+
+
 class ValidationForFullRecovery(Command):
     def __init__(self, name, recovery_info, forceoverwrite, logger):
         self.name = name
@@ -121,6 +135,10 @@ class SegSetupRecovery(object):
                                                 recovery_info=seg_recovery_info,
                                                 forceoverwrite=forceoverwrite,
                                                 logger=logger)
+            elif seg_recovery_info.is_differential_recovery:
+                cmd = SetupForDifferentialRecovery(name='Setup for differential recovery',
+                                                   recovery_info=seg_recovery_info,
+                                                   logger=logger)
             else:
                 cmd = SetupForIncrementalRecovery(name='Setup for pg_rewind',
                                                   recovery_info=seg_recovery_info,
@@ -0,0 +1,59 @@
+--
+-- Trained zstd dictionaries for columns of AOCS tables
+--
+CREATE TABLE zstd_dict_t (id int, payload text)
+  WITH (appendonly=true, orientation=column, compresstype=zstd, compresslevel=3)
+  DISTRIBUTED BY (id);
+INSERT INTO zstd_dict_t
+  SELECT i, '{"event":"click","user":' || i || ',"page":"/home/' || (i % 50) || '"}'
+  FROM generate_series(1, 20000) i;
+
+SELECT gp_zstd_train_dictionary('zstd_dict_t', 'payload') > 0 AS trained;
+
+-- Blocks written before and after training both read back
+INSERT INTO zstd_dict_t
+  SELECT i, '{"event":"click","user":' || i || ',"page":"/home/' || (i % 50) || '"}'
+  FROM generate_series(20001, 40000) i;
+SELECT count(*), count(DISTINCT payload), sum(length(payload)) FROM zstd_dict_t;
+
+-- Retraining keeps the older dictionary for the blocks compressed with it
+SELECT gp_zstd_train_dictionary('zstd_dict_t', 'payload', 5000, 4096) > 0 AS retrained;
+INSERT INTO zstd_dict_t
+  SELECT i, '{"event":"click","user":' || i || ',"page":"/home/' || (i % 50) || '"}'
+  FROM generate_series(40001, 60000) i;
+SELECT count(*), count(DISTINCT payload), sum(length(payload)) FROM zstd_dict_t;
+SELECT attnum, dictversion FROM pg_catalog.gp_zstd_dictionary
+  WHERE relid = 'zstd_dict_t'::regclass ORDER BY dictversion;
+-- Every segment has the same dictionaries
+SELECT count(*) FROM gp_dist_random('pg_catalog.gp_zstd_dictionary')
+  WHERE relid = 'zstd_dict_t'::regclass
+  GROUP BY dictid, dictversion ORDER BY dictversion;
+
+-- Errors
+SELECT gp_zstd_train_dictionary('zstd_dict_t', 'nosuchcol');
+CREATE TABLE zstd_dict_heap (a text) DISTRIBUTED BY (a);
+SELECT gp_zstd_train_dictionary('zstd_dict_heap', 'a');
+
+-- Dropping the table removes its dictionaries
+SELECT dictid AS zstd_dict_id, dictversion AS zstd_dict_version, dict AS zstd_dict
+  FROM pg_catalog.gp_zstd_dictionary
+  WHERE relid = 'zstd_dict_t'::regclass ORDER BY dictversion DESC LIMIT 1 \gset
+SELECT 'zstd_dict_t'::regclass::oid AS zstd_dict_relid \gset
+DROP TABLE zstd_dict_t;
+SELECT count(*) FROM pg_catalog.gp_zstd_dictionary WHERE relid = :zstd_dict_relid;
+SELECT count(*) FROM gp_dist_random('pg_catalog.gp_zstd_dictionary') WHERE relid = :zstd_dict_relid;
+DROP TABLE zstd_dict_heap;
+
+-- pg_dump restores a dictionary with gp_zstd_store_dictionary(), which keeps
+-- the ID recorded in it
+CREATE TABLE zstd_dict_t (id int, payload text)
+  WITH (appendonly=true, orientation=column, compresstype=zstd, compresslevel=3)
+  DISTRIBUTED BY (id);
+SELECT gp_zstd_store_dictionary('zstd_dict_t', 'payload', :zstd_dict_version, :'zstd_dict');
+SELECT dictid = :zstd_dict_id AS same_id, dictversion FROM gp_dist_random('pg_catalog.gp_zstd_dictionary')
+  WHERE relid = 'zstd_dict_t'::regclass;
+INSERT INTO zstd_dict_t
+  SELECT i, '{"event":"click","user":' || i || ',"page":"/home/' || (i % 50) || '"}'
+  FROM generate_series(1, 20000) i;
+SELECT count(*), count(DISTINCT payload), sum(length(payload)) FROM zstd_dict_t;
+DROP TABLE zstd_dict_t;
@@ -11,25 +11,54 @@
 #include "postgres.h"
 
 #include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/table.h"
+#include "catalog/indexing.h"
+#include "catalog/namespace.h"
 #include "catalog/pg_compression.h"
+#include "catalog/pg_namespace.h"
+#include "catalog/pg_type.h"
+#include "cdb/cdbdisp_query.h"
+#include "cdb/cdbvars.h"
+#include "commands/event_trigger.h"
+#include "executor/spi.h"
 #include "fmgr.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
 #include "storage/gp_compress.h"
+#include "storage/lmgr.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
 
 #include <zstd.h>
 #include <zstd_errors.h>
+#include <zdict.h>
 
 Datum		zstd_constructor(PG_FUNCTION_ARGS);
 Datum		zstd_destructor(PG_FUNCTION_ARGS);
 Datum		zstd_compress(PG_FUNCTION_ARGS);
 Datum		zstd_decompress(PG_FUNCTION_ARGS);
 Datum		zstd_validator(PG_FUNCTION_ARGS);
+Datum		zstd_train_dictionary(PG_FUNCTION_ARGS);
+Datum		zstd_store_dictionary(PG_FUNCTION_ARGS);
+Datum		zstd_remove_dictionaries(PG_FUNCTION_ARGS);
+Datum		zstd_drop_dictionaries(PG_FUNCTION_ARGS);
 
 PG_FUNCTION_INFO_V1(zstd_constructor);
 PG_FUNCTION_INFO_V1(zstd_destructor);
 PG_FUNCTION_INFO_V1(zstd_compress);
 PG_FUNCTION_INFO_V1(zstd_decompress);
 PG_FUNCTION_INFO_V1(zstd_validator);
+PG_FUNCTION_INFO_V1(zstd_train_dictionary);
+PG_FUNCTION_INFO_V1(zstd_store_dictionary);
+PG_FUNCTION_INFO_V1(zstd_remove_dictionaries);
+PG_FUNCTION_INFO_V1(zstd_drop_dictionaries);
 
 #ifndef UNIT_TESTING
 PG_MODULE_MAGIC;
@@ -40,15 +69,425 @@ typedef struct zstd_state
 {
 	int			level;			/* Compression level */
 	bool		compress;		/* Compress if true, decompress otherwise */
-
-	zstd_context *ctx;			/* ZSTD compression/decompresion contexts */
+	ZSTD_CDict *cdict;			/* Column dictionary to compress with, if any */
 } zstd_state;
 
+/*
+ * Trained dictionaries.
+ *
+ * gp_zstd_train_dictionary() trains a dictionary for one column of an AOCS
+ * table from a sample of its values, and stores it in the
+ * pg_catalog.gp_zstd_dictionary table on the coordinator and every segment.
+ * The table is created by zstd_compression.sql in every database, and like a
+ * catalog it has no distribution policy, so each node reads its own copy.
+ * Blocks of that column written afterwards are compressed with the latest
+ * dictionary version of the column, which helps short blocks that would
+ * otherwise start every frame without any history.
+ *
+ * Every zstd frame compressed with a dictionary records the dictionary's ID,
+ * so decompression finds the dictionary through the frame alone.  Retraining
+ * adds a new version with a new ID and leaves the old ones in place for the
+ * blocks that were compressed with them.  Since the content of a dictionary
+ * never changes once its ID is assigned, the digested dictionaries are
+ * cached for the life of the backend.
+ *
+ * The gp_zstd_drop_dictionaries event trigger removes the dictionaries of a
+ * table when it is dropped, and pg_dump restores them with
+ * gp_zstd_store_dictionary().
+ */
+
+/* zstd reserves dictionary IDs below 32768 and from 2^31 up */
+#define ZSTD_MIN_USER_DICTID		32768
+
+/* pg_catalog.gp_zstd_dictionary, see zstd_compression.sql */
+#define ZSTD_DICTIONARY_TABLE		"gp_zstd_dictionary"
+#define ZSTD_DICTIONARY_DICTID_INDEX	"gp_zstd_dictionary_dictid_index"
+#define ZSTD_DICTIONARY_COLUMN_INDEX	"gp_zstd_dictionary_relid_attnum_dictversion_index"
+
+#define Natts_gp_zstd_dictionary			5
+#define Anum_gp_zstd_dictionary_dictid		1
+#define Anum_gp_zstd_dictionary_relid		2
+#define Anum_gp_zstd_dictionary_attnum		3
+#define Anum_gp_zstd_dictionary_dictversion	4
+#define Anum_gp_zstd_dictionary_dict		5
+
+typedef struct ZstdCDictKey
+{
+	uint32		dictid;
+	int			level;
+} ZstdCDictKey;
+
+typedef struct ZstdCDictEntry
+{
+	ZstdCDictKey key;
+	ZSTD_CDict *cdict;
+} ZstdCDictEntry;
+
+typedef struct ZstdDDictEntry
+{
+	uint32		dictid;
+	ZSTD_DDict *ddict;
+} ZstdDDictEntry;
+
+static HTAB *zstd_cdict_cache = NULL;
+static HTAB *zstd_ddict_cache = NULL;
+
+/*
+ * ZSTD compression/decompression contexts, shared by all the streams of the
+ * backend.  Every block is compressed into a frame of its own, so nothing
+ * carries over from one call to the next, and one column-oriented table with
+ * hundreds of columns, or an insert into hundreds of partitions, doesn't need
+ * a context per column.  They are kept for the life of the backend.
+ */
+static ZSTD_CCtx *zstd_shared_cctx = NULL;
+static ZSTD_DCtx *zstd_shared_dctx = NULL;
+
+static ZSTD_CCtx *
+zstd_get_cctx(void)
+{
+	if (zstd_shared_cctx == NULL)
+	{
+		zstd_shared_cctx = ZSTD_createCCtx();
+		if (!zstd_shared_cctx)
+			elog(ERROR, "out of memory");
+	}
+	return zstd_shared_cctx;
+}
+
+static ZSTD_DCtx *
+zstd_get_dctx(void)
+{
+	if (zstd_shared_dctx == NULL)
+	{
+		zstd_shared_dctx = ZSTD_createDCtx();
+		if (!zstd_shared_dctx)
+			elog(ERROR, "out of memory");
+	}
+	return zstd_shared_dctx;
+}
+
+/*
+ * Return the ID and the version of the latest dictionary of a column, or 0
+ * if the column has none.
+ */
+static uint32
+zstd_current_dictid(Oid relid, AttrNumber attnum, int32 *dictversion)
+{
+	Oid			dictrelid = get_relname_relid(ZSTD_DICTIONARY_TABLE, PG_CATALOG_NAMESPACE);
+	Relation	rel;
+	ScanKeyData keys[2];
+	SysScanDesc scan;
+	HeapTuple	tuple;
+	uint32		result = 0;
+
+	*dictversion = 0;
+
+	/* No dictionaries in a database created before they were added */
+	if (!OidIsValid(dictrelid))
+		return 0;
+
+	ScanKeyInit(&keys[0],
+				Anum_gp_zstd_dictionary_relid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(relid));
+	ScanKeyInit(&keys[1],
+				Anum_gp_zstd_dictionary_attnum,
+				BTEqualStrategyNumber, F_INT2EQ,
+				Int16GetDatum(attnum));
+
+	rel = table_open(dictrelid, AccessShareLock);
+	scan = systable_beginscan(rel,
+							  get_relname_relid(ZSTD_DICTIONARY_COLUMN_INDEX,
+												PG_CATALOG_NAMESPACE),
+							  true, NULL, 2, keys);
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		bool		isnull;
+		int32		version;
+
+		version = DatumGetInt32(heap_getattr(tuple, Anum_gp_zstd_dictionary_dictversion,
+											 RelationGetDescr(rel), &isnull));
+		if (version > *dictversion)
+		{
+			*dictversion = version;
+			result = (uint32) DatumGetInt32(heap_getattr(tuple, Anum_gp_zstd_dictionary_dictid,
+														 RelationGetDescr(rel), &isnull));
+		}
+	}
+	systable_endscan(scan);
+	table_close(rel, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * Fetch the content of a dictionary by ID, or NULL if there is none.
+ */
+static bytea *
+zstd_fetch_dictionary(uint32 dictid)
+{
+	Oid			dictrelid = get_relname_relid(ZSTD_DICTIONARY_TABLE, PG_CATALOG_NAMESPACE);
+	Relation	rel;
+	ScanKeyData key;
+	SysScanDesc scan;
+	HeapTuple	tuple;
+	bytea	   *dict = NULL;
+
+	if (!OidIsValid(dictrelid))
+		return NULL;
+
+	ScanKeyInit(&key,
+				Anum_gp_zstd_dictionary_dictid,
+				BTEqualStrategyNumber, F_INT4EQ,
+				Int32GetDatum((int32) dictid));
+
+	rel = table_open(dictrelid, AccessShareLock);
+	scan = systable_beginscan(rel,
+							  get_relname_relid(ZSTD_DICTIONARY_DICTID_INDEX,
+												PG_CATALOG_NAMESPACE),
+							  true, NULL, 1, &key);
+	tuple = systable_getnext(scan);
+	if (HeapTupleIsValid(tuple))
+	{
+		bool		isnull;
+		Datum		d;
+
+		d = heap_getattr(tuple, Anum_gp_zstd_dictionary_dict,
+						 RelationGetDescr(rel), &isnull);
+		if (isnull)
+			elog(ERROR, "zstd dictionary %u is null", dictid);
+		dict = DatumGetByteaPCopy(d);
+	}
+	systable_endscan(scan);
+	table_close(rel, AccessShareLock);
+
+	return dict;
+}
+
+static ZSTD_CDict *
+zstd_get_cdict(uint32 dictid, int level)
+{
+	ZstdCDictKey key;
+	ZstdCDictEntry *entry;
+	bool		found;
+
+	if (zstd_cdict_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(ZstdCDictKey);
+		ctl.entrysize = sizeof(ZstdCDictEntry);
+		ctl.hcxt = TopMemoryContext;
+		zstd_cdict_cache = hash_create("zstd compression dictionaries", 16, &ctl,
+									   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.dictid = dictid;
+	key.level = level;
+	entry = hash_search(zstd_cdict_cache, &key, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		bytea	   *dict = zstd_fetch_dictionary(dictid);
+		ZSTD_CDict *cdict;
+
+		if (dict == NULL)
+			elog(ERROR, "zstd dictionary %u does not exist", dictid);
+
+		cdict = ZSTD_createCDict(VARDATA_ANY(dict), VARSIZE_ANY_EXHDR(dict), level);
+		pfree(dict);
+		if (cdict == NULL)
+			elog(ERROR, "could not load zstd dictionary %u", dictid);
+
+		entry = hash_search(zstd_cdict_cache, &key, HASH_ENTER, &found);
+		entry->cdict = cdict;
+	}
+
+	return entry->cdict;
+}
+
+static ZSTD_DDict *
+zstd_get_ddict(uint32 dictid)
+{
+	ZstdDDictEntry *entry;
+	bool		found;
+
+	if (zstd_ddict_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(uint32);
+		ctl.entrysize = sizeof(ZstdDDictEntry);
+		ctl.hcxt = TopMemoryContext;
+		zstd_ddict_cache = hash_create("zstd decompression dictionaries", 16, &ctl,
+									   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = hash_search(zstd_ddict_cache, &dictid, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		bytea	   *dict = zstd_fetch_dictionary(dictid);
+		ZSTD_DDict *ddict;
+
+		if (dict == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("zstd dictionary %u needed to decompress a block does not exist",
+							dictid)));
+
+		ddict = ZSTD_createDDict(VARDATA_ANY(dict), VARSIZE_ANY_EXHDR(dict));
+		pfree(dict);
+		if (ddict == NULL)
+			elog(ERROR, "could not load zstd dictionary %u", dictid);
+
+		entry = hash_search(zstd_ddict_cache, &dictid, HASH_ENTER, &found);
+		entry->ddict = ddict;
+	}
+
+	return entry->ddict;
+}
+
+/*
+ * Check that a column can have a dictionary, and return its number.
+ */
+static AttrNumber
+zstd_dictionary_column(Oid relid, const char *attname)
+{
+	Relation	rel;
+	AttrNumber	attnum;
+
+	rel = table_open(relid, AccessShareLock);
+	if (!RelationIsAoCols(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not an append-optimized column-oriented table",
+						RelationGetRelationName(rel))));
+	attnum = get_attnum(relid, attname);
+	if (attnum <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("column \"%s\" of relation \"%s\" does not exist",
+						attname, RelationGetRelationName(rel))));
+	table_close(rel, NoLock);
+
+	return attnum;
+}
+
+/*
+ * Store a dictionary for a column on this node and, on the coordinator, on
+ * every segment.  The ID is the one recorded in the dictionary itself, so
+ * that a restored dictionary keeps the ID its frames refer to.
+ */
+static uint32
+zstd_store_dictionary_guts(Oid relid, AttrNumber attnum, int32 dictversion,
+						   bytea *dict)
+{
+	Oid			dictrelid = get_relname_relid(ZSTD_DICTIONARY_TABLE, PG_CATALOG_NAMESPACE);
+	uint32		dictid;
+	Relation	dictrel;
+	Datum		values[Natts_gp_zstd_dictionary];
+	bool		nulls[Natts_gp_zstd_dictionary] = {false};
+	HeapTuple	tuple;
+
+	if (!OidIsValid(dictrelid))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_TABLE),
+				 errmsg("relation \"pg_catalog.%s\" does not exist", ZSTD_DICTIONARY_TABLE)));
+
+	dictid = ZDICT_getDictID(VARDATA_ANY(dict), VARSIZE_ANY_EXHDR(dict));
+	if (dictid < ZSTD_MIN_USER_DICTID || dictid > PG_INT32_MAX)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("not a trained zstd dictionary")));
+
+	/* The unique indexes reject a duplicate ID or version */
+	dictrel = table_open(dictrelid, RowExclusiveLock);
+	values[Anum_gp_zstd_dictionary_dictid - 1] = Int32GetDatum((int32) dictid);
+	values[Anum_gp_zstd_dictionary_relid - 1] = ObjectIdGetDatum(relid);
+	values[Anum_gp_zstd_dictionary_attnum - 1] = Int16GetDatum(attnum);
+	values[Anum_gp_zstd_dictionary_dictversion - 1] = Int32GetDatum(dictversion);
+	values[Anum_gp_zstd_dictionary_dict - 1] = PointerGetDatum(dict);
+	tuple = heap_form_tuple(RelationGetDescr(dictrel), values, nulls);
+	CatalogTupleInsert(dictrel, tuple);
+	heap_freetuple(tuple);
+	table_close(dictrel, NoLock);
+
+	if (Gp_role == GP_ROLE_DISPATCH)
+	{
+		StringInfoData query;
+		char	   *dictout;
+
+		dictout = DatumGetCString(DirectFunctionCall1(byteaout, PointerGetDatum(dict)));
+
+		initStringInfo(&query);
+		appendStringInfo(&query,
+						 "SELECT pg_catalog.gp_zstd_store_dictionary('%u'::pg_catalog.regclass, %s, %d, %s::pg_catalog.bytea)",
+						 relid,
+						 quote_literal_cstr(get_attname(relid, attnum, false)),
+						 dictversion,
+						 quote_literal_cstr(dictout));
+
+		CdbDispatchCommand(query.data,
+						   DF_CANCEL_ON_ERROR |
+						   DF_NEED_TWO_PHASE |
+						   DF_WITH_SNAPSHOT,
+						   NULL);
+	}
+
+	return dictid;
+}
+
+/*
+ * Remove the dictionaries of the given tables on this node, skipping the
+ * tables that still exist.  Returns the number of dictionaries removed.
+ */
+static int
+zstd_remove_dictionaries_guts(Oid *relids, int nrelids)
+{
+	Oid			dictrelid = get_relname_relid(ZSTD_DICTIONARY_TABLE, PG_CATALOG_NAMESPACE);
+	Oid			indexid;
+	Relation	rel;
+	int			nremoved = 0;
+
+	if (!OidIsValid(dictrelid) || nrelids == 0)
+		return 0;
+
+	indexid = get_relname_relid(ZSTD_DICTIONARY_COLUMN_INDEX, PG_CATALOG_NAMESPACE);
+	rel = table_open(dictrelid, RowExclusiveLock);
+	for (int i = 0; i < nrelids; i++)
+	{
+		ScanKeyData key;
+		SysScanDesc scan;
+		HeapTuple	tuple;
+
+		if (SearchSysCacheExists1(RELOID, ObjectIdGetDatum(relids[i])))
+			continue;
+
+		ScanKeyInit(&key,
+					Anum_gp_zstd_dictionary_relid,
+					BTEqualStrategyNumber, F_OIDEQ,
+					ObjectIdGetDatum(relids[i]));
+		scan = systable_beginscan(rel, indexid, true, NULL, 1, &key);
+		while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+		{
+			CatalogTupleDelete(rel, &tuple->t_self);
+			nremoved++;
+		}
+		systable_endscan(scan);
+	}
+	table_close(rel, RowExclusiveLock);
+
+	return nremoved;
+}
+
 Datum
 zstd_constructor(PG_FUNCTION_ARGS)
 {
-	/* PG_GETARG_POINTER(0) is TupleDesc that is currently unused. */
-
+	/*
+	 * PG_GETARG_POINTER(0) is a TupleDesc. When compressing a column of an
+	 * AOCS table, it describes just that column.
+	 */
+	TupleDesc	tupdesc = (TupleDesc) PG_GETARG_POINTER(0);
 	StorageAttributes *sa = (StorageAttributes *) PG_GETARG_POINTER(1);
 	CompressionState *cs = palloc0(sizeof(CompressionState));
 	zstd_state *state = palloc0(sizeof(zstd_state));
@@ -66,14 +505,20 @@ zstd_constructor(PG_FUNCTION_ARGS)
 	state->level = sa->complevel;
 	state->compress = compress;
 
-	state->ctx = zstd_alloc_context();
-	state->ctx->cctx = ZSTD_createCCtx();
-	state->ctx->dctx = ZSTD_createDCtx();
+	/*
+	 * Use the column's trained dictionary, if it has one. Decompression
+	 * finds the dictionary of each frame by itself.
+	 */
+	if (compress && tupdesc != NULL && tupdesc->natts == 1)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, 0);
+		int32		dictversion;
+		uint32		dictid = zstd_current_dictid(attr->attrelid, attr->attnum,
+												 &dictversion);
 
-	if (!state->ctx->cctx)
-		elog(ERROR, "out of memory");
-	if (!state->ctx->dctx)
-		elog(ERROR, "out of memory");
+		if (dictid != 0)
+			state->cdict = zstd_get_cdict(dictid, state->level);
+	}
 
 	PG_RETURN_POINTER(cs);
 }
@@ -85,10 +530,7 @@ zstd_destructor(PG_FUNCTION_ARGS)
 
 	if (cs != NULL && cs->opaque != NULL)
 	{
-		zstd_state *state = (zstd_state *) cs->opaque;
-
-		zstd_free_context(state->ctx);
-		pfree(state);
+		pfree(cs->opaque);
 	}
 
 	PG_RETURN_VOID();
@@ -114,10 +556,16 @@ zstd_compress(PG_FUNCTION_ARGS)
 
 	unsigned long dst_length_used;
 
-	dst_length_used = ZSTD_compressCCtx(state->ctx->cctx,
-										dst, dst_sz,
-										src, src_sz,
-										state->level);
+	if (state->cdict != NULL)
+		dst_length_used = ZSTD_compress_usingCDict(zstd_get_cctx(),
+												   dst, dst_sz,
+												   src, src_sz,
+												   state->cdict);
+	else
+		dst_length_used = ZSTD_compressCCtx(zstd_get_cctx(),
+											dst, dst_sz,
+											src, src_sz,
+											state->level);
 
 	if (ZSTD_isError(dst_length_used))
 	{
@@ -148,19 +596,28 @@ zstd_decompress(PG_FUNCTION_ARGS)
 	void	   *dst = PG_GETARG_POINTER(2);
 	int32		dst_sz = PG_GETARG_INT32(3);
 	int32	   *dst_used = (int32 *) PG_GETARG_POINTER(4);
-	CompressionState *cs = (CompressionState *) PG_GETARG_POINTER(5);
-	zstd_state *state = (zstd_state *) cs->opaque;
+
+	/* PG_GETARG_POINTER(5) is the CompressionState, unused here. */
 
 	unsigned long dst_length_used;
+	unsigned	dictid;
 
 	if (src_sz <= 0)
 		elog(ERROR, "invalid source buffer size %d", src_sz);
 	if (dst_sz <= 0)
 		elog(ERROR, "invalid destination buffer size %d", dst_sz);
 
-	dst_length_used = ZSTD_decompressDCtx(state->ctx->dctx,
-										  dst, dst_sz,
-										  src, src_sz);
+	/* Frames compressed with a trained dictionary record its ID */
+	dictid = ZSTD_getDictID_fromFrame(src, src_sz);
+	if (dictid != 0)
+		dst_length_used = ZSTD_decompress_usingDDict(zstd_get_dctx(),
+													 dst, dst_sz,
+													 src, src_sz,
+													 zstd_get_ddict(dictid));
+	else
+		dst_length_used = ZSTD_decompressDCtx(zstd_get_dctx(),
+											  dst, dst_sz,
+											  src, src_sz);
 
 	if (ZSTD_isError(dst_length_used))
 	{
@@ -177,3 +634,241 @@ zstd_validator(PG_FUNCTION_ARGS)
 {
 	PG_RETURN_VOID();
 }
+
+/*
+ * gp_zstd_train_dictionary(rel regclass, attname name, sample_rows int4,
+ *							dict_size int4) returns int4
+ *
+ * Train a dictionary for a column of an AOCS table from a random sample of
+ * up to 'sample_rows' of its non-null values, and make it the dictionary
+ * that new blocks of the column are compressed with.  The column must use
+ * compresstype=zstd for the dictionary to have any effect.  Returns the ID
+ * of the new dictionary.
+ */
+Datum
+zstd_train_dictionary(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	Name		attname = PG_GETARG_NAME(1);
+	int32		sample_rows = PG_GETARG_INT32(2);
+	int32		dict_size = PG_GETARG_INT32(3);
+	AttrNumber	attnum;
+	char	   *relname;
+	StringInfoData query;
+	StringInfoData samples;
+	size_t	   *sample_sizes;
+	unsigned	nsamples = 0;
+	char	   *dict;
+	size_t		dict_len;
+	uint32		dictid;
+	int32		dictversion;
+	bytea	   *dictval;
+	int			ret;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to train zstd dictionaries")));
+
+	if (sample_rows < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("sample_rows must be positive")));
+	if (dict_size < 1024 || dict_size > 1024 * 1024)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("dict_size=%d is out of range (should be in the range 1024 to 1048576)",
+						dict_size)));
+
+	attnum = zstd_dictionary_column(relid, NameStr(*attname));
+	relname = quote_qualified_identifier(get_namespace_name(get_rel_namespace(relid)),
+										 get_rel_name(relid));
+
+	/*
+	 * Collect the sample. A plain LIMIT would return the rows of whichever
+	 * segments and segfiles answer first, typically the oldest blocks, so
+	 * pick the rows at random from the whole column instead. Every segment
+	 * keeps only its top 'sample_rows' rows while it reads the column.
+	 */
+	initStringInfo(&query);
+	appendStringInfo(&query,
+					 "SELECT %s::text FROM %s WHERE %s IS NOT NULL ORDER BY random() LIMIT %d",
+					 quote_identifier(NameStr(*attname)), relname,
+					 quote_identifier(NameStr(*attname)), sample_rows);
+
+	initStringInfo(&samples);
+	sample_sizes = palloc(sample_rows * sizeof(size_t));
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+	ret = SPI_execute(query.data, true, sample_rows);
+	if (ret != SPI_OK_SELECT)
+		elog(ERROR, "SPI_execute failed: error code %d", ret);
+	for (uint64 i = 0; i < SPI_processed; i++)
+	{
+		bool		isnull;
+		Datum		value;
+		text	   *t;
+
+		value = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull);
+		if (isnull)
+			continue;
+		t = DatumGetTextPP(value);
+
+		/* samples lives in the caller's memory context, repalloc keeps it there */
+		appendBinaryStringInfo(&samples, VARDATA_ANY(t), VARSIZE_ANY_EXHDR(t));
+		sample_sizes[nsamples++] = VARSIZE_ANY_EXHDR(t);
+	}
+	SPI_finish();
+
+	/* Train */
+	dict = palloc(dict_size);
+	dict_len = ZDICT_trainFromBuffer(dict, dict_size, samples.data, sample_sizes, nsamples);
+	if (ZDICT_isError(dict_len))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("could not train zstd dictionary from %u values: %s",
+						nsamples, ZDICT_getErrorName(dict_len)),
+				 errhint("Train on a larger sample, or with a smaller dict_size.")));
+
+	/*
+	 * Pick an unused dictionary ID and the next version of the column.
+	 * Concurrent training would otherwise pick the same ones, so hold a
+	 * self-conflicting lock until commit. The ID lives at offset 4 of the
+	 * dictionary, in little-endian byte order.
+	 */
+	LockRelationOid(get_relname_relid(ZSTD_DICTIONARY_TABLE, PG_CATALOG_NAMESPACE),
+					ShareRowExclusiveLock);
+	dictid = ZDICT_getDictID(dict, dict_len);
+	while (dictid < ZSTD_MIN_USER_DICTID || dictid > PG_INT32_MAX ||
+		   zstd_fetch_dictionary(dictid) != NULL)
+		dictid = ZSTD_MIN_USER_DICTID + (uint32) (random() % (PG_INT32_MAX - ZSTD_MIN_USER_DICTID));
+	dict[4] = (char) (dictid & 0xFF);
+	dict[5] = (char) ((dictid >> 8) & 0xFF);
+	dict[6] = (char) ((dictid >> 16) & 0xFF);
+	dict[7] = (char) ((dictid >> 24) & 0xFF);
+	(void) zstd_current_dictid(relid, attnum, &dictversion);
+	dictversion++;
+
+	dictval = (bytea *) palloc(VARHDRSZ + dict_len);
+	SET_VARSIZE(dictval, VARHDRSZ + dict_len);
+	memcpy(VARDATA(dictval), dict, dict_len);
+	zstd_store_dictionary_guts(relid, attnum, dictversion, dictval);
+
+	PG_RETURN_INT32((int32) dictid);
+}
+
+/*
+ * gp_zstd_store_dictionary(rel regclass, attname name, dictversion int4,
+ *							dict bytea) returns void
+ *
+ * Store a dictionary trained earlier for a column, with the ID recorded in
+ * it.  This is how pg_dump restores the dictionaries of a table, and how the
+ * coordinator passes a new dictionary on to the segments.
+ */
+Datum
+zstd_store_dictionary(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	Name		attname = PG_GETARG_NAME(1);
+	int32		dictversion = PG_GETARG_INT32(2);
+	bytea	   *dict = PG_GETARG_BYTEA_P(3);
+	AttrNumber	attnum;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to store zstd dictionaries")));
+
+	attnum = zstd_dictionary_column(relid, NameStr(*attname));
+	zstd_store_dictionary_guts(relid, attnum, dictversion, dict);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * gp_zstd_remove_dictionaries(relids oid[]) returns void
+ *
+ * Remove the dictionaries of dropped tables.  The coordinator calls this on
+ * the segments from the gp_zstd_drop_dictionaries event trigger.  The
+ * dictionaries of tables that still exist are left alone.
+ */
+Datum
+zstd_remove_dictionaries(PG_FUNCTION_ARGS)
+{
+	ArrayType  *arr = PG_GETARG_ARRAYTYPE_P(0);
+	Datum	   *elems;
+	bool	   *elemnulls;
+	int			nelems;
+	Oid		   *relids;
+	int			nrelids = 0;
+
+	deconstruct_array(arr, OIDOID, sizeof(Oid), true, TYPALIGN_INT,
+					  &elems, &elemnulls, &nelems);
+	relids = palloc(nelems * sizeof(Oid));
+	for (int i = 0; i < nelems; i++)
+	{
+		if (!elemnulls[i])
+			relids[nrelids++] = DatumGetObjectId(elems[i]);
+	}
+
+	(void) zstd_remove_dictionaries_guts(relids, nrelids);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * gp_zstd_drop_dictionaries() returns event_trigger
+ *
+ * sql_drop event trigger that removes the dictionaries of the dropped tables,
+ * here and on the segments.
+ */
+Datum
+zstd_drop_dictionaries(PG_FUNCTION_ARGS)
+{
+	Oid		   *relids;
+	int			nrelids = 0;
+	int			ret;
+
+	if (!CALLED_AS_EVENT_TRIGGER(fcinfo))
+		elog(ERROR, "not fired by event trigger manager");
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+	ret = SPI_execute("SELECT objid FROM pg_catalog.pg_event_trigger_dropped_objects() "
+					  "WHERE classid = 'pg_catalog.pg_class'::pg_catalog.regclass AND objsubid = 0",
+					  true, 0);
+	if (ret != SPI_OK_SELECT)
+		elog(ERROR, "SPI_execute failed: error code %d", ret);
+	relids = (Oid *) SPI_palloc(Max(SPI_processed, 1) * sizeof(Oid));
+	for (uint64 i = 0; i < SPI_processed; i++)
+	{
+		bool		isnull;
+
+		relids[nrelids++] = DatumGetObjectId(SPI_getbinval(SPI_tuptable->vals[i],
+														   SPI_tuptable->tupdesc,
+														   1, &isnull));
+	}
+	SPI_finish();
+
+	/* The segments have the same dictionaries, skip them if there were none */
+	if (zstd_remove_dictionaries_guts(relids, nrelids) > 0 &&
+		Gp_role == GP_ROLE_DISPATCH)
+	{
+		StringInfoData query;
+
+		initStringInfo(&query);
+		appendStringInfoString(&query, "SELECT pg_catalog.gp_zstd_remove_dictionaries('{");
+		for (int i = 0; i < nrelids; i++)
+			appendStringInfo(&query, "%s%u", i > 0 ? "," : "", relids[i]);
+		appendStringInfoString(&query, "}'::pg_catalog.oid[])");
+
+		CdbDispatchCommand(query.data,
+						   DF_CANCEL_ON_ERROR |
+						   DF_NEED_TWO_PHASE |
+						   DF_WITH_SNAPSHOT,
+						   NULL);
+	}
+
+	PG_RETURN_NULL();
+}
@@ -20,3 +20,35 @@ COMMENT ON FUNCTION gp_zstd_validator(internal) IS 'zstdcompression validator';
 
 INSERT INTO pg_catalog.pg_compression (compname, compconstructor, compdestructor, compcompressor, compdecompressor, compvalidator, compowner)
 VALUES ('zstd', 'gp_zstd_constructor', 'gp_zstd_destructor', 'gp_zstd_compress', 'gp_zstd_decompress', 'gp_zstd_validator', 10 /* BOOTSTRAP_SUPERUSERID */);
+
+-- Trained dictionaries. Like a catalog, the table has no distribution policy:
+-- the coordinator and every segment keep the same rows, and read their own.
+CREATE TABLE gp_zstd_dictionary (
+	dictid int4 NOT NULL,
+	relid oid NOT NULL,
+	attnum int2 NOT NULL,
+	dictversion int4 NOT NULL,
+	dict bytea NOT NULL,
+	CONSTRAINT gp_zstd_dictionary_dictid_index PRIMARY KEY (dictid),
+	CONSTRAINT gp_zstd_dictionary_relid_attnum_dictversion_index UNIQUE (relid, attnum, dictversion)
+);
+COMMENT ON TABLE gp_zstd_dictionary IS 'zstd dictionaries trained for columns of append-optimized column-oriented tables';
+
+CREATE FUNCTION gp_zstd_store_dictionary(rel regclass, attname name, dictversion int4, dict bytea) RETURNS void
+LANGUAGE C VOLATILE STRICT AS '$libdir/gp_zstd_compression.so', 'zstd_store_dictionary';
+COMMENT ON FUNCTION gp_zstd_store_dictionary(regclass, name, int4, bytea) IS 'store a trained zstd dictionary for a column, used by pg_dump';
+
+CREATE FUNCTION gp_zstd_remove_dictionaries(relids oid[]) RETURNS void
+LANGUAGE C VOLATILE STRICT AS '$libdir/gp_zstd_compression.so', 'zstd_remove_dictionaries';
+COMMENT ON FUNCTION gp_zstd_remove_dictionaries(oid[]) IS 'remove the zstd dictionaries of dropped tables';
+
+CREATE FUNCTION gp_zstd_drop_dictionaries() RETURNS event_trigger
+LANGUAGE C VOLATILE AS '$libdir/gp_zstd_compression.so', 'zstd_drop_dictionaries';
+COMMENT ON FUNCTION gp_zstd_drop_dictionaries() IS 'remove the zstd dictionaries of dropped tables';
+
+CREATE EVENT TRIGGER gp_zstd_drop_dictionaries ON sql_drop
+EXECUTE FUNCTION gp_zstd_drop_dictionaries();
+
+CREATE FUNCTION gp_zstd_train_dictionary(rel regclass, attname name, sample_rows int4 DEFAULT 10000, dict_size int4 DEFAULT 32768) RETURNS int4
+LANGUAGE C VOLATILE STRICT EXECUTE ON COORDINATOR AS '$libdir/gp_zstd_compression.so', 'zstd_train_dictionary';
+COMMENT ON FUNCTION gp_zstd_train_dictionary(regclass, name, int4, int4) IS 'train a zstd dictionary for a column of an append-optimized column-oriented table';
@@ -0,0 +1,479 @@
+/*------------------------------------------------------------------------------
+ *
+ * aocs_codec_advisor.c
+ *	  Recommend per-column compression settings for AOCS tables.
+ *
+ * gp_aocs_recommend_encoding() samples rows from a column-oriented table,
+ * lays each column out the way the datum stream writer does (one varblock
+ * per 'blocksize' bytes of datums), and trial-compresses those blocks with
+ * every compresstype/compresslevel candidate that is available in this
+ * build.  One row is returned per column and candidate, with the achieved
+ * compression ratio and the time spent compressing and decompressing; the
+ * candidate we would pick for the column is flagged as recommended.
+ *
+ * The function only advises.  It is up to the user to apply the result,
+ * e.g. by recreating the table with the suggested column ENCODING clauses.
+ *
+ * Copyright (c) 2023, HashData Technology Limited.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/access/aocs/aocs_codec_advisor.c
+ *
+ *------------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/table.h"
+#include "catalog/gp_indexing.h"
+#include "catalog/indexing.h"
+#include "catalog/pg_attribute_encoding.h"
+#include "catalog/pg_compression.h"
+#include "executor/spi.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/tuplestore.h"
+
+/*
+ * Candidate encodings, tried in this order.  Entries that are not supported
+ * by this build, or whose compresstype is not registered in pg_compression
+ * (e.g. zstd when gpcontrib/zstd is not installed), are skipped.
+ */
+typedef struct CodecCandidate
+{
+	const char *compresstype;
+	int			compresslevel;
+} CodecCandidate;
+
+static const CodecCandidate codec_candidates[] = {
+	{"zlib", 1},
+	{"zlib", 5},
+	{"zlib", 9},
+	{"zstd", 1},
+	{"zstd", 3},
+	{"zstd", 9},
+	{"lz4", 1},
+	{"lz4", 9},
+	{"quicklz", 1},
+};
+
+/*
+ * Don't recommend compression that saves less than this.  Below it, the CPU
+ * spent decompressing on every scan buys almost no I/O.
+ */
+#define CODEC_MIN_USEFUL_RATIO		1.1
+
+/*
+ * Candidates whose compressed size is within this fraction of the smallest
+ * one are considered equally good, and the fastest to decompress among them
+ * wins.
+ */
+#define CODEC_SIZE_TOLERANCE		0.05
+
+#define CODEC_ADVISOR_NCOLUMNS		8
+
+/* Result of trying one candidate on one column */
+typedef struct CodecTrial
+{
+	const char *compresstype;
+	int			compresslevel;
+	int64		compressed_size;
+	double		compress_ms;
+	double		decompress_ms;
+} CodecTrial;
+
+static bool
+compresstype_is_installed(const char *compresstype)
+{
+	Relation	comprel;
+	ScanKeyData scankey;
+	SysScanDesc scan;
+	NameData	compname;
+	bool		found;
+
+	if (!compresstype_is_valid((char *) compresstype))
+		return false;
+
+	namestrcpy(&compname, compresstype);
+
+	comprel = table_open(CompressionRelationId, AccessShareLock);
+	ScanKeyInit(&scankey,
+				Anum_pg_compression_compname,
+				BTEqualStrategyNumber, F_NAMEEQ,
+				NameGetDatum(&compname));
+	scan = systable_beginscan(comprel, CompressionCompnameIndexId, true,
+							  NULL, 1, &scankey);
+	found = HeapTupleIsValid(systable_getnext(scan));
+	systable_endscan(scan);
+	table_close(comprel, AccessShareLock);
+
+	return found;
+}
+
+/*
+ * Append one datum to a column's byte stream, in the form the datum stream
+ * writer would store it: fixed-length values as-is, varlenas detoasted (the
+ * writer stores short headers, which is what PG_DETOAST_DATUM_PACKED gives
+ * us), and cstrings including the terminator.
+ */
+static void
+append_datum_bytes(StringInfo buf, Datum value, Form_pg_attribute attr)
+{
+	if (attr->attbyval)
+	{
+		Datum		tmp = value;
+		char		bytes[sizeof(Datum)];
+
+		store_att_byval(bytes, tmp, attr->attlen);
+		appendBinaryStringInfo(buf, bytes, attr->attlen);
+	}
+	else if (attr->attlen > 0)
+		appendBinaryStringInfo(buf, DatumGetPointer(value), attr->attlen);
+	else if (attr->attlen == -1)
+	{
+		struct varlena *v = PG_DETOAST_DATUM_PACKED(value);
+
+		appendBinaryStringInfo(buf, (char *) v, VARSIZE_ANY(v));
+		if ((Pointer) v != DatumGetPointer(value))
+			pfree(v);
+	}
+	else
+	{
+		char	   *s = DatumGetCString(value);
+
+		appendBinaryStringInfo(buf, s, strlen(s) + 1);
+	}
+}
+
+/*
+ * Compress 'data' in blocks of 'blocksize' bytes with the given candidate,
+ * decompress each block again to check the round trip, and fill in 'trial'.
+ * Blocks that don't shrink are counted at their original size, as the
+ * storage layer would store them uncompressed.
+ */
+static void
+trial_compress(CodecTrial *trial, const char *data, int64 len, int32 blocksize,
+			   Oid typid)
+{
+	PGFunction *funcs;
+	StorageAttributes sa;
+	CompressionState *ccs;
+	CompressionState *dcs;
+	char	   *cbuf;
+	char	   *dbuf;
+	int32		cbufsize;
+	instr_time	compress_time;
+	instr_time	decompress_time;
+
+	funcs = GetCompressionImplementation((char *) trial->compresstype);
+
+	sa.comptype = (char *) trial->compresstype;
+	sa.complevel = trial->compresslevel;
+	sa.blocksize = blocksize;
+	sa.typid = typid;
+
+	ccs = callCompressionConstructor(funcs[COMPRESSION_CONSTRUCTOR], NULL, &sa, true);
+	dcs = callCompressionConstructor(funcs[COMPRESSION_CONSTRUCTOR], NULL, &sa, false);
+
+	cbufsize = blocksize;
+	if (ccs->desired_sz != NULL)
+		cbufsize = Max(cbufsize, (int32) ccs->desired_sz(blocksize));
+	cbuf = palloc(cbufsize);
+	dbuf = palloc(blocksize);
+
+	INSTR_TIME_SET_ZERO(compress_time);
+	INSTR_TIME_SET_ZERO(decompress_time);
+	trial->compressed_size = 0;
+
+	for (int64 off = 0; off < len; off += blocksize)
+	{
+		int32		src_sz = (int32) Min(len - off, (int64) blocksize);
+		int32		dst_used = 0;
+		int32		decompressed = 0;
+		instr_time	start;
+		instr_time	end;
+
+		CHECK_FOR_INTERRUPTS();
+
+		INSTR_TIME_SET_CURRENT(start);
+		callCompressionActuator(funcs[COMPRESSION_COMPRESS], data + off, src_sz,
+								cbuf, cbufsize, &dst_used, ccs);
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(compress_time, end, start);
+
+		if (dst_used <= 0 || dst_used >= src_sz)
+		{
+			trial->compressed_size += src_sz;
+			continue;
+		}
+		trial->compressed_size += dst_used;
+
+		INSTR_TIME_SET_CURRENT(start);
+		callCompressionActuator(funcs[COMPRESSION_DECOMPRESS], cbuf, dst_used,
+								dbuf, blocksize, &decompressed, dcs);
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(decompress_time, end, start);
+
+		if (decompressed != src_sz || memcmp(dbuf, data + off, src_sz) != 0)
+			elog(ERROR, "%s level %d did not round-trip a %d byte block",
+				 trial->compresstype, trial->compresslevel, src_sz);
+	}
+
+	trial->compress_ms = INSTR_TIME_GET_MILLISEC(compress_time);
+	trial->decompress_ms = INSTR_TIME_GET_MILLISEC(decompress_time);
+
+	callCompressionDestructor(funcs[COMPRESSION_DESTRUCTOR], ccs);
+	callCompressionDestructor(funcs[COMPRESSION_DESTRUCTOR], dcs);
+	pfree(cbuf);
+	pfree(dbuf);
+	pfree(funcs);
+}
+
+/*
+ * Pick the candidate to recommend: the smallest output, unless another one
+ * is about as small and decompresses faster.  Returns -1 (i.e. "none") when
+ * nothing compresses well enough to be worth it.
+ */
+static int
+choose_trial(CodecTrial *trials, int ntrials, int64 raw_size)
+{
+	int64		smallest = -1;
+	int			best = -1;
+
+	for (int i = 0; i < ntrials; i++)
+	{
+		if (smallest < 0 || trials[i].compressed_size < smallest)
+			smallest = trials[i].compressed_size;
+	}
+
+	if (smallest <= 0 || (double) raw_size / smallest < CODEC_MIN_USEFUL_RATIO)
+		return -1;
+
+	for (int i = 0; i < ntrials; i++)
+	{
+		if (trials[i].compressed_size > smallest * (1.0 + CODEC_SIZE_TOLERANCE))
+			continue;
+		if (best < 0 || trials[i].decompress_ms < trials[best].decompress_ms)
+			best = i;
+	}
+
+	return best;
+}
+
+/*
+ * gp_aocs_recommend_encoding(rel regclass, sample_rows int4)
+ */
+Datum
+gp_aocs_recommend_encoding(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int32		sample_rows = PG_GETARG_INT32(1);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+	Relation	rel;
+	TupleDesc	reldesc;
+	StdRdOptions **opts;
+	StringInfoData *streams;
+	StringInfoData query;
+	const CodecCandidate *candidates[lengthof(codec_candidates)];
+	int			ncandidates = 0;
+	CodecTrial *trials;
+	int			natts;
+	int		   *attnums;
+	int			nsampled;
+	int			ret;
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (sample_rows <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("sample_rows must be positive")));
+
+	rel = table_open(relid, AccessShareLock);
+
+	if (!RelationIsAoCols(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not an append-optimized column-oriented table",
+						RelationGetRelationName(rel))));
+
+	if (pg_class_aclcheck(relid, GetUserId(), ACL_SELECT) != ACLCHECK_OK)
+		aclcheck_error(ACLCHECK_NO_PRIV, get_relkind_objtype(rel->rd_rel->relkind),
+					   RelationGetRelationName(rel));
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	tupstore = tuplestore_begin_heap((rsinfo->allowedModes & SFRM_Materialize_Random) != 0,
+									 false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(oldcontext);
+
+	reldesc = RelationGetDescr(rel);
+	natts = reldesc->natts;
+	opts = RelationGetAttributeOptions(rel);
+
+	for (int i = 0; i < lengthof(codec_candidates); i++)
+	{
+		if (compresstype_is_installed(codec_candidates[i].compresstype))
+			candidates[ncandidates++] = &codec_candidates[i];
+	}
+	trials = palloc(sizeof(CodecTrial) * ncandidates);
+
+	/*
+	 * Sample the table.  The per-column byte streams are built in our own
+	 * memory context, so that they survive SPI_finish().
+	 */
+	streams = palloc(sizeof(StringInfoData) * natts);
+	for (int i = 0; i < natts; i++)
+		initStringInfo(&streams[i]);
+
+	/*
+	 * Select the live columns by name, so that the columns of the result are
+	 * not shifted by dropped ones; attnums[] maps them back.  ORDER BY
+	 * random() makes the rows a random sample of the table, rather than
+	 * the first ones of each segment.
+	 */
+	attnums = palloc(sizeof(int) * natts);
+	nsampled = 0;
+	initStringInfo(&query);
+	appendStringInfoString(&query, "SELECT ");
+	for (int i = 0; i < natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(reldesc, i);
+
+		if (attr->attisdropped)
+			continue;
+
+		if (nsampled > 0)
+			appendStringInfoString(&query, ", ");
+		appendStringInfoString(&query, quote_identifier(NameStr(attr->attname)));
+		attnums[nsampled++] = i;
+	}
+	appendStringInfo(&query, " FROM %s ORDER BY random() LIMIT %d",
+					 quote_qualified_identifier(get_namespace_name(RelationGetNamespace(rel)),
+												RelationGetRelationName(rel)),
+					 sample_rows);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	ret = SPI_execute(query.data, true, 0);
+	if (ret != SPI_OK_SELECT)
+		elog(ERROR, "SPI_execute failed: error code %d", ret);
+
+	for (uint64 row = 0; row < SPI_processed; row++)
+	{
+		HeapTuple	tuple = SPI_tuptable->vals[row];
+
+		for (int col = 0; col < nsampled; col++)
+		{
+			int			i = attnums[col];
+			Form_pg_attribute attr = TupleDescAttr(reldesc, i);
+			Datum		value;
+			bool		isnull;
+			MemoryContext spicontext;
+
+			value = heap_getattr(tuple, col + 1, SPI_tuptable->tupdesc, &isnull);
+			if (isnull)
+				continue;
+
+			spicontext = MemoryContextSwitchTo(oldcontext);
+			append_datum_bytes(&streams[i], value, attr);
+			MemoryContextSwitchTo(spicontext);
+		}
+	}
+
+	SPI_finish();
+
+	for (int i = 0; i < natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(reldesc, i);
+		StringInfo	stream = &streams[i];
+		const char *cur_type;
+		int			cur_level;
+		int32		blocksize;
+		int			best;
+		Datum		values[CODEC_ADVISOR_NCOLUMNS];
+		bool		nulls[CODEC_ADVISOR_NCOLUMNS];
+
+		if (attr->attisdropped)
+			continue;
+
+		if (opts[i] == NULL || opts[i]->blocksize == 0)
+			elog(ERROR, "could not find blocksize option for AOCO column in pg_attribute_encoding");
+		blocksize = opts[i]->blocksize;
+		cur_type = opts[i]->compresstype;
+		cur_level = opts[i]->compresslevel;
+		if (cur_type[0] == '\0' || pg_strcasecmp(cur_type, "rle_type") == 0)
+			cur_type = "none";
+
+		for (int c = 0; c < ncandidates; c++)
+		{
+			trials[c].compresstype = candidates[c]->compresstype;
+			trials[c].compresslevel = candidates[c]->compresslevel;
+			trial_compress(&trials[c], stream->data, stream->len, blocksize,
+						   attr->atttypid);
+		}
+		best = choose_trial(trials, ncandidates, stream->len);
+
+		memset(nulls, 0, sizeof(nulls));
+
+		/* the uncompressed baseline */
+		values[0] = NameGetDatum(&attr->attname);
+		values[1] = CStringGetTextDatum("none");
+		values[2] = Int32GetDatum(0);
+		values[3] = Float8GetDatum(1.0);
+		values[4] = Float8GetDatum(0.0);
+		values[5] = Float8GetDatum(0.0);
+		values[6] = BoolGetDatum(pg_strcasecmp(cur_type, "none") == 0);
+		values[7] = BoolGetDatum(best < 0);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+
+		for (int c = 0; c < ncandidates; c++)
+		{
+			CodecTrial *trial = &trials[c];
+
+			values[1] = CStringGetTextDatum(trial->compresstype);
+			values[2] = Int32GetDatum(trial->compresslevel);
+			if (trial->compressed_size > 0)
+				values[3] = Float8GetDatum((double) stream->len / trial->compressed_size);
+			else
+				values[3] = Float8GetDatum(1.0);
+			values[4] = Float8GetDatum(trial->compress_ms);
+			values[5] = Float8GetDatum(trial->decompress_ms);
+			values[6] = BoolGetDatum(pg_strcasecmp(cur_type, trial->compresstype) == 0 &&
+									 cur_level == trial->compresslevel);
+			values[7] = BoolGetDatum(best == c);
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+
+		pfree(stream->data);
+	}
+
+	table_close(rel, AccessShareLock);
+
+	return (Datum) 0;
+}
@@ -39,6 +39,8 @@
 #include "executor/executor.h"
 #include "fmgr.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
 #include "pgstat.h"
 #include "storage/procarray.h"
 #include "storage/smgr.h"
@@ -63,6 +65,7 @@ static AOCSScanDesc aocs_beginscan_internal(Relation relation,
 
 static void reorder_qual_col(AOCSScanDesc scan);
 static bool aocs_col_predicate_test(AOCSScanDesc scan, TupleTableSlot *slot, int i, bool sample_phase);
+static inline void aocs_qual_run_advance(AOCSScanDesc scan, int i, DatumStreamRead *ds);
 static bool aocs_getnext_sample(AOCSScanDesc scan, ScanDirection direction, TupleTableSlot *slot);
 static void aocs_insert_finish_guts(AOCSInsertDesc aoInsertDesc);
 
@@ -608,6 +611,9 @@ aocs_beginscan_internal(Relation relation,
 void
 aocs_rescan(AOCSScanDesc scan)
 {
+	scan->aos_count_nextseg = 0;
+	scan->aos_count_remaining = 0;
+
 	close_cur_scan_seg(scan);
 	if (scan->columnScanInfo.relationTupleDesc == NULL)
 	{
@@ -741,9 +747,50 @@ static void upgrade_datum_fetch(AOCSFetchDesc fetch, int attno, Datum values[],
 					   values, isnull, formatversion);
 }
 
+/*
+ * Return the next row of a scan that counts rows, see
+ * appendonly_scan_counts_only(). All its columns are NULL.
+ */
+static bool
+aocs_getnext_count_only(AOCSScanDesc scan, TupleTableSlot *slot)
+{
+	while (scan->aos_count_remaining <= 0)
+	{
+		AOCSFileSegInfo *seginfo;
+
+		if (scan->aos_count_nextseg >= scan->total_seg)
+			return false;
+
+		seginfo = scan->seginfo[scan->aos_count_nextseg++];
+		if (seginfo->total_tupcount <= 0 ||
+			seginfo->state == AOSEG_STATE_AWAITING_DROP)
+			continue;
+
+#ifdef FAULT_INJECTOR
+		FaultInjector_InjectFaultIfSet("ao_count_from_metadata",
+									   DDLNotSpecified,
+									   "",	/* databaseName */
+									   RelationGetRelationName(scan->rs_base.rs_rd));	/* tableName */
+#endif
+
+		scan->aos_count_remaining = seginfo->total_tupcount -
+			AppendOnlyVisimap_GetSegmentFileHiddenTupleCount(&scan->visibilityMap,
+															 seginfo->segno);
+	}
+	scan->aos_count_remaining--;
+
+	memset(slot->tts_isnull, true, slot->tts_tupleDescriptor->natts * sizeof(bool));
+	slot->tts_nvalid = slot->tts_tupleDescriptor->natts;
+
+	return true;
+}
+
 bool
 aocs_getnext(AOCSScanDesc scan, ScanDirection direction, TupleTableSlot *slot)
 {
+	if (scan->aos_count_only)
+		return aocs_getnext_count_only(scan, slot);
+
 	if (scan->aos_pushdown_qual && scan->aos_scaned_rows < scan->aos_sample_rows)
 	{
 		if (aocs_getnext_sample(scan, direction, slot))
@@ -830,6 +877,7 @@ ReadNext:
 				err = datumstreamread_advance(scan->columnScanInfo.ds[attno]);
 				Assert(err > 0);
 			}
+			aocs_qual_run_advance(scan, i, scan->columnScanInfo.ds[attno]);
 			if (!visible_pass || !predicate_pass)
 				continue; /* not break, need advance for other cols */
 
@@ -1056,6 +1104,8 @@ aocs_insert_values(AOCSInsertDesc idesc, Datum *d, bool *null, AOTupleId *aoTupl
 	Relation	rel = idesc->aoi_rel;
 	int			i;
 
+	Assert(idesc->ds != NULL);
+
 #ifdef FAULT_INJECTOR
 	FaultInjector_InjectFaultIfSet(
 								   "appendonly_insert",
@@ -1159,6 +1209,9 @@ aocs_insert_finish_guts(AOCSInsertDesc idesc)
 	Relation	rel = idesc->aoi_rel;
 	int			i;
 
+	if (idesc->ds == NULL)
+		aocs_insert_resume(idesc);
+
 	for (i = 0; i < rel->rd_att->natts; ++i)
 	{
 		datumstreamwrite_block(idesc->ds[i], &idesc->blockDirectory, i, false);
@@ -1212,6 +1265,85 @@ aocs_insert_finish(AOCSInsertDesc idesc, dlist_head *head)
 		pfree(next);
 }
 
+/*
+ * aocs_insert_suspend
+ *
+ * Write out the pending block of every column, close the column files and
+ * release the datum streams with their large write buffers.  The segment file
+ * is not given up: its pg_aocsseg entry is only updated at finish, so nothing
+ * becomes visible and no command counter increment is needed.  The block
+ * directory stays open.  Use aocs_insert_resume() to continue inserting.
+ */
+void
+aocs_insert_suspend(AOCSInsertDesc idesc)
+{
+	int			nvp = RelationGetNumberOfAttributes(idesc->aoi_rel);
+	int			i;
+
+	Assert(idesc->ds != NULL);
+
+	idesc->suspendedEofs = (int64 *) palloc(sizeof(int64) * 2 * nvp);
+
+	for (i = 0; i < nvp; ++i)
+	{
+		datumstreamwrite_block(idesc->ds[i], &idesc->blockDirectory, i, false);
+		datumstreamwrite_close_file(idesc->ds[i]);
+
+		idesc->suspendedEofs[2 * i] = idesc->ds[i]->eof;
+		idesc->suspendedEofs[2 * i + 1] = idesc->ds[i]->eofUncompress;
+	}
+
+	close_ds_write(idesc->ds, nvp);
+	pfree(idesc->ds);
+	idesc->ds = NULL;
+}
+
+/*
+ * aocs_insert_resume
+ *
+ * Reopen the column files of a descriptor closed by aocs_insert_suspend() at
+ * the end of the data written so far.
+ */
+void
+aocs_insert_resume(AOCSInsertDesc idesc)
+{
+	Relation	rel = idesc->aoi_rel;
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	int			nvp = tupdesc->natts;
+	RelFileNodeBackend rnode;
+	char	   *basepath;
+	char		fn[MAXPGPATH];
+	int32		fileSegNo;
+	int			i;
+
+	Assert(idesc->ds == NULL && idesc->suspendedEofs != NULL);
+
+	idesc->ds = (DatumStreamWrite **) palloc0(sizeof(DatumStreamWrite *) * nvp);
+	open_ds_write(rel, idesc->ds, tupdesc, idesc->checksum);
+
+	rnode.node = rel->rd_node;
+	rnode.backend = rel->rd_backend;
+	basepath = relpath(rnode, MAIN_FORKNUM);
+
+	for (i = 0; i < nvp; ++i)
+	{
+		FormatAOSegmentFileName(basepath, idesc->cur_segno, i, &fileSegNo, fn);
+		Assert(strlen(fn) + 1 <= MAXPGPATH);
+
+		datumstreamwrite_open_file(idesc->ds[i], fn,
+								   idesc->suspendedEofs[2 * i],
+								   idesc->suspendedEofs[2 * i + 1],
+								   &rnode,
+								   fileSegNo, idesc->fsInfo->formatversion);
+	}
+
+	pfree(basepath);
+	pfree(idesc->suspendedEofs);
+	idesc->suspendedEofs = NULL;
+
+	SetBlockFirstRowNums(idesc->ds, nvp, idesc->lastSequence + 1);
+}
+
 static void
 positionFirstBlockOfRange(DatumStreamFetchDesc datumStreamFetchDesc)
 {
@@ -2270,6 +2402,15 @@ aocs_col_predicate_test(AOCSScanDesc scan, TupleTableSlot *slot, int i, bool sam
 	bool predicate_pass = true;
 	int attno = scan->columnScanInfo.proj_atts[i];
 
+	/* same value as the last time we evaluated the qual, see aocs_qual_run_advance() */
+	if (scan->aos_qual_run_cache && scan->aos_qual_run_valid[i])
+	{
+		predicate_pass = scan->aos_qual_run_result[i];
+		if (predicate_pass && sample_phase)
+			++scan->aos_qual_rows[i];
+		return predicate_pass;
+	}
+
 	/*
 	 * place the current tuple into the expr context
 	 */
@@ -2290,9 +2431,54 @@ aocs_col_predicate_test(AOCSScanDesc scan, TupleTableSlot *slot, int i, bool sam
 	slot->tts_flags = orig_flag;
 	ResetExprContext(scan->aos_pushdown_econtext);
 
+	if (scan->aos_qual_run_cache)
+	{
+		scan->aos_qual_run_valid[i] = true;
+		scan->aos_qual_run_result[i] = predicate_pass;
+	}
+
 	return predicate_pass;
 }
 
+/*
+ * Called after the i'th projected column has been advanced to the next row.
+ *
+ * Inside an RLE_TYPE run, the column has the same value as in the previous
+ * row, and so has the result of a qual on that column alone. A run of
+ * thousands of equal values then costs one qual evaluation instead of
+ * thousands. Any other row forgets the result.
+ */
+static inline void
+aocs_qual_run_advance(AOCSScanDesc scan, int i, DatumStreamRead *ds)
+{
+	if (scan->aos_qual_run_cache && i < scan->aos_qual_col_num &&
+		!datumstreamread_rle_repeats_previous(ds))
+		scan->aos_qual_run_valid[i] = false;
+}
+
+static bool
+qual_refs_system_column_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var))
+		return ((Var *) node)->varattno <= 0;
+	return expression_tree_walker(node, qual_refs_system_column_walker, context);
+}
+
+/*
+ * Can the results of the pushed-down quals be reused along RLE_TYPE runs?
+ *
+ * Not if they could give another result for the same column value: when they
+ * are volatile, or look at the ctid or another system column.
+ */
+static bool
+aocs_qual_run_cacheable(List *qual)
+{
+	return !contain_volatile_functions((Node *) qual) &&
+		!qual_refs_system_column_walker((Node *) qual, NULL);
+}
+
 static void
 move_attr_forward(AOCSScanDesc scan, int attrno, int pos)
 {
@@ -2348,9 +2534,14 @@ aocs_predicate_pushdown_prepare(AOCSScanDesc scan,
 	scan->aos_sample_rows       = gp_predicate_pushdown_sample_rows;
 	scan->aos_scaned_rows       = 0;
 	scan->aos_qual_rows         = (int *)palloc0(sizeof(int) * ncol);
+	scan->aos_qual_run_valid    = (bool *)palloc0(sizeof(bool) * ncol);
+	scan->aos_qual_run_result   = (bool *)palloc0(sizeof(bool) * ncol);
+	scan->aos_qual_run_cache    = false;
 
 	if (!qual)
 		return state;
+
+	scan->aos_qual_run_cache = aocs_qual_run_cacheable(qual);
 	bool *proj = palloc0(ncol * sizeof(bool));
 	int num_qual_atts = 0;
 	int *qual_atts    = palloc(ncol * sizeof(int));
@@ -2484,6 +2675,7 @@ reorder_qual_col(AOCSScanDesc scan)
 		scan->aos_qual_rows[i] = items[i].aos_qual_rows;
 		scan->columnScanInfo.proj_atts[i] = items[i].proj_atts;
 		scan->aos_pushdown_qual[i] = items[i].aos_pushdown_qual;
+		scan->aos_qual_run_valid[i] = false;
 	}
 	pfree(items);
 }
@@ -2561,6 +2753,7 @@ ReadNext:
 				err = datumstreamread_advance(scan->columnScanInfo.ds[attno]);
 				Assert(err > 0);
 			}
+			aocs_qual_run_advance(scan, i, scan->columnScanInfo.ds[attno]);
 			/* test all qual cols whatever predicate_pass is true or false */
 			if (!visible_pass || (!predicate_pass && i >= scan->aos_qual_col_num))
 				continue; /* can not break, need advance for other cols */
@@ -102,9 +102,23 @@ typedef struct AOCODMLState
 	dlist_head		head;
 	int 			insertMultiFiles;
 	List* 			used_segment_files;
+
+	/*
+	 * The insert descriptors live in insertCxt, so that their memory can be
+	 * accounted against gp_appendonly_insert_mem_limit, see
+	 * evict_insert_descriptors(). insertMem is what insertCxt held when last
+	 * measured. insertSuspended is set while the descriptors are suspended by
+	 * eviction, and lru_node links the state into aocoLocal.insertLru while
+	 * they are not.
+	 */
+	MemoryContext	insertCxt;
+	Size			insertMem;
+	bool			insertSuspended;
+	dlist_node		lru_node;
 } AOCODMLState;
 
 static void reset_state_cb(void *arg);
+static void close_insert_descriptors(AOCODMLState *state);
 /*
  * GPDB_12_MERGE_FIXME: This is a temporary state of things. A locally stored
  * state is needed currently because there is no viable place to store this
@@ -119,18 +133,26 @@ static void reset_state_cb(void *arg);
  *		a hash table which keeps per relation information
  *		a memory context that should be long lived enough and is
  *			responsible for reseting the state via its reset cb
+ *		the states with open insert descriptors, least recently used first,
+ *			and the memory they take
  */
 static struct AOCOLocal
 {
 	AOCODMLState           *last_used_state;
 	HTAB				   *dmlDescriptorTab;
 
+	dlist_head				insertLru;
+	Size					insertMem;
+
 	MemoryContext			stateCxt;
 	MemoryContextCallback	cb;
 } aocoLocal = {
 	.last_used_state  = NULL,
 	.dmlDescriptorTab = NULL,
 
+	.insertLru		  = DLIST_STATIC_INIT(aocoLocal.insertLru),
+	.insertMem		  = 0,
+
 	.stateCxt		  = NULL,
 	.cb				  = {
 		.func	= reset_state_cb,
@@ -151,6 +173,8 @@ reset_state_cb(void *arg)
 	aocoLocal.dmlDescriptorTab = NULL;
 	aocoLocal.last_used_state = NULL;
 	aocoLocal.stateCxt = NULL;
+	dlist_init(&aocoLocal.insertLru);
+	aocoLocal.insertMem = 0;
 }
 
 static void
@@ -205,6 +229,9 @@ enter_dml_state(const Oid relationOid)
 	state->insertMultiFiles = 0;
 	state->used_segment_files = NIL;
 	dlist_init(&state->head);
+	state->insertCxt = NULL;
+	state->insertMem = 0;
+	state->insertSuspended = false;
 
 	Assert(!found);
 
@@ -312,8 +339,7 @@ aoco_dml_finish(Relation relation, CmdType operation)
 	if (state->insertDesc)
 	{
 		Assert(state->insertDesc->aoi_rel == relation);
-		aocs_insert_finish(state->insertDesc, &state->head);
-		state->insertDesc = NULL;
+		close_insert_descriptors(state);
 	}
 
 	if (state->uniqueCheckDesc)
@@ -341,6 +367,107 @@ aoco_dml_finish(Relation relation, CmdType operation)
 
 }
 
+/*
+ * Finish the insert descriptors of a relation, and free their memory.
+ */
+static void
+close_insert_descriptors(AOCODMLState *state)
+{
+	Assert(state->insertDesc);
+
+	aocs_insert_finish(state->insertDesc, &state->head);
+	state->insertDesc = NULL;
+	dlist_init(&state->head);
+
+	if (state->insertSuspended)
+		state->insertSuspended = false;
+	else
+		dlist_delete(&state->lru_node);
+	aocoLocal.insertMem -= state->insertMem;
+	state->insertMem = 0;
+
+	MemoryContextDelete(state->insertCxt);
+	state->insertCxt = NULL;
+}
+
+/*
+ * Suspend the insert descriptors of the least recently used relations, once
+ * the ones in use take more than gp_appendonly_insert_mem_limit.
+ *
+ * This matters for an INSERT or COPY into a partitioned table with many
+ * column-oriented leaves, where every leaf keeps a buffer per column. The
+ * descriptors of current are never suspended, as they are about to be used.
+ * A suspended descriptor writes out its partly filled blocks and closes its
+ * files, but keeps its segment file, and the pg_aocsseg entry is only updated
+ * when the statement finishes, so no command counter increment is needed. It
+ * is resumed on the relation's next insert, see get_insert_descriptor().
+ *
+ * Once over the limit, we evict down to half of it rather than just below
+ * it, so that if the rows drift from one set of partitions to the next, as
+ * with input roughly sorted by the partition key, suspending a batch at a
+ * time lets the next few partitions be opened without another round. The
+ * price is that some of the relations suspended in a batch may get rows
+ * again soon, and each of those costs an extra small block per column.
+ */
+static void
+evict_insert_descriptors(AOCODMLState *current)
+{
+	Size		limit = (Size) gp_appendonly_insert_mem_limit * 1024;
+
+	if (gp_appendonly_insert_mem_limit == 0 || aocoLocal.insertMem <= limit)
+		return;
+
+	while (aocoLocal.insertMem > limit / 2 && !dlist_is_empty(&aocoLocal.insertLru))
+	{
+		AOCODMLState *victim;
+		MemoryContext oldcxt;
+		dlist_iter	iter;
+		Size		used;
+
+		victim = dlist_head_element(AOCODMLState, lru_node, &aocoLocal.insertLru);
+		if (victim == current)
+			break;
+
+		elogif(Debug_appendonly_print_insert, LOG,
+			   "suspending insert descriptors of relation %u to stay within gp_appendonly_insert_mem_limit "
+			   "(%zu bytes in use)",
+			   victim->relationOid, aocoLocal.insertMem);
+
+		oldcxt = MemoryContextSwitchTo(victim->insertCxt);
+		dlist_foreach(iter, &victim->head)
+			aocs_insert_suspend(dlist_container(AOCSInsertDescData, node, iter.cur));
+		MemoryContextSwitchTo(oldcxt);
+
+		dlist_delete(&victim->lru_node);
+		victim->insertSuspended = true;
+
+		used = MemoryContextMemAllocated(victim->insertCxt, true);
+		aocoLocal.insertMem -= victim->insertMem;
+		aocoLocal.insertMem += used;
+		victim->insertMem = used;
+	}
+}
+
+/*
+ * Charge the current size of the insert descriptors of state, which grows as
+ * rows are buffered, and evict others if that takes us over the limit.
+ */
+static void
+charge_insert_memory(AOCODMLState *state)
+{
+	Size		used;
+
+	if (gp_appendonly_insert_mem_limit == 0)
+		return;
+
+	used = MemoryContextMemAllocated(state->insertCxt, true);
+	aocoLocal.insertMem -= state->insertMem;
+	aocoLocal.insertMem += used;
+	state->insertMem = used;
+
+	evict_insert_descriptors(state);
+}
+
 /*
  * Retrieve the insertDescriptor for a relation. Initialize it if needed.
  */
@@ -349,12 +476,16 @@ get_insert_descriptor(const Relation relation)
 {
 	AOCODMLState *state;
 	AOCSInsertDesc next = NULL;
+	MemoryContext oldcxt;
 
 	state = find_dml_state(RelationGetRelid(relation));
 
 	if (state->insertDesc == NULL)
 	{
-		MemoryContext oldcxt;
+		state->insertCxt = AllocSetContextCreate(aocoLocal.stateCxt,
+												 "AOCS insert descriptors",
+												 ALLOCSET_DEFAULT_SIZES);
+		oldcxt = MemoryContextSwitchTo(state->insertCxt);
 
 		/*
 		 * CBDB_PARALLEL:
@@ -366,16 +497,31 @@ get_insert_descriptor(const Relation relation)
 			!ShouldUseReservedSegno(relation, CHOOSE_MODE_WRITE))
 			state->insertMultiFiles = gp_appendonly_insert_files;
 
-		oldcxt = MemoryContextSwitchTo(aocoLocal.stateCxt);
 		state->insertDesc = aocs_insert_init(relation,
 									  ChooseSegnoForWrite(relation));
 
+		MemoryContextSwitchTo(aocoLocal.stateCxt);
 		state->used_segment_files = list_make1_int(state->insertDesc->cur_segno);
 		dlist_init(&state->head);
 		dlist_push_tail(&state->head, &state->insertDesc->node);
+		MemoryContextSwitchTo(oldcxt);
+
+		dlist_push_tail(&aocoLocal.insertLru, &state->lru_node);
+	}
+	else if (state->insertSuspended)
+	{
+		dlist_iter	iter;
 
+		oldcxt = MemoryContextSwitchTo(state->insertCxt);
+		dlist_foreach(iter, &state->head)
+			aocs_insert_resume(dlist_container(AOCSInsertDescData, node, iter.cur));
 		MemoryContextSwitchTo(oldcxt);
+
+		state->insertSuspended = false;
+		dlist_push_tail(&aocoLocal.insertLru, &state->lru_node);
 	}
+	else if (gp_appendonly_insert_mem_limit > 0)
+		dlist_move_tail(&aocoLocal.insertLru, &state->lru_node);
 
 	/* switch insertDesc */
 	if (state->insertMultiFiles && state->insertDesc->range == gp_appendonly_insert_files_tuples_range)
@@ -384,9 +530,12 @@ get_insert_descriptor(const Relation relation)
 
 		if (list_length(state->used_segment_files) < state->insertMultiFiles)
 		{
+			oldcxt = MemoryContextSwitchTo(state->insertCxt);
 			next = aocs_insert_init(relation, ChooseSegnoForWriteMultiFile(relation, state->used_segment_files));
+			MemoryContextSwitchTo(aocoLocal.stateCxt);
 			dlist_push_tail(&state->head, &next->node);
 			state->used_segment_files = lappend_int(state->used_segment_files, next->cur_segno);
+			MemoryContextSwitchTo(oldcxt);
 		}
 
 		if (!dlist_has_next(&state->head, &state->insertDesc->node))
@@ -396,6 +545,9 @@ get_insert_descriptor(const Relation relation)
 
 		state->insertDesc = next;
 	}
+
+	charge_insert_memory(state);
+
 	/*
 	* If we have a unique index, insert a placeholder block directory row to
 	* entertain uniqueness checks from concurrent inserts. See
@@ -406,7 +558,7 @@ get_insert_descriptor(const Relation relation)
 	* during a uniqueness check, only the first non-dropped column's block
 	* directory entry is consulted. (See AppendOnlyBlockDirectory_CoversTuple())
 	*/
-	if (relationHasUniqueIndex(relation) && !state->insertDesc->placeholderInserted)
+	if (!state->insertDesc->placeholderInserted && relationHasUniqueIndex(relation))
 	{
 		int 				firstNonDroppedColumn = -1;
 		int64 				firstRowNum;
@@ -620,6 +772,8 @@ aoco_beginscan_extractcolumns(Relation rel, Snapshot snapshot, int nkeys, struct
 							parallel_scan,
 							cols,
 							flags);
+	aoscan->aos_count_only = appendonly_scan_counts_only(ps, parallel_scan,
+														 snapshot, flags);
 
 	pfree(cols);
 
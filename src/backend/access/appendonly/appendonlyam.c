@@ -61,6 +61,7 @@
 #include "executor/executor.h"
 #include "fmgr.h"
 #include "miscadmin.h"
+#include "optimizer/optimizer.h"
 #include "pgstat.h"
 #include "utils/datum.h"
 #include "utils/faultinjector.h"
@@ -1663,6 +1664,73 @@ appendonly_beginscan(Relation relation,
 	return (TableScanDesc) aoscan;
 }
 
+/*
+ * Can a scan of an AO or AOCS table, set up for the given plan node, just
+ * return the right number of rows, without reading them? That is the case
+ * when nothing looks at the rows but to count them, as in count(*): the plan
+ * has no quals and references no column, not even a system column.
+ *
+ * Such a scan gets the number of rows in each segment file from pg_aoseg,
+ * less the rows the visimap hides, and returns that many empty rows.
+ */
+bool
+appendonly_scan_counts_only(PlanState *ps, ParallelTableScanDesc parallel_scan,
+							Snapshot snapshot, uint32 flags)
+{
+	if (!gp_enable_ao_count_from_metadata)
+		return false;
+
+	/* the counts are only right for a serial MVCC scan of the whole table */
+	if (parallel_scan != NULL || (flags & SO_TYPE_SEQSCAN) == 0 ||
+		(flags & SO_TYPE_ANALYZE) != 0 || !IsMVCCSnapshot(snapshot))
+		return false;
+
+	if (ps == NULL || ps->plan->qual != NIL)
+		return false;
+
+	return !contain_var_clause((Node *) ps->plan->targetlist);
+}
+
+/*
+ * Return the next row of a scan that counts rows, see
+ * appendonly_scan_counts_only(). All its columns are NULL.
+ */
+static bool
+appendonly_getnext_count_only(AppendOnlyScanDesc scan, TupleTableSlot *slot)
+{
+	ExecClearTuple(slot);
+
+	while (scan->aos_count_remaining <= 0)
+	{
+		FileSegInfo *fsinfo;
+
+		if (scan->aos_count_nextseg >= scan->aos_total_segfiles)
+			return false;
+
+		fsinfo = scan->aos_segfile_arr[scan->aos_count_nextseg++];
+		if (fsinfo->total_tupcount <= 0 ||
+			fsinfo->state == AOSEG_STATE_AWAITING_DROP)
+			continue;
+
+#ifdef FAULT_INJECTOR
+		FaultInjector_InjectFaultIfSet("ao_count_from_metadata",
+									   DDLNotSpecified,
+									   "",	/* databaseName */
+									   RelationGetRelationName(scan->aos_rd));	/* tableName */
+#endif
+
+		scan->aos_count_remaining = fsinfo->total_tupcount -
+			AppendOnlyVisimap_GetSegmentFileHiddenTupleCount(&scan->visibilityMap,
+															 fsinfo->segno);
+	}
+	scan->aos_count_remaining--;
+
+	memset(slot->tts_isnull, true, slot->tts_tupleDescriptor->natts * sizeof(bool));
+	ExecStoreVirtualTuple(slot);
+
+	return true;
+}
+
 TableScanDesc
 appendonly_beginscan_extractcolumns(Relation rel, Snapshot snapshot, int nkeys, struct ScanKeyData *key,
 									ParallelTableScanDesc parallel_scan,
@@ -1670,6 +1738,8 @@ appendonly_beginscan_extractcolumns(Relation rel, Snapshot snapshot, int nkeys,
 {
 	AppendOnlyScanDesc aoscan;
 	aoscan = (AppendOnlyScanDesc) appendonly_beginscan(rel, snapshot, nkeys, key, parallel_scan, flags);
+	aoscan->aos_count_only = appendonly_scan_counts_only(ps, parallel_scan,
+														 snapshot, flags);
 	if (gp_enable_predicate_pushdown)
 		ps->qual = appendonly_predicate_pushdown_prepare(aoscan, ps->qual, ps->ps_ExprContext);
 	return (TableScanDesc) aoscan;
@@ -1703,6 +1773,9 @@ appendonly_rescan(TableScanDesc scan, ScanKey key,
 
 	aoscan->aos_need_new_segfile = true;
 
+	aoscan->aos_count_nextseg = 0;
+	aoscan->aos_count_remaining = 0;
+
 	/*
 	 * reinitialize scan descriptor
 	 */
@@ -1770,6 +1843,15 @@ bool
 appendonly_getnextslot(TableScanDesc scan, ScanDirection direction, TupleTableSlot *slot)
 {
 	AppendOnlyScanDesc aoscan = (AppendOnlyScanDesc) scan;
+
+	if (aoscan->aos_count_only)
+	{
+		if (!appendonly_getnext_count_only(aoscan, slot))
+			return false;
+		pgstat_count_heap_getnext(aoscan->aos_rd);
+		return true;
+	}
+
 	while (appendonlygettup(aoscan, direction, aoscan->rs_base.rs_nkeys, aoscan->aos_key, slot))
 	{
 		/* predicate pushdown test */
@@ -387,7 +387,7 @@ get_insert_descriptor(const Relation relation)
     * to entertain uniqueness checks from concurrent inserts. See
     * AppendOnlyBlockDirectory_InsertPlaceholder() for details.
     */
-    if (relationHasUniqueIndex(relation) && !state->insertDesc->placeholderInserted)
+    if (!state->insertDesc->placeholderInserted && relationHasUniqueIndex(relation))
     {
 
         AppendOnlyInsertDesc insertDesc = state->insertDesc;
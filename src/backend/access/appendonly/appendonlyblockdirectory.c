@@ -108,6 +108,8 @@ init_internal(AppendOnlyBlockDirectory *blockDirectory)
 	Assert(blockDirectory->blkdirRel != NULL);
 	Assert(blockDirectory->blkdirIdx != NULL);
 
+	blockDirectory->coveredValid = false;
+
 	blockDirectory->memoryContext =
 		AllocSetContextCreate(CurrentMemoryContext,
 							  "BlockDirectoryContext",
@@ -813,6 +815,39 @@ blkdir_entry_exists(AppendOnlyBlockDirectory *blockDirectory,
 
 	Assert(RelationIsValid(blkdirRel));
 
+	/*
+	 * A bulk load into a table with a unique index checks the keys it inserts
+	 * against the tuples already in the table, and consecutive conflicting
+	 * tids usually lie in the same block. If the last entry we found covers
+	 * this row too, we know the answer without another index scan. Only
+	 * entries of committed, undeleted rows are remembered (see below), so the
+	 * scan would have found the same entry, with no in-progress xmin or xmax
+	 * to report in the dirty snapshot.
+	 *
+	 * The dirty snapshot is set up anew for each check (see
+	 * AppendOnlyBlockDirectory_UniqueCheck()), so it can't be recognized by
+	 * its address. The entry is only reused with a snapshot of the same type,
+	 * in the same command that found it.
+	 */
+	if (blockDirectory->coveredValid &&
+		blockDirectory->coveredSnapshotType ==
+		blockDirectory->appendOnlyMetaDataSnapshot->snapshot_type &&
+		blockDirectory->coveredCommandId == GetCurrentCommandId(false) &&
+		blockDirectory->coveredSegmentFileNum == segmentFileNum &&
+		blockDirectory->coveredColumnGroupNo == columnGroupNo &&
+		rowNum >= blockDirectory->coveredFirstRowNum &&
+		rowNum <= blockDirectory->coveredLastRowNum)
+	{
+		Snapshot	snapshot = blockDirectory->appendOnlyMetaDataSnapshot;
+
+		if (snapshot->snapshot_type == SNAPSHOT_DIRTY)
+		{
+			snapshot->xmin = InvalidTransactionId;
+			snapshot->xmax = InvalidTransactionId;
+		}
+		return true;
+	}
+
 	ereportif(Debug_appendonly_print_blockdirectory, LOG,
 			  (errmsg("Append-only block directory covers tuple check: "
 					  "(columnGroupNo, segmentFileNum, rowNum) = "
@@ -891,7 +926,31 @@ blkdir_entry_exists(AppendOnlyBlockDirectory *blockDirectory,
 									   rowNum);
 		if (entry_no != -1)
 		{
+			MinipageEntry *entry = &minipageInfo->minipage->entry[entry_no];
+			Snapshot	snapshot = blockDirectory->appendOnlyMetaDataSnapshot;
+
 			found = true;
+
+			/*
+			 * Remember the entry for the next check if its rows can't go
+			 * away while we load: the row is committed by another transaction
+			 * and not being deleted, and it is not a placeholder, whose range
+			 * is open-ended.
+			 */
+			if (snapshot->snapshot_type == SNAPSHOT_DIRTY &&
+				!TransactionIdIsValid(snapshot->xmin) &&
+				!TransactionIdIsValid(snapshot->xmax) &&
+				!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetXmin(tuple->t_data)) &&
+				entry->rowCount != AOTupleId_MaxRowNum)
+			{
+				blockDirectory->coveredValid = true;
+				blockDirectory->coveredSnapshotType = snapshot->snapshot_type;
+				blockDirectory->coveredCommandId = GetCurrentCommandId(false);
+				blockDirectory->coveredSegmentFileNum = segmentFileNum;
+				blockDirectory->coveredColumnGroupNo = columnGroupNo;
+				blockDirectory->coveredFirstRowNum = entry->firstRowNum;
+				blockDirectory->coveredLastRowNum = entry->firstRowNum + entry->rowCount - 1;
+			}
 			break;
 		}
 	}
@@ -180,7 +180,16 @@ bminsert(Relation rel, Datum *values, bool *isnull,
 		 bool indexUnchanged,
 		 IndexInfo *indexInfo)
 {
-	_bitmap_doinsert(rel, *ht_ctid, values, isnull);
+	BMInsertState *state = (BMInsertState *) indexInfo->ii_AmCache;
+
+	/* set up the insert state on the first insert of the statement */
+	if (state == NULL)
+	{
+		state = _bitmap_init_insertstate(rel, indexInfo->ii_Context);
+		indexInfo->ii_AmCache = (void *) state;
+	}
+
+	_bitmap_doinsert(rel, *ht_ctid, values, isnull, state);
 	return true;
 }
 
@@ -72,7 +72,9 @@ static void inserttuple(Relation rel, Buffer metabuf,
 							    TupleDesc tupDesc, Datum* attdata,
 							    bool *nulls, Relation lovHeap, 
 								Relation lovIndex, ScanKey scanKey, 
-								IndexScanDesc scanDesc, bool use_wal);
+								IndexScanDesc scanDesc, bool use_wal,
+								BlockNumber *lovBlockP,
+								OffsetNumber *lovOffsetP);
 static void updatesetbit(Relation rel, 
 						 Buffer lovBuffer, OffsetNumber lovOffset,
 						 uint64 tidnum, bool use_wal);
@@ -2437,7 +2439,8 @@ static void
 inserttuple(Relation rel, Buffer metabuf, uint64 tidnum, 
 			ItemPointerData ht_ctid pg_attribute_unused(), TupleDesc tupDesc, Datum *attdata,
 			bool *nulls, Relation lovHeap, Relation lovIndex, ScanKey scanKey,
-		   	IndexScanDesc scanDesc, bool use_wal)
+		   	IndexScanDesc scanDesc, bool use_wal, BlockNumber *lovBlockP,
+			OffsetNumber *lovOffsetP)
 {
 	BlockNumber		lovBlock;
 	OffsetNumber	lovOffset;
@@ -2519,6 +2522,9 @@ inserttuple(Relation rel, Buffer metabuf, uint64 tidnum,
 	insertsetbit(rel, lovBlock, lovOffset, tidnum, &buf, use_wal);
 
 	_bitmap_free_tidbuf(&buf);
+
+	*lovBlockP = lovBlock;
+	*lovOffsetP = lovOffset;
 }
 
 /*
@@ -2540,14 +2546,118 @@ _bitmap_buildinsert(Relation rel, ItemPointerData ht_ctid, Datum *attdata,
 							  tupDesc, attdata, nulls, state);
 }
 
+/*
+ * _bitmap_init_insertstate() -- set up the state for inserts into an
+ * existing index, in the given memory context.
+ */
+BMInsertState *
+_bitmap_init_insertstate(Relation rel, MemoryContext cxt)
+{
+	TupleDesc		tupDesc = RelationGetDescr(rel);
+	BMInsertState  *state;
+	int				attno;
+
+	state = (BMInsertState *) MemoryContextAllocZero(cxt, sizeof(BMInsertState));
+	state->bm_cxt = cxt;
+	state->bm_eq_funcs = (RegProcedure *)
+		MemoryContextAlloc(cxt, Max(tupDesc->natts, 1) * sizeof(RegProcedure));
+	state->bm_last_values = (Datum *)
+		MemoryContextAllocZero(cxt, Max(tupDesc->natts, 1) * sizeof(Datum));
+	state->bm_last_nulls = (bool *)
+		MemoryContextAllocZero(cxt, Max(tupDesc->natts, 1) * sizeof(bool));
+	state->bm_have_last = false;
+
+	for (attno = 0; attno < tupDesc->natts; attno++)
+	{
+		Oid			eq_opr;
+
+		get_sort_group_operators(TupleDescAttr(tupDesc, attno)->atttypid,
+								 false, true, false,
+								 NULL, &eq_opr, NULL, NULL);
+		state->bm_eq_funcs[attno] = get_opcode(eq_opr);
+	}
+
+	return state;
+}
+
+/*
+ * Is this the value whose LOV item we found last?
+ *
+ * Values are compared as binary images: equal images always map to the same
+ * LOV item, and values that are equal in other ways just miss the cache.
+ */
+static bool
+same_as_last_value(TupleDesc tupDesc, Datum *attdata, bool *nulls,
+				   BMInsertState *state)
+{
+	int			attno;
+
+	if (!state->bm_have_last)
+		return false;
+
+	for (attno = 0; attno < tupDesc->natts; attno++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupDesc, attno);
+
+		if (nulls[attno] != state->bm_last_nulls[attno])
+			return false;
+		if (!nulls[attno] &&
+			!datumIsEqual(attdata[attno], state->bm_last_values[attno],
+						  attr->attbyval, attr->attlen))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Remember the LOV item of the value just inserted.
+ */
+static void
+remember_last_value(TupleDesc tupDesc, Datum *attdata, bool *nulls,
+					Oid lovHeapId, BlockNumber lovBlock,
+					OffsetNumber lovOffset, BMInsertState *state)
+{
+	MemoryContext oldcxt;
+	int			attno;
+
+	oldcxt = MemoryContextSwitchTo(state->bm_cxt);
+
+	for (attno = 0; attno < tupDesc->natts; attno++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupDesc, attno);
+
+		if (state->bm_have_last && !state->bm_last_nulls[attno] &&
+			!attr->attbyval)
+			pfree(DatumGetPointer(state->bm_last_values[attno]));
+
+		state->bm_last_nulls[attno] = nulls[attno];
+		if (nulls[attno])
+			state->bm_last_values[attno] = (Datum) 0;
+		else
+			state->bm_last_values[attno] = datumCopy(attdata[attno],
+													 attr->attbyval,
+													 attr->attlen);
+	}
+	state->bm_last_lovHeapId = lovHeapId;
+	state->bm_last_lovBlock = lovBlock;
+	state->bm_last_lovOffset = lovOffset;
+	state->bm_have_last = true;
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
 /*
  * _bitmap_doinsert() -- insert an index tuple for a given tuple.
  */
 void
 _bitmap_doinsert(Relation rel, ItemPointerData ht_ctid, Datum *attdata, 
-				 bool *nulls)
+				 bool *nulls, BMInsertState *state)
 {
 	uint64			tidOffset;
+	Oid				lovHeapId;
+	BlockNumber		lovBlock;
+	OffsetNumber	lovOffset;
 	TupleDesc		tupDesc;
 	Buffer			metabuf;
 	BMMetaPage		metapage;
@@ -2565,6 +2675,34 @@ _bitmap_doinsert(Relation rel, ItemPointerData ht_ctid, Datum *attdata,
 	/* insert a new bit into the corresponding bitmap using the HRL scheme */
 	metabuf = _bitmap_getbuf(rel, BM_METAPAGE, BM_READ);
 	metapage = _bitmap_get_metapage_data(rel, metabuf);
+
+	/*
+	 * If the value is the same as the last one, we already know its LOV item
+	 * and only have to set the bit. LOV items never move, and a LOV item,
+	 * once created, stays even if the creating transaction aborts. The item
+	 * is only valid for the LOV heap it was found in, though, so check that
+	 * the metapage still points to it, and keep the metapage pinned while
+	 * setting the bit, like the search below does.
+	 */
+	if (same_as_last_value(tupDesc, attdata, nulls, state) &&
+		metapage->bm_lov_heapId == state->bm_last_lovHeapId)
+	{
+		BMTIDBuffer buf;
+
+		LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
+
+		SIMPLE_FAULT_INJECTOR("bitmap_insert_same_value");
+
+		MemSet(&buf, 0, sizeof(buf));
+		insertsetbit(rel, state->bm_last_lovBlock, state->bm_last_lovOffset,
+					 tidOffset, &buf, RelationNeedsWAL(rel));
+		_bitmap_free_tidbuf(&buf);
+
+		ReleaseBuffer(metabuf);
+		return;
+	}
+
+	lovHeapId = metapage->bm_lov_heapId;
 	_bitmap_open_lov_heapandindex(rel, metapage, &lovHeap, &lovIndex, 
 								  RowExclusiveLock);
 
@@ -2574,15 +2712,9 @@ _bitmap_doinsert(Relation rel, ItemPointerData ht_ctid, Datum *attdata,
 
 	for (attno = 0; attno < tupDesc->natts; attno++)
 	{
-		Oid			eq_opr;
-		RegProcedure opfuncid;
+		RegProcedure opfuncid = state->bm_eq_funcs[attno];
 		ScanKey		scanKey;
 
-		get_sort_group_operators(TupleDescAttr(tupDesc, attno)->atttypid,
-								 false, true, false,
-								 NULL, &eq_opr, NULL, NULL);
-		opfuncid = get_opcode(eq_opr);
-
 		scanKey = (ScanKey) (((char *)scanKeys) + attno * sizeof(ScanKeyData));
 
 		ScanKeyEntryInitialize(scanKey,
@@ -2601,7 +2733,11 @@ _bitmap_doinsert(Relation rel, ItemPointerData ht_ctid, Datum *attdata,
 
 	/* insert this new tuple into the bitmap index. */
 	inserttuple(rel, metabuf, tidOffset, ht_ctid, tupDesc, attdata, nulls, 
-				lovHeap, lovIndex, scanKeys, scanDesc, RelationNeedsWAL(rel));
+				lovHeap, lovIndex, scanKeys, scanDesc, RelationNeedsWAL(rel),
+				&lovBlock, &lovOffset);
+
+	remember_last_value(tupDesc, attdata, nulls, lovHeapId, lovBlock,
+						lovOffset, state);
 
 	index_endscan(scanDesc);
 	_bitmap_close_lov_heapandindex(lovHeap, lovIndex, RowExclusiveLock);
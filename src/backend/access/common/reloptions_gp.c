@@ -841,6 +841,27 @@ validate_and_adjust_options(StdRdOptions *result,
 			}
 		}
 
+		if (result->compresstype[0] &&
+			(pg_strcasecmp(result->compresstype, "lz4") == 0))
+		{
+#ifndef USE_LZ4
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("lz4 compression is not supported by this build"),
+					 errhint("Compile with --with-lz4 to use lz4 compression.")));
+#endif
+			if (result->compresslevel > 12)
+			{
+				if (validate)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							 errmsg("compresslevel=%d is out of range for lz4 (should be in the range 1 to 12)",
+									result->compresslevel)));
+
+				result->compresslevel = setDefaultCompressionLevel(result->compresstype);
+			}
+		}
+
 		if (result->compresstype[0] &&
 			(pg_strcasecmp(result->compresstype, "quicklz") == 0))
 		{
@@ -955,7 +976,8 @@ validateAppendOnlyRelOptions(int blocksize,
 		(pg_strcasecmp(comptype, "quicklz") == 0 ||
 		 pg_strcasecmp(comptype, "zlib") == 0 ||
 		 pg_strcasecmp(comptype, "rle_type") == 0 ||
-		 pg_strcasecmp(comptype, "zstd") == 0))
+		 pg_strcasecmp(comptype, "zstd") == 0 ||
+		 pg_strcasecmp(comptype, "lz4") == 0))
 	{
 		if (!co &&
 			pg_strcasecmp(comptype, "rle_type") == 0)
@@ -1003,6 +1025,21 @@ validateAppendOnlyRelOptions(int blocksize,
 								complevel)));
 		}
 
+		if (comptype && (pg_strcasecmp(comptype, "lz4") == 0))
+		{
+#ifndef USE_LZ4
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("lz4 compression is not supported by this build"),
+					 errhint("Compile with --with-lz4 to use lz4 compression.")));
+#endif
+			if (complevel < 0 || complevel > 12)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("compresslevel=%d is out of range for lz4 (should be in the range 1 to 12)",
+								complevel)));
+		}
+
 		if (comptype && (pg_strcasecmp(comptype, "quicklz") == 0))
 		{
 #ifndef HAVE_LIBQUICKLZ
@@ -1049,7 +1086,7 @@ validateAppendOnlyRelOptions(int blocksize,
 
 /*
  * if no compressor type was specified, we set to no compression (level 0)
- * otherwise default for both zlib, quicklz, zstd and RLE to level 1.
+ * otherwise default for both zlib, quicklz, zstd, lz4 and RLE to level 1.
  */
 static int
 setDefaultCompressionLevel(char *compresstype)
@@ -18,6 +18,10 @@
 #ifdef HAVE_LIBZ
 #include <zlib.h>
 #endif
+#ifdef USE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
 
 #include "access/genam.h"
 #include "access/reloptions.h"
@@ -81,6 +85,15 @@ typedef struct zlib_state
 } zlib_state;
 #endif
 
+#ifdef USE_LZ4
+/* Internal state for lz4 */
+typedef struct lz4_state
+{
+	int level;			/* compression level */
+	bool compress;		/* compress or decompress? */
+} lz4_state;
+#endif
+
 static NameData
 comptype_to_name(char *comptype)
 {
@@ -429,6 +442,146 @@ zlib_validator(PG_FUNCTION_ARGS)
 }
 #endif
 
+#ifdef USE_LZ4
+/*
+ * lz4 compresses whole AO blocks with the one-shot block API, like zlib.
+ *
+ * compresslevel 1 uses the fast LZ4 compressor. Higher levels use LZ4HC at
+ * that level, trading compression speed for ratio; decompression is equally
+ * fast for both, since LZ4HC produces the same format.
+ */
+Datum
+lz4_constructor(PG_FUNCTION_ARGS)
+{
+
+	/* PG_GETARG_POINTER(0) is TupleDesc that is currently unused.
+	 * It is passed as NULL */
+
+	StorageAttributes *sa = (StorageAttributes *) PG_GETARG_POINTER(1);
+	CompressionState *cs	   = palloc0(sizeof(CompressionState));
+	lz4_state	   *state	= palloc0(sizeof(lz4_state));
+	bool			  compress = PG_GETARG_BOOL(2);
+
+	cs->opaque = (void *) state;
+	cs->desired_sz = NULL;
+
+	Assert(PointerIsValid(sa->comptype));
+
+	if (sa->complevel == 0)
+		sa->complevel = 1;
+
+	state->level = sa->complevel;
+	state->compress = compress;
+
+	PG_RETURN_POINTER(cs);
+}
+
+Datum
+lz4_destructor(PG_FUNCTION_ARGS)
+{
+	CompressionState *cs = (CompressionState *) PG_GETARG_POINTER(0);
+
+	if (cs != NULL && cs->opaque != NULL)
+	{
+		pfree(cs->opaque);
+	}
+
+	PG_RETURN_VOID();
+}
+
+Datum
+lz4_compress(PG_FUNCTION_ARGS)
+{
+	const void	   *src	  = PG_GETARG_POINTER(0);
+	int32			 src_sz   = PG_GETARG_INT32(1);
+	void			 *dst	  = PG_GETARG_POINTER(2);
+	int32			 dst_sz   = PG_GETARG_INT32(3);
+	int32			*dst_used = (int32 *) PG_GETARG_POINTER(4);
+	CompressionState *cs	   = (CompressionState *) PG_GETARG_POINTER(5);
+	lz4_state	   *state	= (lz4_state *) cs->opaque;
+	int				len;
+
+	if (state->level <= 1)
+		len = LZ4_compress_default(src, dst, src_sz, dst_sz);
+	else
+		len = LZ4_compress_HC(src, dst, src_sz, dst_sz, state->level);
+
+	/*
+	 * lz4 returns 0 when the compressed data doesn't fit in dst_sz, i.e. it
+	 * couldn't compress the data to a size smaller than the input. The caller
+	 * expects to detect this themselves so we set dst_used accordingly.
+	 */
+	if (len <= 0)
+		*dst_used = src_sz;
+	else
+		*dst_used = len;
+
+	PG_RETURN_VOID();
+}
+
+Datum
+lz4_decompress(PG_FUNCTION_ARGS)
+{
+	const char	   *src	= PG_GETARG_POINTER(0);
+	int32			src_sz = PG_GETARG_INT32(1);
+	void		   *dst	= PG_GETARG_POINTER(2);
+	int32			dst_sz = PG_GETARG_INT32(3);
+	int32		   *dst_used = (int32 *) PG_GETARG_POINTER(4);
+	int				len;
+
+	Assert(src_sz > 0 && dst_sz > 0);
+
+	len = LZ4_decompress_safe(src, dst, src_sz, dst_sz);
+	if (len < 0)
+		elog(ERROR, "lz4 encountered data in an unexpected format");
+
+	*dst_used = len;
+
+	PG_RETURN_VOID();
+}
+
+Datum
+lz4_validator(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_VOID();
+}
+#else
+Datum
+lz4_constructor(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "lz4 compression is not supported in this build of Cloudberry");
+	PG_RETURN_VOID();
+}
+
+Datum
+lz4_destructor(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "lz4 compression is not supported in this build of Cloudberry");
+	PG_RETURN_VOID();
+}
+
+Datum
+lz4_compress(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "lz4 compression is not supported in this build of Cloudberry");
+	PG_RETURN_VOID();
+}
+
+Datum
+lz4_decompress(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "lz4 compression is not supported in this build of Cloudberry");
+	PG_RETURN_VOID();
+}
+
+Datum
+lz4_validator(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "lz4 compression is not supported in this build of Cloudberry");
+	PG_RETURN_VOID();
+}
+#endif
+
 Datum
 rle_type_constructor(PG_FUNCTION_ARGS)
 {
@@ -526,6 +679,9 @@ compresstype_is_valid(char *comptype)
 #endif
 #ifdef USE_ZSTD
 			"zstd",
+#endif
+#ifdef USE_LZ4
+			"lz4",
 #endif
 			"rle_type", "none"};
 
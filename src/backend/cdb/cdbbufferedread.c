@@ -16,15 +16,28 @@
  */
 #include "postgres.h"
 
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "access/xlog.h"
 #include "cdb/cdbbufferedread.h"
 #include "crypto/bufenc.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "utils/guc.h"
+#include "utils/memutils.h"
 
 static void BufferedReadIo(
 			   BufferedRead *bufferedRead);
+static void BufferedReadMapFile(
+					BufferedRead *bufferedRead);
+static void BufferedReadUnmapFile(
+					  BufferedRead *bufferedRead);
+static bool BufferedReadMapWindow(
+					  BufferedRead *bufferedRead);
+static void BufferedReadInstallFaultHandler(void);
 static uint8 *BufferedReadUseBeforeBuffer(
 							BufferedRead *bufferedRead,
 							int32 maxReadAheadLen,
@@ -147,6 +160,13 @@ BufferedReadSetFile(
 	bufferedRead->temporaryLimitFileLen = 0;
 	bufferedRead->fileOff =0;
 
+	/*
+	 * Encrypted blocks are decrypted in place, which would copy every page
+	 * of a private mapping anyway.
+	 */
+	if (gp_appendonly_mmap_read && fileLen > 0 && !FileEncryptionEnabled)
+		BufferedReadMapFile(bufferedRead);
+
 	if (fileLen > 0)
 	{
 		/*
@@ -160,6 +180,248 @@ BufferedReadSetFile(
 	}
 }
 
+/*
+ * A mapped segment file.  The mapping is registered with the memory context
+ * of the BufferedRead, so that it goes away when a scan is aborted without
+ * BufferedReadCompleteFile().
+ */
+typedef struct BufferedReadMapping
+{
+	MemoryContextCallback callback;
+	void	   *addr;
+	size_t		len;
+} BufferedReadMapping;
+
+static void
+BufferedReadMappingCallback(void *arg)
+{
+	BufferedReadMapping *mapping = (BufferedReadMapping *) arg;
+
+	if (mapping->addr != NULL)
+		(void) munmap(mapping->addr, mapping->len);
+	mapping->addr = NULL;
+}
+
+/*
+ * Map the whole current file.
+ *
+ * The mapping is private, so that pages are only copied if someone writes
+ * into a buffer we handed out; until then, all scans of the file share the
+ * pages of the OS page cache.
+ *
+ * Touching a page of the mapping past the end of the file raises SIGBUS
+ * rather than returning an error.  The part of a segment file that a
+ * snapshot sees is only truncated away once no snapshot can see it anymore,
+ * so the file can't shrink below fileLen while we read it.  We still check
+ * that it covers fileLen once, here, and BufferedReadMapWindow() turns a
+ * SIGBUS while it faults in a window into a fallback to read(); a SIGBUS
+ * anywhere else is fatal, as for any mapped file.
+ *
+ * If the mapping fails, we quietly fall back to regular reads.
+ */
+static void
+BufferedReadMapFile(
+					BufferedRead *bufferedRead)
+{
+	BufferedReadMapping *mapping = bufferedRead->mapping;
+	void	   *addr;
+	int			fd;
+	struct stat st;
+
+	Assert(bufferedRead->mappedMemory == NULL);
+
+	if (bufferedRead->fileLen > (int64) SIZE_MAX)
+		return;
+
+	fd = FileGetRawDesc(bufferedRead->file);
+	if (fd < 0)
+		return;
+
+	if (fstat(fd, &st) != 0 || st.st_size < bufferedRead->fileLen)
+	{
+		elogif(Debug_appendonly_print_read_block, LOG,
+			   "Append-Only storage read: table \"%s\", segment file \"%s\" doesn't cover "
+			   "length " INT64_FORMAT ", not mapping it",
+			   bufferedRead->relationName,
+			   bufferedRead->filePathName,
+			   bufferedRead->fileLen);
+		return;
+	}
+
+	BufferedReadInstallFaultHandler();
+
+	if (mapping == NULL)
+	{
+		MemoryContext context = GetMemoryChunkContext(bufferedRead->memory);
+
+		mapping = MemoryContextAllocZero(context, sizeof(BufferedReadMapping));
+		mapping->callback.func = BufferedReadMappingCallback;
+		mapping->callback.arg = mapping;
+		MemoryContextRegisterResetCallback(context, &mapping->callback);
+		bufferedRead->mapping = mapping;
+	}
+	Assert(mapping->addr == NULL);
+
+	addr = mmap(NULL, (size_t) bufferedRead->fileLen, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED)
+	{
+		elogif(Debug_appendonly_print_read_block, LOG,
+			   "Append-Only storage read: could not map table \"%s\", segment file \"%s\", "
+			   "length " INT64_FORMAT ": %m",
+			   bufferedRead->relationName,
+			   bufferedRead->filePathName,
+			   bufferedRead->fileLen);
+		return;
+	}
+
+#ifdef MADV_SEQUENTIAL
+	(void) madvise(addr, (size_t) bufferedRead->fileLen, MADV_SEQUENTIAL);
+#endif
+
+	mapping->addr = addr;
+	mapping->len = (size_t) bufferedRead->fileLen;
+	bufferedRead->mappedMemory = (uint8 *) addr;
+}
+
+static void
+BufferedReadUnmapFile(
+					  BufferedRead *bufferedRead)
+{
+	BufferedReadMapping *mapping = bufferedRead->mapping;
+
+	if (bufferedRead->mappedMemory == NULL)
+		return;
+
+	Assert(mapping != NULL && mapping->addr == bufferedRead->mappedMemory);
+	if (munmap(mapping->addr, mapping->len) != 0)
+		elog(WARNING, "could not unmap segment file \"%s\" of table \"%s\": %m",
+			 bufferedRead->filePathName, bufferedRead->relationName);
+
+	mapping->addr = NULL;
+	mapping->len = 0;
+	bufferedRead->mappedMemory = NULL;
+	bufferedRead->largeReadMemory = &bufferedRead->memory[bufferedRead->maxBufferLen];
+}
+
+static sigjmp_buf *mapWindowFaultJump = NULL;
+
+static void
+BufferedReadMapWindowFault(SIGNAL_ARGS)
+{
+	if (mapWindowFaultJump != NULL)
+		siglongjmp(*mapWindowFaultJump, 1);
+
+	/* Not ours; let the default action take care of it. */
+	pqsignal(SIGBUS, SIG_DFL);
+	raise(SIGBUS);
+}
+
+/*
+ * The SIGBUS handler stays installed for the rest of the backend once the
+ * first file is mapped, so that faulting in a window costs no system call.
+ */
+static void
+BufferedReadInstallFaultHandler(void)
+{
+	static bool installed = false;
+
+	if (!installed)
+	{
+		pqsignal(SIGBUS, BufferedReadMapWindowFault);
+		installed = true;
+	}
+}
+
+/*
+ * Make the current large read window of a mapped file available.
+ *
+ * The window is faulted in here, under the same wait event as a regular
+ * read, so that time spent waiting for the disk shows up in
+ * pg_stat_activity just as it does with read().  A SIGBUS while faulting it
+ * in is caught, and we return false so that the caller falls back to
+ * read(); see BufferedReadMapFile().
+ */
+static bool
+BufferedReadMapWindow(
+					  BufferedRead *bufferedRead)
+{
+	int32		largeReadLen = bufferedRead->largeReadLen;
+	int64		windowEnd = bufferedRead->largeReadPosition + largeReadLen;
+	volatile uint8 *window;
+	sigjmp_buf	jump;
+	long		pageSize = sysconf(_SC_PAGESIZE);
+	bool		faulted;
+
+	Assert(windowEnd <= bufferedRead->mapping->len);
+
+	window = &bufferedRead->mappedMemory[bufferedRead->largeReadPosition];
+
+#ifdef MADV_WILLNEED
+	{
+		uintptr_t	start = (uintptr_t) window;
+		uintptr_t	pageStart = start & ~((uintptr_t) pageSize - 1);
+
+		(void) madvise((void *) pageStart, (start - pageStart) + largeReadLen,
+					   MADV_WILLNEED);
+	}
+#endif
+
+	/*
+	 * Don't save the signal mask, that would be a system call for every
+	 * window; the rare fault path unblocks SIGBUS itself instead.
+	 */
+	mapWindowFaultJump = &jump;
+	pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_READ);
+	if (sigsetjmp(jump, 0) == 0)
+	{
+		int32		off;
+
+		for (off = 0; off < largeReadLen; off += pageSize)
+			(void) window[off];
+		(void) window[largeReadLen - 1];
+		faulted = false;
+	}
+	else
+	{
+		sigset_t	sigbus;
+
+		sigemptyset(&sigbus);
+		sigaddset(&sigbus, SIGBUS);
+		sigprocmask(SIG_UNBLOCK, &sigbus, NULL);
+		faulted = true;
+	}
+	pgstat_report_wait_end();
+	mapWindowFaultJump = NULL;
+
+	if (faulted)
+	{
+		elogif(Debug_appendonly_print_read_block, LOG,
+			   "Append-Only storage read: table \"%s\", segment file \"%s\" was truncated while "
+			   "faulting in mapped read position " INT64_FORMAT " (large read length %d), falling back to read()",
+			   bufferedRead->relationName,
+			   bufferedRead->filePathName,
+			   bufferedRead->largeReadPosition,
+			   largeReadLen);
+		return false;
+	}
+
+	bufferedRead->largeReadMemory = (uint8 *) window;
+	bufferedRead->fileOff = windowEnd;
+
+	elogif(Debug_appendonly_print_read_block, LOG,
+		   "Append-Only storage read: table \"%s\", segment file \"%s\", mapped read position " INT64_FORMAT ", "
+		   "large read length %d",
+		   bufferedRead->relationName,
+		   bufferedRead->filePathName,
+		   bufferedRead->largeReadPosition,
+		   largeReadLen);
+
+	if (VacuumCostActive)
+		VacuumCostBalance += VacuumCostPageMiss;
+	return true;
+}
+
 /*
  * Perform a large read i/o.
  */
@@ -173,6 +435,20 @@ BufferedReadIo(
 
 	largeReadLen = bufferedRead->largeReadLen;
 	Assert(bufferedRead->largeReadLen > 0);
+
+	if (bufferedRead->mappedMemory != NULL)
+	{
+		if (BufferedReadMapWindow(bufferedRead))
+			return;
+
+		/*
+		 * The file shrank under the mapping.  Give up on it and read the
+		 * window the regular way, which reports the short read properly.
+		 */
+		BufferedReadUnmapFile(bufferedRead);
+		bufferedRead->fileOff = bufferedRead->largeReadPosition;
+	}
+
 	largeReadMemory = bufferedRead->largeReadMemory;
 
 	offset = 0;
@@ -267,6 +543,33 @@ BufferedReadUseBeforeBuffer(
 		return &bufferedRead->largeReadMemory[bufferedRead->bufferOffset];
 	}
 
+	if (bufferedRead->mappedMemory != NULL)
+	{
+		/*
+		 * The file is contiguous in memory, so rather than carrying the
+		 * tail of the current window over in the before memory, just start
+		 * the next window at the current buffer.
+		 */
+		nextPosition = bufferedRead->largeReadPosition + bufferedRead->bufferOffset;
+		remainingFileLen = inEffectFileLen - nextPosition;
+		if (remainingFileLen > bufferedRead->maxLargeReadLen)
+			nextReadLen = bufferedRead->maxLargeReadLen;
+		else
+			nextReadLen = (int32) remainingFileLen;
+
+		bufferedRead->largeReadPosition = nextPosition;
+		bufferedRead->largeReadLen = nextReadLen;
+		bufferedRead->bufferOffset = 0;
+
+		BufferedReadIo(bufferedRead);
+
+		bufferedRead->bufferLen = Min(maxReadAheadLen, nextReadLen);
+		Assert(bufferedRead->bufferLen > 0);
+
+		*nextBufferLen = bufferedRead->bufferLen;
+		return bufferedRead->largeReadMemory;
+	}
+
 	remainingFileLen = inEffectFileLen -
 		nextPosition;
 	if (remainingFileLen > bufferedRead->maxLargeReadLen)
@@ -645,6 +948,8 @@ BufferedReadCompleteFile(
 	Assert(bufferedRead != NULL);
 	Assert(bufferedRead->file >= 0);
 
+	BufferedReadUnmapFile(bufferedRead);
+
 	bufferedRead->file = -1;
 	bufferedRead->filePathName = NULL;
 	bufferedRead->fileLen = 0;
@@ -0,0 +1,493 @@
+/*-------------------------------------------------------------------------
+ *
+ * cdbcardfeedback.c
+ *	  Cardinality feedback from query execution to GPORCA.
+ *
+ * GPORCA derives the cardinality of a filter from the same histograms every
+ * time, so a filter it misestimates, typically one on correlated columns,
+ * stays misestimated until the data changes.  With
+ * optimizer_cardinality_feedback on, the QD asks the QEs for the rows
+ * produced by each plan node (the same statistics that EXPLAIN ANALYZE
+ * shows), and at the end of a query compares, for every scan with a
+ * filter, the actual rows with the rows GPORCA estimated.  The ratio is
+ * kept in a small shared hash table, keyed by the table and the columns and
+ * operators of the filter.  When GPORCA later derives the statistics of a
+ * filter with the same operators on the same columns of the same table, it
+ * scales its estimate by that ratio (see
+ * CLogicalSelect::PstatsApplyCardinalityFeedback).
+ *
+ * The estimate that the next execution compares with is already corrected,
+ * so an observation refines the stored correction instead of replacing it.
+ * Corrections decay with optimizer_cardinality_feedback_half_life, and
+ * ANALYZE of a table drops its corrections, since they were relative to the
+ * statistics that ANALYZE replaces.  The table is bounded by
+ * optimizer_cardinality_feedback_entries; when it is full, the entry that
+ * was updated least recently is evicted.  It is not persisted across
+ * restarts, and it only exists on the QD, which is where GPORCA runs.
+ *
+ * Only statements with a candidate scan are instrumented, and only scans of plain tables are covered: joins, and the scans of the leaf
+ * partitions of a partitioned table, which GPORCA estimates as a whole, are
+ * not.
+ *
+ * Portions Copyright (c) 2023, HashData Technology Limited.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/cdb/cdbcardfeedback.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/sysattr.h"
+#include "cdb/cdbcardfeedback.h"
+#include "cdb/cdbexplain.h"
+#include "cdb/cdbvars.h"
+#include "executor/executor.h"
+#include "executor/instrument.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/walkers.h"
+#include "parser/parsetree.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+
+/*
+ * Weight of a new observation.  The constants of the filter change from one
+ * execution to the next, and so does its selectivity; smooth that out.
+ */
+#define CARD_FEEDBACK_SMOOTHING		0.5
+
+/* Don't create an entry for an estimate that is already this close. */
+#define CARD_FEEDBACK_MIN_ERROR		1.1
+
+/* Bound of the correction, in both directions. */
+#define CARD_FEEDBACK_MAX_FACTOR	1.0e6
+
+typedef struct CardFeedbackPlanCtx
+{
+	plan_tree_base_prefix base;	/* Required prefix for plan_tree_walker */
+	bool		has_limit;
+	bool		has_candidate;
+} CardFeedbackPlanCtx;
+
+typedef struct CardFeedbackRecordCtx
+{
+	List	   *rtable;
+	TimestampTz now;
+} CardFeedbackRecordCtx;
+
+static HTAB *CardFeedbackHash = NULL;
+
+static List *cardfeedback_scan_quals(Node *node);
+static bool cardfeedback_plan_walker(Node *node, CardFeedbackPlanCtx *ctx);
+static bool cardfeedback_has_limit(PlanState *planstate, void *context);
+static bool cardfeedback_opno_walker(Node *node, CardFeedbackKey *key);
+static bool cardfeedback_record_walker(PlanState *planstate, void *context);
+static void cardfeedback_record_scan(PlanState *planstate,
+									 CardFeedbackRecordCtx *ctx);
+static double cardfeedback_decayed(CardFeedbackEntry *entry, TimestampTz now);
+static void cardfeedback_evict(void);
+
+Size
+CardFeedbackShmemSize(void)
+{
+	if (!IS_QUERY_DISPATCHER() || optimizer_cardinality_feedback_entries <= 0)
+		return 0;
+
+	return hash_estimate_size(optimizer_cardinality_feedback_entries,
+							  sizeof(CardFeedbackEntry));
+}
+
+void
+CardFeedbackShmemInit(void)
+{
+	HASHCTL		info;
+
+	if (!IS_QUERY_DISPATCHER() || optimizer_cardinality_feedback_entries <= 0)
+		return;
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(CardFeedbackKey);
+	info.entrysize = sizeof(CardFeedbackEntry);
+
+	CardFeedbackHash = ShmemInitHash("Cardinality feedback",
+									 optimizer_cardinality_feedback_entries,
+									 optimizer_cardinality_feedback_entries,
+									 &info,
+									 HASH_ELEM | HASH_BLOBS);
+}
+
+/*
+ * Called by ExecutorStart on the QD.  If the plan has a scan that we could
+ * learn from, and the statement is not already instrumented, e.g. by EXPLAIN
+ * ANALYZE, have the QEs count the rows of each node and send them back at
+ * the end.
+ */
+void
+CardFeedbackExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	CardFeedbackPlanCtx ctx;
+	instr_time	starttime;
+
+	if (!optimizer_cardinality_feedback || CardFeedbackHash == NULL ||
+		Gp_role != GP_ROLE_DISPATCH ||
+		(eflags & EXEC_FLAG_EXPLAIN_ONLY) != 0 ||
+		queryDesc->plannedstmt->planGen != PLANGEN_OPTIMIZER ||
+		queryDesc->operation != CMD_SELECT ||
+		queryDesc->instrument_options != 0 ||
+		queryDesc->showstatctx != NULL)
+		return;
+
+	/* Same restrictions as CardFeedbackRecord() */
+	exec_init_plan_tree_base(&ctx.base, queryDesc->plannedstmt);
+	ctx.has_limit = false;
+	ctx.has_candidate = false;
+	cardfeedback_plan_walker((Node *) queryDesc->plannedstmt->planTree, &ctx);
+	if (ctx.has_limit || !ctx.has_candidate)
+		return;
+
+	queryDesc->instrument_options |= INSTRUMENT_ROWS | INSTRUMENT_CDB;
+
+	INSTR_TIME_SET_CURRENT(starttime);
+	queryDesc->showstatctx = cdbexplain_showExecStatsBegin(queryDesc, starttime);
+}
+
+/*
+ * Called on the QD once the statistics of the QEs have been received, at
+ * the successful end of a query.
+ */
+void
+CardFeedbackRecord(QueryDesc *queryDesc)
+{
+	CardFeedbackRecordCtx ctx;
+
+	if (!optimizer_cardinality_feedback || CardFeedbackHash == NULL ||
+		Gp_role != GP_ROLE_DISPATCH ||
+		queryDesc->plannedstmt->planGen != PLANGEN_OPTIMIZER ||
+		queryDesc->planstate == NULL)
+		return;
+
+	/*
+	 * Under a Limit, scans stop early and produce fewer rows than their
+	 * filter would let through.
+	 */
+	if (cardfeedback_has_limit(queryDesc->planstate, NULL))
+		return;
+
+	ctx.rtable = queryDesc->plannedstmt->rtable;
+	ctx.now = GetCurrentTimestamp();
+
+	cardfeedback_record_walker(queryDesc->planstate, &ctx);
+}
+
+/*
+ * The filter of a scan that can give feedback; NIL for any other node.
+ */
+static List *
+cardfeedback_scan_quals(Node *node)
+{
+	switch (nodeTag(node))
+	{
+		case T_SeqScan:
+			return ((Plan *) node)->qual;
+		case T_IndexScan:
+			return list_concat_copy(((Plan *) node)->qual,
+									((IndexScan *) node)->indexqualorig);
+		case T_BitmapHeapScan:
+			return list_concat_copy(((Plan *) node)->qual,
+									((BitmapHeapScan *) node)->bitmapqualorig);
+		default:
+			return NIL;
+	}
+}
+
+static bool
+cardfeedback_plan_walker(Node *node, CardFeedbackPlanCtx *ctx)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, Limit))
+	{
+		ctx->has_limit = true;
+		return true;
+	}
+
+	if (cardfeedback_scan_quals(node) != NIL)
+		ctx->has_candidate = true;
+
+	return plan_tree_walker(node, cardfeedback_plan_walker, ctx, true);
+}
+
+static bool
+cardfeedback_has_limit(PlanState *planstate, void *context)
+{
+	if (planstate == NULL)
+		return false;
+
+	if (IsA(planstate, LimitState))
+		return true;
+
+	return planstate_tree_walker(planstate, cardfeedback_has_limit, context);
+}
+
+static bool
+cardfeedback_record_walker(PlanState *planstate, void *context)
+{
+	if (planstate == NULL)
+		return false;
+
+	cardfeedback_record_scan(planstate, (CardFeedbackRecordCtx *) context);
+
+	return planstate_tree_walker(planstate, cardfeedback_record_walker, context);
+}
+
+static void
+cardfeedback_record_scan(PlanState *planstate, CardFeedbackRecordCtx *ctx)
+{
+	Plan	   *plan = planstate->plan;
+	Scan	   *scan = (Scan *) plan;
+	List	   *quals;
+	RangeTblEntry *rte;
+	CardFeedbackKey key;
+	CardFeedbackEntry *entry;
+	Bitmapset  *attrs = NULL;
+	double		actual;
+	double		nloops;
+	double		estimated;
+	double		error;
+	int			ninst;
+	int			x;
+	bool		found;
+
+	quals = cardfeedback_scan_quals((Node *) plan);
+	if (quals == NIL)
+		return;
+
+	/*
+	 * Every QE must have run the scan exactly once: the rows of a rescanned
+	 * scan depend on its parameters, not only on its filter.
+	 */
+	if (!cdbexplain_getNodeRows(planstate, &actual, &nloops, &ninst) ||
+		nloops != ninst)
+		return;
+
+	rte = rt_fetch(scan->scanrelid, ctx->rtable);
+	if (rte->rtekind != RTE_RELATION || rte->inh ||
+		get_rel_relispartition(rte->relid))
+		return;
+
+	memset(&key, 0, sizeof(key));
+	key.dbid = MyDatabaseId;
+	key.relid = rte->relid;
+
+	pull_varattnos((Node *) quals, scan->scanrelid, &attrs);
+	x = -1;
+	while ((x = bms_next_member(attrs, x)) >= 0)
+	{
+		AttrNumber	attno = x + FirstLowInvalidHeapAttributeNumber;
+
+		if (attno <= 0 || key.natts == CARD_FEEDBACK_MAX_ATTS)
+			return;
+		key.attnos[key.natts++] = attno;
+	}
+	if (key.natts == 0)
+		return;
+
+	if (cardfeedback_opno_walker((Node *) quals, &key))
+		return;
+
+	/* GPORCA's estimates are for all segments, see TranslatePlanCosts() */
+	estimated = plan->plan_rows * ninst;
+	error = log(Max(actual, 1.0) / Max(estimated, 1.0));
+
+	LWLockAcquire(CardFeedbackLock, LW_EXCLUSIVE);
+
+	entry = hash_search(CardFeedbackHash, &key, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		if (fabs(error) < log(CARD_FEEDBACK_MIN_ERROR))
+		{
+			LWLockRelease(CardFeedbackLock);
+			return;
+		}
+		if (hash_get_num_entries(CardFeedbackHash) >= optimizer_cardinality_feedback_entries)
+			cardfeedback_evict();
+	}
+
+	entry = hash_search(CardFeedbackHash, &key, HASH_ENTER, &found);
+	if (!found)
+	{
+		/* the estimate was not corrected yet */
+		entry->logfactor = error;
+		entry->nobservations = 0;
+	}
+	else
+	{
+		/*
+		 * The estimate was already corrected by what the entry held when
+		 * the query was planned; refine the correction.
+		 */
+		entry->logfactor = cardfeedback_decayed(entry, ctx->now) +
+			CARD_FEEDBACK_SMOOTHING * error;
+	}
+	entry->logfactor = Max(Min(entry->logfactor, log(CARD_FEEDBACK_MAX_FACTOR)),
+						   -log(CARD_FEEDBACK_MAX_FACTOR));
+	entry->updated = ctx->now;
+	entry->nobservations++;
+
+	LWLockRelease(CardFeedbackLock);
+
+	elog(DEBUG1, "cardinality feedback for relation %u: %.0f rows estimated, %.0f actual, correction %g",
+		 key.relid, estimated, actual, exp(entry->logfactor));
+}
+
+/*
+ * Add the operators of a filter to the key, in ascending order and without
+ * duplicates.  Returns true if there are too many of them.  GPORCA collects
+ * the same operators, see CLogicalSelect::PstatsApplyCardinalityFeedback.
+ */
+static bool
+cardfeedback_opno_walker(Node *node, CardFeedbackKey *key)
+{
+	Oid			opno;
+	int			i;
+
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, OpExpr) || IsA(node, DistinctExpr) || IsA(node, NullIfExpr))
+		opno = ((OpExpr *) node)->opno;
+	else if (IsA(node, ScalarArrayOpExpr))
+		opno = ((ScalarArrayOpExpr *) node)->opno;
+	else
+		return expression_tree_walker(node, cardfeedback_opno_walker, key);
+
+	for (i = 0; i < key->nops && key->opnos[i] < opno; i++)
+		;
+	if (i == key->nops || key->opnos[i] != opno)
+	{
+		if (key->nops == CARD_FEEDBACK_MAX_OPS)
+			return true;
+		memmove(&key->opnos[i + 1], &key->opnos[i],
+				(key->nops - i) * sizeof(Oid));
+		key->opnos[i] = opno;
+		key->nops++;
+	}
+
+	return expression_tree_walker(node, cardfeedback_opno_walker, key);
+}
+
+/*
+ * The correction of an entry, decayed by its age.  Caller must hold
+ * CardFeedbackLock.
+ */
+static double
+cardfeedback_decayed(CardFeedbackEntry *entry, TimestampTz now)
+{
+	long		secs;
+	int			usecs;
+
+	if (optimizer_cardinality_feedback_half_life <= 0)
+		return entry->logfactor;
+
+	TimestampDifference(entry->updated, now, &secs, &usecs);
+
+	return entry->logfactor *
+		pow(0.5, (double) secs / optimizer_cardinality_feedback_half_life);
+}
+
+/*
+ * Make room for a new entry by removing the one that was updated least
+ * recently.  Caller must hold CardFeedbackLock exclusively.
+ */
+static void
+cardfeedback_evict(void)
+{
+	HASH_SEQ_STATUS status;
+	CardFeedbackEntry *entry;
+	CardFeedbackEntry *oldest = NULL;
+
+	hash_seq_init(&status, CardFeedbackHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (oldest == NULL || entry->updated < oldest->updated)
+			oldest = entry;
+	}
+
+	if (oldest != NULL)
+		hash_search(CardFeedbackHash, &oldest->key, HASH_REMOVE, NULL);
+}
+
+/*
+ * Drop the corrections for a table, whose statistics have just been
+ * replaced by ANALYZE.
+ */
+void
+CardFeedbackForgetRelation(Oid relid)
+{
+	HASH_SEQ_STATUS status;
+	CardFeedbackEntry *entry;
+
+	if (CardFeedbackHash == NULL)
+		return;
+
+	LWLockAcquire(CardFeedbackLock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, CardFeedbackHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dbid == MyDatabaseId && entry->key.relid == relid)
+			hash_search(CardFeedbackHash, &entry->key, HASH_REMOVE, NULL);
+	}
+
+	LWLockRelease(CardFeedbackLock);
+}
+
+/*
+ * Get a palloc'd copy of the entries of a database, for the optimizer.  The
+ * logfactor of the copies is already decayed.
+ */
+CardFeedbackEntry *
+CardFeedbackGetEntries(Oid dbid, int *nentries)
+{
+	HASH_SEQ_STATUS status;
+	CardFeedbackEntry *entry;
+	CardFeedbackEntry *result;
+	TimestampTz now;
+	int			n = 0;
+
+	*nentries = 0;
+	if (!optimizer_cardinality_feedback || CardFeedbackHash == NULL)
+		return NULL;
+
+	now = GetCurrentTimestamp();
+
+	LWLockAcquire(CardFeedbackLock, LW_SHARED);
+
+	result = palloc(Max(hash_get_num_entries(CardFeedbackHash), 1) *
+					sizeof(CardFeedbackEntry));
+
+	hash_seq_init(&status, CardFeedbackHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.dbid != dbid)
+			continue;
+
+		result[n] = *entry;
+		result[n].logfactor = cardfeedback_decayed(entry, now);
+		n++;
+	}
+
+	LWLockRelease(CardFeedbackLock);
+
+	*nentries = n;
+	return result;
+}
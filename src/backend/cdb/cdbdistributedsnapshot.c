@@ -265,22 +265,95 @@ DistributedSnapshot_Copy(DistributedSnapshot *target,
 			source->count * sizeof(DistributedTransactionId));
 }
 
+/*
+ * The in-progress xids are serialized as their distance from xmin, in a
+ * variable-length encoding of 7 bits per byte. They are all close to xmin,
+ * so that most of them take 2 or 3 bytes instead of 8. With many concurrent
+ * sessions, the array is the bulk of the DtxContextInfo that goes with every
+ * dispatched statement. The distances are computed modulo 2^64, so any xid
+ * can be represented, just less compactly.
+ */
+static inline int
+xid_distance_size(uint64 distance)
+{
+	int			size = 1;
+
+	while (distance >= 0x80)
+	{
+		distance >>= 7;
+		size++;
+	}
+
+	return size;
+}
+
+static inline int
+xid_distance_encode(uint64 distance, char *buf)
+{
+	unsigned char *p = (unsigned char *) buf;
+
+	while (distance >= 0x80)
+	{
+		*p++ = (unsigned char) (distance | 0x80);
+		distance >>= 7;
+	}
+	*p++ = (unsigned char) distance;
+
+	return (char *) p - buf;
+}
+
+static inline int
+xid_distance_decode(const char *buf, const char *end, uint64 *distance)
+{
+	const unsigned char *p = (const unsigned char *) buf;
+	uint64		result = 0;
+	int			shift = 0;
+
+	for (;;)
+	{
+		unsigned char byte;
+
+		if ((const char *) p >= end)
+			elog(ERROR, "truncated in-progress xid in serialized distributed snapshot");
+		if (shift > 63)
+			elog(ERROR, "invalid in-progress xid in serialized distributed snapshot");
+
+		byte = *p++;
+
+		result |= ((uint64) (byte & 0x7F)) << shift;
+		if ((byte & 0x80) == 0)
+			break;
+		shift += 7;
+	}
+
+	*distance = result;
+	return (const char *) p - buf;
+}
+
 int
 DistributedSnapshot_SerializeSize(DistributedSnapshot *ds)
 {
-	return sizeof(DistributedSnapshotId) +
+	int			size;
+	int			i;
+
+	size = sizeof(DistributedSnapshotId) +
 	/* xminAllDistributedSnapshots, xmin, xmax */
 		3 * sizeof(DistributedTransactionId) +
 	/* count */
-		sizeof(int32) +
-	/* Size of inProgressXidArray */
-		sizeof(DistributedTransactionId) * ds->count;
+		sizeof(int32);
+
+	/* inProgressXidArray */
+	for (i = 0; i < ds->count; i++)
+		size += xid_distance_size(ds->inProgressXidArray[i] - ds->xmin);
+
+	return size;
 }
 
 int
 DistributedSnapshot_Serialize(DistributedSnapshot *ds, char *buf)
 {
 	char	   *p = buf;
+	int			i;
 
 	memcpy(p, &ds->xminAllDistributedSnapshots, sizeof(DistributedTransactionId));
 	p += sizeof(DistributedTransactionId);
@@ -293,8 +366,8 @@ DistributedSnapshot_Serialize(DistributedSnapshot *ds, char *buf)
 	memcpy(p, &ds->count, sizeof(int32));
 	p += sizeof(int32);
 
-	memcpy(p, ds->inProgressXidArray, sizeof(DistributedTransactionId) * ds->count);
-	p += sizeof(DistributedTransactionId) * ds->count;
+	for (i = 0; i < ds->count; i++)
+		p += xid_distance_encode(ds->inProgressXidArray[i] - ds->xmin, p);
 
 	Assert((p - buf) == DistributedSnapshot_SerializeSize(ds));
 
@@ -302,9 +375,14 @@ DistributedSnapshot_Serialize(DistributedSnapshot *ds, char *buf)
 }
 
 int
-DistributedSnapshot_Deserialize(const char *buf, DistributedSnapshot *ds)
+DistributedSnapshot_Deserialize(const char *buf, int len, DistributedSnapshot *ds)
 {
 	const char *p = buf;
+	const char *end = buf + len;
+
+	if (len < (int) (sizeof(DistributedSnapshotId) +
+					 3 * sizeof(DistributedTransactionId) + sizeof(int32)))
+		elog(ERROR, "truncated serialized distributed snapshot");
 
 	memcpy(&ds->xminAllDistributedSnapshots, p, sizeof(DistributedTransactionId));
 	p += sizeof(DistributedTransactionId);
@@ -317,9 +395,13 @@ DistributedSnapshot_Deserialize(const char *buf, DistributedSnapshot *ds)
 	memcpy(&ds->count, p, sizeof(int32));
 	p += sizeof(int32);
 
+	if (ds->count < 0 || ds->count > GetMaxSnapshotXidCount())
+		elog(ERROR, "invalid in-progress xid count %d in serialized distributed snapshot",
+			 ds->count);
+
 	if (ds->count > 0)
 	{
-		int xipsize = sizeof(DistributedTransactionId) * ds->count;
+		int			i;
 
 		if (ds->inProgressXidArray == NULL)
 		{
@@ -331,8 +413,13 @@ DistributedSnapshot_Deserialize(const char *buf, DistributedSnapshot *ds)
 						 errmsg("out of memory")));
 		}
 
-		memcpy(ds->inProgressXidArray, p, xipsize);
-		p += xipsize;
+		for (i = 0; i < ds->count; i++)
+		{
+			uint64		distance;
+
+			p += xid_distance_decode(p, end, &distance);
+			ds->inProgressXidArray[i] = ds->xmin + distance;
+		}
 	}
 
 	Assert((p - buf) == DistributedSnapshot_SerializeSize(ds));
@@ -341,7 +341,10 @@ DtxContextInfo_Deserialize(const char *serializedDtxContextInfo,
 
 		if (dtxContextInfo->haveDistributedSnapshot)
 		{
-			p += DistributedSnapshot_Deserialize(p, ds);
+			p += DistributedSnapshot_Deserialize(p,
+												 serializedDtxContextInfolen -
+												 (p - serializedDtxContextInfo),
+												 ds);
 		}
 		else
 		{
@@ -25,6 +25,9 @@
 #include "libpq/libpq-be.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/walkers.h"
 #include "storage/lmgr.h"
 #include "storage/pmsignal.h"
 #include "storage/s_lock.h"
@@ -1514,6 +1517,86 @@ insertedDistributedCommitted(void)
 		MyTmGxact->includeInCkpt = true;
 }
 
+static bool
+mutable_functions_in_plan_walker(Node *node, plan_tree_base_prefix *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (is_plan_node(node))
+		return plan_tree_walker(node, mutable_functions_in_plan_walker, context, false);
+
+	return contain_mutable_functions(node);
+}
+
+/*
+ * Can the statement run with a local snapshot instead of a distributed one?
+ *
+ * A read-only statement whose only dispatched slice goes to a single
+ * segment reads nothing but that segment's data, and its QE can take a
+ * local snapshot there. The distributed snapshot would only hold back
+ * distributed transactions that are committed on the segment but not yet
+ * everywhere, and creating it is what limits the rate of point lookups on
+ * the QD. It still must not come into play for anything else:
+ *
+ * - READ COMMITTED only, so the snapshot is not kept for later statements
+ *   of the transaction;
+ * - no transaction block, and no distributed transaction started yet, so
+ *   there are no earlier writes on the segment that the statement must see;
+ * - no QD work besides receiving the Gather Motion, and no subplans or
+ *   functions that could run queries of their own, so nothing else is
+ *   dispatched with this snapshot.
+ */
+bool
+canUseLocalSnapshot(PlannedStmt *stmt)
+{
+	PlanSlice  *slice;
+	plan_tree_base_prefix base;
+
+	if (!gp_enable_direct_dispatch_local_snapshot)
+		return false;
+
+	if (Gp_role != GP_ROLE_DISPATCH ||
+		DistributedTransactionContext != DTX_CONTEXT_QD_DISTRIBUTED_CAPABLE ||
+		XactIsoLevel != XACT_READ_COMMITTED ||
+		IsTransactionBlock() ||
+		isCurrentDtxActivated())
+		return false;
+
+	if (stmt->commandType != CMD_SELECT ||
+		stmt->hasModifyingCTE ||
+		stmt->rowMarks != NIL ||
+		stmt->intoClause != NULL ||
+		stmt->copyIntoClause != NULL ||
+		stmt->refreshClause != NULL ||
+		stmt->subplans != NIL)
+		return false;
+
+	if (!IsA(stmt->planTree, Motion) ||
+		stmt->planTree->initPlan != NIL ||
+		stmt->numSlices != 2 ||
+		stmt->slices[0].gangType != GANGTYPE_UNALLOCATED)
+		return false;
+
+	slice = &stmt->slices[1];
+	if ((slice->gangType != GANGTYPE_PRIMARY_READER &&
+		 slice->gangType != GANGTYPE_PRIMARY_WRITER) ||
+		!slice->directDispatch.isDirectDispatch ||
+		list_length(slice->directDispatch.contentIds) != 1)
+		return false;
+
+	/*
+	 * The QD evaluates stable functions before dispatching the plan, see
+	 * exec_make_plan_constant(). Queries that they run would be dispatched
+	 * with this snapshot, to any segment.
+	 */
+	exec_init_plan_tree_base(&base, stmt);
+	if (mutable_functions_in_plan_walker((Node *) stmt->planTree, &base))
+		return false;
+
+	return true;
+}
+
 /*
  * When called, a SET command is dispatched and the writer gang
  * writes the shared snapshot. This function actually does nothing
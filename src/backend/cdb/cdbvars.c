@@ -210,11 +210,17 @@ int			interconnect_setup_timeout = 7200;
 
 int			Gp_interconnect_type = INTERCONNECT_TYPE_UDPIFC;
 
+int			gp_interconnect_shm_ring_size = 1024;	/* kB */
+
+int			gp_interconnect_tcp_keep_connections = 0;
+
 bool		gp_interconnect_aggressive_retry = true;	/* fast-track app-level
 														 * retry */
 
 bool		gp_interconnect_full_crc = false;	/* sanity check UDP data. */
 
+bool		gp_interconnect_udp_segmentation_offload = false;
+
 bool		gp_interconnect_log_stats = false;	/* emit stats at log-level */
 
 bool		gp_interconnect_cache_future_packets = true;
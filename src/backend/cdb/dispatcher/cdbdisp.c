@@ -394,6 +394,10 @@ cdbdisp_destroyDispatcherState(CdbDispatcherState *ds)
 		results->resultArray = NULL;
 	}
 
+	if (ds->dispatchParams != NULL &&
+		pDispatchFuncs->destroyDispatchParams != NULL)
+		(pDispatchFuncs->destroyDispatchParams) (ds->dispatchParams);
+
 	/*
 	 * Recycle or destroy gang accordingly.
 	 *
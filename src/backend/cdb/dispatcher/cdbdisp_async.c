@@ -4,10 +4,12 @@
  *	  Functions for asynchronous implementation of dispatching
  *	  commands to QExecutors.
  *
- * GPDB_12_MERGE_FIXME: We should switch to using WaitEventSetWait() instead
- * of straight poll() in this file. WaitEventSetWait() would report the status
- * using the new wait event infrastructure, so that it would show up as a
- * separate state in pg_stat_activity. It's also potentially more efficient.
+ * Results are collected through a WaitEventSet that is kept for the life of
+ * the dispatcher state, along with counts of the QEs still being waited on,
+ * so a wakeup only costs work for the QE connections that actually have data,
+ * and the wait shows up in pg_stat_activity.
+ * Flushing the dispatched command in cdbdisp_waitDispatchFinish_async()
+ * still uses a plain poll() over the connections with pending output.
  *
  *
  * Portions Copyright (c) 2005-2008, Greenplum inc
@@ -30,6 +32,7 @@
 #endif
 
 #include "storage/ipc.h"		/* For proc_exit_inprogress  */
+#include "storage/latch.h"
 #include "tcop/tcopprot.h"
 #include "cdb/cdbdisp.h"
 #include "cdb/cdbdisp_async.h"
@@ -43,7 +46,9 @@
 #include "miscadmin.h"
 #include "commands/sequence.h"
 #include "access/xact.h"
+#include "utils/faultinjector.h"
 #include "utils/timestamp.h"
+#include "utils/wait_event.h"
 #define DISPATCH_WAIT_TIMEOUT_MSEC 1000
 
 /*
@@ -91,6 +96,40 @@ typedef struct CdbDispatchCmdAsync
 	char	   *query_text;
 	int			query_text_len;
 
+	/*
+	 * Wait event set over the connections of the QEs we are still waiting
+	 * on, plus MyLatch so that interrupts wake us up.  It is built lazily by
+	 * checkDispatchResult() and rebuilt only when the set of connections to
+	 * wait on may have grown (more QEs dispatched, or we stopped skipping
+	 * acknowledged QEs), or when a connection we no longer wait on reports
+	 * readiness.  QEs that finish otherwise stay in the set; they are idle
+	 * and do not wake us up.
+	 *
+	 * waitEventResultIndex maps an event position to the index in
+	 * dispatchResultPtrArray, or -1 for the latch.
+	 */
+	WaitEventSet *waitEventSet;
+	WaitEvent  *occurredEvents;
+	int		   *waitEventResultIndex;
+	int			waitEventCount;
+	int			waitEventDispatchCount;
+	bool		waitEventSkipAcked;
+	bool		waitEventSetStale;
+
+	/*
+	 * Number of QEs we are still waiting on, and in DISPATCH_WAIT_ACK_ROOT
+	 * mode, of QEs that sent the acknowledge message.  They are computed by
+	 * scanDispatchResults() and then kept up to date by handlePollSuccess(),
+	 * so that waking up for one QE does not cost a pass over all of them.
+	 * Anything else that changes what we wait on sets waitCountsStale.  A
+	 * change of waitMode or of dispatchCount is noticed by itself.
+	 */
+	int			waitingCount;
+	int			ackCount;
+	bool		waitCountsStale;
+	int			waitCountsDispatchCount;
+	DispatchWaitMode waitCountsWaitMode;
+
 } CdbDispatchCmdAsync;
 
 static void *cdbdisp_makeDispatchParams_async(int maxSlices, int largestGangSize, char *queryText, int len);
@@ -108,6 +147,7 @@ static void	cdbdisp_waitDispatchFinish_async(struct CdbDispatcherState *ds);
 
 static bool	cdbdisp_checkForCancel_async(struct CdbDispatcherState *ds);
 static int *cdbdisp_getWaitSocketFds_async(struct CdbDispatcherState *ds, int *nsocks);
+static void cdbdisp_destroyDispatchParams_async(void *dispatchParams);
 
 DispatcherInternalFuncs DispatcherAsyncFuncs =
 {
@@ -117,7 +157,8 @@ DispatcherInternalFuncs DispatcherAsyncFuncs =
 	cdbdisp_checkAckMessage_async,
 	cdbdisp_checkDispatchResult_async,
 	cdbdisp_dispatchToGang_async,
-	cdbdisp_waitDispatchFinish_async
+	cdbdisp_waitDispatchFinish_async,
+	cdbdisp_destroyDispatchParams_async
 };
 
 
@@ -135,11 +176,20 @@ static void
 static void
 			checkSegmentAlive(CdbDispatchCmdAsync *pParms);
 
+static bool
+			isWaitingOnResult(CdbDispatchCmdAsync *pParms, CdbDispatchResult *dispatchResult);
+
+static void
+			scanDispatchResults(CdbDispatchCmdAsync *pParms);
+
+static void
+			prepareWaitEventSet(CdbDispatchCmdAsync *pParms);
+
 static void
 			handlePollError(CdbDispatchCmdAsync *pParms);
 
 static void
-			handlePollSuccess(CdbDispatchCmdAsync *pParms, struct pollfd *fds);
+			handlePollSuccess(CdbDispatchCmdAsync *pParms, WaitEvent *events, int nevents);
 
 static bool
 			checkAckMessage(CdbDispatchResult *dispatchResult, const char *message);
@@ -260,6 +310,7 @@ cdbdisp_waitDispatchFinish_async(struct CdbDispatcherState *ds)
 				char	   *msg = PQerrorMessage(conn);
 
 				qeResult->stillRunning = false;
+				pParms->waitCountsStale = true;
 				ereport(ERROR,
 						(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
 						 errmsg("Command could not be dispatch to segment %s: %s", qeResult->segdbDesc->whoami, msg ? msg : "unknown error")));
@@ -359,6 +410,7 @@ cdbdisp_checkAckMessage_async(struct CdbDispatcherState *ds, const char *message
 
 	for (int i = 0; i < pParms->dispatchCount; i++)
 		pParms->dispatchResultPtrArray[i]->receivedAckMsg = false;
+	pParms->waitCountsStale = true;
 
 	checkDispatchResult(ds, timeout_sec);
 
@@ -435,10 +487,179 @@ cdbdisp_makeDispatchParams_async(int maxSlices, int largestGangSize, char *query
 	pParms->ackMessage = NULL;
 	pParms->query_text = queryText;
 	pParms->query_text_len = len;
+	pParms->waitCountsStale = true;
 
 	return (void *) pParms;
 }
 
+/*
+ * Release the resources of a CdbDispatchCmdAsync structure that are not
+ * freed along with the dispatcher memory context.
+ */
+static void
+cdbdisp_destroyDispatchParams_async(void *dispatchParams)
+{
+	CdbDispatchCmdAsync *pParms = (CdbDispatchCmdAsync *) dispatchParams;
+
+	if (pParms->waitEventSet != NULL)
+	{
+		FreeWaitEventSet(pParms->waitEventSet);
+		pParms->waitEventSet = NULL;
+	}
+
+	/* The results were terminated by cdbdisp_destroyDispatcherState() */
+	pParms->waitCountsStale = true;
+}
+
+/*
+ * Are we still waiting for results from this QE?
+ *
+ * This decides which connections checkDispatchResult() waits on and which
+ * ready connections handlePollSuccess() processes.
+ */
+static bool
+isWaitingOnResult(CdbDispatchCmdAsync *pParms, CdbDispatchResult *dispatchResult)
+{
+	/*
+	 * NB: Since we might call cdbdisp_termResult before checkDispatchResult,
+	 * `stillRunning` should be checked before accessing segdbDesc->conn.
+	 * One case it will happen is that you cancel the query after
+	 * mppExecutorFinishup->cdbdisp_destroyDispatcherState and before
+	 * the Finishing is done.
+	 */
+	if (!dispatchResult->stillRunning)
+		return false;
+
+	if (pParms->waitMode == DISPATCH_WAIT_ACK_ROOT &&
+		dispatchResult->receivedAckMsg)
+		return false;
+
+	return true;
+}
+
+/*
+ * Count the QEs we are still waiting on, and the QEs that acknowledged, see
+ * CdbDispatchCmdAsync.  Also flush the output that has not been sent to the
+ * QEs yet; as long as some is left, the next call does this pass again.
+ */
+static void
+scanDispatchResults(CdbDispatchCmdAsync *pParms)
+{
+	bool		outputPending = false;
+	int			i;
+
+	pParms->waitingCount = 0;
+	pParms->ackCount = 0;
+
+	for (i = 0; i < pParms->dispatchCount; i++)
+	{
+		CdbDispatchResult *dispatchResult = pParms->dispatchResultPtrArray[i];
+		SegmentDatabaseDescriptor *segdbDesc;
+		PGconn	   *conn;
+
+		if (pParms->waitMode == DISPATCH_WAIT_ACK_ROOT &&
+			checkAckMessage(dispatchResult, pParms->ackMessage))
+		{
+			pParms->ackCount++;
+			continue;
+		}
+
+		/* Already finished with this QE? */
+		if (!isWaitingOnResult(pParms, dispatchResult))
+			continue;
+
+		segdbDesc = dispatchResult->segdbDesc;
+		conn = segdbDesc->conn;
+
+		Assert(!cdbconn_isBadConnection(segdbDesc));
+
+		/*
+		 * Flush out buffer in case some commands are not fully
+		 * dispatched to QEs, this can prevent QD from polling
+		 * on such QEs forever.
+		 */
+		if (conn->outCount > 0)
+		{
+			/*
+			 * Don't error out here, let following poll() routine to
+			 * handle it.
+			 */
+			if (pqFlush(conn) < 0)
+				elog(LOG, "Failed flushing outbound data to %s:%s",
+					 segdbDesc->whoami, PQerrorMessage(conn));
+			else if (conn->outCount > 0)
+				outputPending = true;
+		}
+
+		pParms->waitingCount++;
+	}
+
+	pParms->waitCountsStale = outputPending;
+	pParms->waitCountsDispatchCount = pParms->dispatchCount;
+	pParms->waitCountsWaitMode = pParms->waitMode;
+}
+
+/*
+ * Make sure pParms->waitEventSet covers every QE we are still waiting on.
+ */
+static void
+prepareWaitEventSet(CdbDispatchCmdAsync *pParms)
+{
+	MemoryContext cxt;
+	bool		skipAcked = (pParms->waitMode == DISPATCH_WAIT_ACK_ROOT);
+	int			i;
+
+	if (pParms->waitEventSet != NULL &&
+		!pParms->waitEventSetStale &&
+		pParms->waitEventDispatchCount == pParms->dispatchCount &&
+		!(pParms->waitEventSkipAcked && !skipAcked))
+		return;
+
+	cxt = GetMemoryChunkContext(pParms);
+
+	if (pParms->waitEventSet != NULL)
+	{
+		FreeWaitEventSet(pParms->waitEventSet);
+		pParms->waitEventSet = NULL;
+	}
+	if (pParms->occurredEvents != NULL)
+	{
+		pfree(pParms->occurredEvents);
+		pfree(pParms->waitEventResultIndex);
+	}
+
+	pParms->occurredEvents = (WaitEvent *)
+		MemoryContextAlloc(cxt, (pParms->dispatchCount + 1) * sizeof(WaitEvent));
+	pParms->waitEventResultIndex = (int *)
+		MemoryContextAlloc(cxt, (pParms->dispatchCount + 1) * sizeof(int));
+	pParms->waitEventSet = CreateWaitEventSet(cxt, pParms->dispatchCount + 1);
+
+	i = AddWaitEventToSet(pParms->waitEventSet, WL_LATCH_SET, PGINVALID_SOCKET,
+						  MyLatch, NULL);
+	pParms->waitEventResultIndex[i] = -1;
+
+	for (i = 0; i < pParms->dispatchCount; i++)
+	{
+		CdbDispatchResult *dispatchResult = pParms->dispatchResultPtrArray[i];
+		int			sock;
+		int			pos;
+
+		if (!isWaitingOnResult(pParms, dispatchResult))
+			continue;
+
+		sock = PQsocket(dispatchResult->segdbDesc->conn);
+		Assert(sock >= 0);
+		pos = AddWaitEventToSet(pParms->waitEventSet, WL_SOCKET_READABLE, sock,
+								NULL, NULL);
+		pParms->waitEventResultIndex[pos] = i;
+	}
+
+	pParms->waitEventCount = pParms->dispatchCount + 1;
+	pParms->waitEventDispatchCount = pParms->dispatchCount;
+	pParms->waitEventSkipAcked = skipAcked;
+	pParms->waitEventSetStale = false;
+}
+
 /*
  * Receive and process results from all running QEs.
  *
@@ -450,22 +671,15 @@ checkDispatchResult(CdbDispatcherState *ds, int timeout_sec)
 {
 	CdbDispatchCmdAsync *pParms = (CdbDispatchCmdAsync *) ds->dispatchParams;
 	CdbDispatchResults *meleeResults = ds->primaryResults;
-	SegmentDatabaseDescriptor *segdbDesc;
-	CdbDispatchResult *dispatchResult;
-	int			i;
-	int			db_count = 0;
+	MemoryContext oldcontext = CurrentMemoryContext;
 	int			timeout = 0;
 	bool		sentSignal = false;
-	struct pollfd *fds;
 	struct timeval start_ts, now;
 #ifdef USE_INTERNAL_FTS
 	uint8 ftsVersion = 0;
 #endif
 	int64		diff_us;
 
-	db_count = pParms->dispatchCount;
-	fds = (struct pollfd *) palloc(db_count * sizeof(struct pollfd));
-
 	/*
 	 * OK, we are finished submitting the command to the segdbs. Now, we have
 	 * to wait for them to finish.
@@ -473,11 +687,8 @@ checkDispatchResult(CdbDispatcherState *ds, int timeout_sec)
 	gettimeofday(&start_ts, NULL);
 	for (;;)
 	{
-		int			sock;
-		int			n;
-		int			nfds = 0;
-		int			ack_count = 0;
-		PGconn		*conn;
+		volatile int n;
+		volatile int savedInterruptHoldoffCount;
 
 		/*
 		 * bail-out if we are dying. Once QD dies, QE will recognize it
@@ -497,64 +708,17 @@ checkDispatchResult(CdbDispatcherState *ds, int timeout_sec)
 		/*
 		 * Which QEs are still running and could send results to us?
 		 */
-		for (i = 0; i < db_count; i++)
-		{
-			dispatchResult = pParms->dispatchResultPtrArray[i];
-
-			if (pParms->waitMode == DISPATCH_WAIT_ACK_ROOT &&
-				checkAckMessage(dispatchResult, pParms->ackMessage))
-			{
-				ack_count++;
-				continue;
-			}
-
-			/*
-			 * Already finished with this QE?
-			 * NB: Since we might call cdbdisp_termResult before checkDispatchResult, 
-			 * `stillRunning` should be checked before accessing segdbDesc->conn.
-			 * One case it will happen is that you cancel the query after 
-			 * mppExecutorFinishup->cdbdisp_destroyDispatcherState and before 
-			 * the Finishing is done.
-			 */
-			if (!dispatchResult->stillRunning)
-				continue;
-
-			segdbDesc = dispatchResult->segdbDesc;
-			conn = segdbDesc->conn;
-
-			Assert(!cdbconn_isBadConnection(segdbDesc));
-
-			/*
-			 * Flush out buffer in case some commands are not fully
-			 * dispatched to QEs, this can prevent QD from polling
-			 * on such QEs forever.
-			 */
-			if (conn->outCount > 0)
-			{
-				/*
-				 * Don't error out here, let following poll() routine to
-				 * handle it.
-				 */
-				if (pqFlush(conn) < 0)
-					elog(LOG, "Failed flushing outbound data to %s:%s",
-						 segdbDesc->whoami, PQerrorMessage(conn));
-			}
-
-			/*
-			 * Add socket to fd_set if still connected.
-			 */
-			sock = PQsocket(conn);
-			Assert(sock >= 0);
-			fds[nfds].fd = sock;
-			fds[nfds].events = POLLIN;
-			nfds++;
-		}
+		if (pParms->waitCountsStale ||
+			pParms->waitCountsDispatchCount != pParms->dispatchCount ||
+			pParms->waitCountsWaitMode != pParms->waitMode)
+			scanDispatchResults(pParms);
 
 		/*
 		 * Break out when no QEs still running or required QEs acked.
 		 */
-		if (nfds <= 0 ||
-			(pParms->waitMode == DISPATCH_WAIT_ACK_ROOT && ack_count == ds->rootGangSize))
+		if (pParms->waitingCount <= 0 ||
+			(pParms->waitMode == DISPATCH_WAIT_ACK_ROOT &&
+			 pParms->ackCount == ds->rootGangSize))
 			break;
 
 		/*
@@ -574,21 +738,45 @@ checkDispatchResult(CdbDispatcherState *ds, int timeout_sec)
 		else
 			timeout = DISPATCH_WAIT_CANCEL_TIMEOUT_MSEC;
 
-		n = poll(fds, nfds, timeout);
+		prepareWaitEventSet(pParms);
 
 		/*
-		 * poll returns with an error, including one due to an interrupted
-		 * call
+		 * WaitEventSetWait() reports a failure of the underlying epoll_wait()
+		 * or poll() as an ERROR, which we must not throw.  Handle it as
+		 * poll() errors always were, below.
 		 */
-		if (n < 0)
+		savedInterruptHoldoffCount = InterruptHoldoffCount;
+		PG_TRY();
 		{
-			int			sock_errno = SOCK_ERRNO;
+			SIMPLE_FAULT_INJECTOR("check_dispatch_result_wait");
 
-			if (sock_errno == EINTR)
-				continue;
+			n = WaitEventSetWait(pParms->waitEventSet, timeout,
+								 pParms->occurredEvents, pParms->waitEventCount,
+								 WAIT_EVENT_DISPATCH_RESULT);
+		}
+		PG_CATCH();
+		{
+			ErrorData  *edata;
 
-			elog(LOG, "handlePollError poll() failed; errno=%d", sock_errno);
+			/*
+			 * restore the previous value, which is reset to 0 in errfinish.
+			 */
+			MemoryContextSwitchTo(oldcontext);
+			InterruptHoldoffCount = savedInterruptHoldoffCount;
+			pgstat_report_wait_end();
 
+			edata = CopyErrorData();
+			FlushErrorState();
+			elog(LOG, "handlePollError WaitEventSetWait() failed: %s",
+				 edata->message);
+			FreeErrorData(edata);
+
+			n = -1;
+		}
+		PG_END_TRY();
+
+		if (n < 0)
+		{
 			handlePollError(pParms);
 
 			/*
@@ -606,13 +794,16 @@ checkDispatchResult(CdbDispatcherState *ds, int timeout_sec)
 				sentSignal = true;
 			}
 
+			/* Don't trust the wait event set after a failure */
+			pParms->waitEventSetStale = true;
+
 			gettimeofday(&now, NULL);
 			diff_us = (now.tv_sec - start_ts.tv_sec) * 1000000;
 			diff_us += (int) now.tv_usec - (int) start_ts.tv_usec;
 			if (timeout_sec >= 0 && diff_us >= timeout_sec * 1000000L)
 				break;
 		}
-		/* If the time limit expires, poll() returns 0 */
+		/* If the time limit expires, WaitEventSetWait() returns 0 */
 		else if (n == 0)
 		{
 			if (pParms->waitMode != DISPATCH_WAIT_NONE &&
@@ -646,10 +837,8 @@ checkDispatchResult(CdbDispatcherState *ds, int timeout_sec)
 		}
 		/* We have data waiting on one or more of the connections. */
 		else
-			handlePollSuccess(pParms, fds);
+			handlePollSuccess(pParms, pParms->occurredEvents, n);
 	}
-
-	pfree(fds);
 }
 
 /*
@@ -736,7 +925,7 @@ checkAckMessage(CdbDispatchResult *dispatchResult, const char *message)
 
 /*
  * Helper function to checkDispatchResult that handles errors that occur
- * during the poll() call.
+ * while waiting for the QEs.
  *
  * NOTE: The cleanup of the connections will be performed by handlePollTimeout().
  */
@@ -751,11 +940,7 @@ handlePollError(CdbDispatchCmdAsync *pParms)
 		SegmentDatabaseDescriptor *segdbDesc = dispatchResult->segdbDesc;
 
 		/* Skip if already finished or didn't dispatch. */
-		if (!dispatchResult->stillRunning)
-			continue;
-
-		if (pParms->waitMode == DISPATCH_WAIT_ACK_ROOT &&
-				 dispatchResult->receivedAckMsg)
+		if (!isWaitingOnResult(pParms, dispatchResult))
 			continue;
 
 		/* We're done with this QE, sadly. */
@@ -777,6 +962,7 @@ handlePollError(CdbDispatchCmdAsync *pParms)
 			PQfinish(segdbDesc->conn);
 			segdbDesc->conn = NULL;
 			dispatchResult->stillRunning = false;
+			pParms->waitCountsStale = true;
 		}
 	}
 	forwardQENotices();
@@ -789,43 +975,45 @@ handlePollError(CdbDispatchCmdAsync *pParms)
  */
 static void
 handlePollSuccess(CdbDispatchCmdAsync *pParms,
-				  struct pollfd *fds)
+				  WaitEvent *events, int nevents)
 {
-	int			currentFdNumber = 0;
-	int			i = 0;
+	int			ev;
 
 	/*
-	 * We have data waiting on one or more of the connections.
+	 * We have data waiting on one or more of the connections, or we were
+	 * woken up through our latch.
 	 */
-	for (i = 0; i < pParms->dispatchCount; i++)
+	for (ev = 0; ev < nevents; ev++)
 	{
 		bool		finished;
-		int			sock;
-		CdbDispatchResult *dispatchResult = pParms->dispatchResultPtrArray[i];
-		SegmentDatabaseDescriptor *segdbDesc = dispatchResult->segdbDesc;
-
-		/*
-		 * Skip if already finished or didn't dispatch.
-		 */
-		if (!dispatchResult->stillRunning)
-			continue;
+		int			i = pParms->waitEventResultIndex[events[ev].pos];
+		CdbDispatchResult *dispatchResult;
+		SegmentDatabaseDescriptor *segdbDesc;
 
-		if (pParms->waitMode == DISPATCH_WAIT_ACK_ROOT &&
-				 dispatchResult->receivedAckMsg)
+		if (events[ev].events & WL_LATCH_SET)
+		{
+			/* The caller rechecks for interrupts before waiting again. */
+			ResetLatch(MyLatch);
 			continue;
+		}
 
-		ELOG_DISPATCHER_DEBUG("looking for results from %d of %d (%s)",
-							  i + 1, pParms->dispatchCount, segdbDesc->whoami);
-
-		sock = PQsocket(segdbDesc->conn);
-		Assert(sock >= 0);
-		Assert(sock == fds[currentFdNumber].fd);
+		Assert(i >= 0 && i < pParms->dispatchCount);
+		dispatchResult = pParms->dispatchResultPtrArray[i];
 
 		/*
-		 * Skip this connection if it has no input available.
+		 * A QE we are no longer waiting on is still in the wait event set,
+		 * and its connection reports readiness. Drop it from the set, or we
+		 * would keep waking up for it.
 		 */
-		if (!(fds[currentFdNumber++].revents & POLLIN))
+		if (!isWaitingOnResult(pParms, dispatchResult))
+		{
+			pParms->waitEventSetStale = true;
 			continue;
+		}
+
+		segdbDesc = dispatchResult->segdbDesc;
+
+		Assert(events[ev].fd == PQsocket(segdbDesc->conn));
 
 		ELOG_DISPATCHER_DEBUG("PQsocket says there are results from %d of %d (%s)",
 							  i + 1, pParms->dispatchCount, segdbDesc->whoami);
@@ -835,6 +1023,19 @@ handlePollSuccess(CdbDispatchCmdAsync *pParms,
 		 */
 		finished = processResults(dispatchResult);
 
+		/*
+		 * Keep the counts of scanDispatchResults() up to date.  We were
+		 * waiting on this QE, so it was counted in waitingCount.
+		 */
+		if (pParms->waitMode == DISPATCH_WAIT_ACK_ROOT &&
+			checkAckMessage(dispatchResult, pParms->ackMessage))
+		{
+			pParms->ackCount++;
+			pParms->waitingCount--;
+		}
+		else if (finished)
+			pParms->waitingCount--;
+
 		/*
 		 * Are we through with this QE now?
 		 */
@@ -956,6 +1157,7 @@ checkSegmentAlive(CdbDispatchCmdAsync *pParms)
 			 */
 			PQfinish(segdbDesc->conn);
 			segdbDesc->conn = NULL;
+			pParms->waitCountsStale = true;
 		}
 	}
 }
@@ -37,6 +37,7 @@
 #include "utils/resgroup.h"
 #include "utils/resource_manager.h"
 #include "utils/session_state.h"
+#include "utils/snapmgr.h"
 #include "utils/typcache.h"
 #include "miscadmin.h"
 #include "mb/pg_wchar.h"
@@ -130,9 +131,23 @@ static SerializedParams *serializeParamsForDispatch(QueryDesc *queryDesc,
 													ParamExecData *execParams,
 													List *paramExecTypes,
 													Bitmapset *sendParams);
+static bool needSharedSnapshot(QueryDesc *queryDesc);
 
 
 
+/*
+ * Do the reader QEs of a cursor or bind/execute query need the writer QE's
+ * shared snapshot? Not when the snapshot carries no distributed snapshot,
+ * e.g. one from GetLocalTransactionSnapshot(): then every QE takes a local
+ * snapshot of its own, see setupQEDtxContext().
+ */
+static bool
+needSharedSnapshot(QueryDesc *queryDesc)
+{
+	return queryDesc->extended_query &&
+		ActiveSnapshotSet() && GetActiveSnapshot()->haveDistribSnapshot;
+}
+
 /*
  * Compose and dispatch the MPPEXEC commands corresponding to a plan tree
  * within a complete parallel plan. (A plan tree will correspond either
@@ -260,7 +275,7 @@ CdbDispatchPlan(struct QueryDesc *queryDesc,
 	 * and force it to set its snapshot; we'll then be able to serialize the
 	 * same snapshot version (see qdSerializeDtxContextInfo() below).
 	 */
-	if (queryDesc->extended_query)
+	if (needSharedSnapshot(queryDesc))
 	{
 		verify_shared_snapshot_ready(gp_command_count);
 	}
@@ -672,7 +687,7 @@ cdbdisp_buildPlanQueryParms(struct QueryDesc *queryDesc,
 	pQueryParms->serializedDtxContextInfo =
 		qdSerializeDtxContextInfo(&pQueryParms->serializedDtxContextInfolen,
 								  true /* wantSnapshot */ ,
-								  queryDesc->extended_query,
+								  needSharedSnapshot(queryDesc),
 								  mppTxnOptions(planRequiresTxn),
 								  "cdbdisp_buildPlanQueryParms");
 
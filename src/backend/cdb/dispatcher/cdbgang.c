@@ -583,7 +583,8 @@ makeCdbProcess(SegmentDatabaseDescriptor *segdbDesc)
 	if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_UDPIFC)
 		process->listenerPort = (segdbDesc->motionListener >> 16) & 0x0ffff;
 	else if (CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_TCP ||
-			 CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY)
+			 CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_PROXY ||
+			 CurrentMotionIPCLayer->ic_type == INTERCONNECT_TYPE_SHM)
 		process->listenerPort = (segdbDesc->motionListener & 0x0ffff);
 
 	process->pid = segdbDesc->backendPid;
@@ -9,6 +9,7 @@
 #include "../cdbdistributedsnapshot.c"
 
 #define SIZE_OF_IN_PROGRESS_ARRAY (10 * sizeof(DistributedTransactionId))
+#define MAX_SNAPSHOT_XID_COUNT 100
 
 static void
 test__DistributedSnapshotWithLocalMapping_CommittedTest(void **state)
@@ -153,6 +154,189 @@ test__DistributedSnapshotWithLocalMapping_CommittedTest(void **state)
 	free(dslm.inProgressMappedLocalXids);
 }
 
+/*
+ * Serialize the snapshot and read it back, checking that the in-progress
+ * xids survive the encoding as distances from xmin.
+ */
+static void
+check_serialize_roundtrip(DistributedSnapshot *ds)
+{
+	DistributedSnapshot result;
+	char	   *buf;
+	int			size;
+	int			i;
+
+	size = DistributedSnapshot_SerializeSize(ds);
+	buf = malloc(size);
+	assert_int_equal(DistributedSnapshot_Serialize(ds, buf), size);
+
+	memset(&result, 0, sizeof(result));
+	result.inProgressXidArray =
+		(DistributedTransactionId *) malloc(MAX_SNAPSHOT_XID_COUNT * sizeof(DistributedTransactionId));
+	assert_int_equal(DistributedSnapshot_Deserialize(buf, size, &result), size);
+
+	assert_true(result.xminAllDistributedSnapshots == ds->xminAllDistributedSnapshots);
+	assert_int_equal(result.distribSnapshotId, ds->distribSnapshotId);
+	assert_true(result.xmin == ds->xmin);
+	assert_true(result.xmax == ds->xmax);
+	assert_int_equal(result.count, ds->count);
+	for (i = 0; i < ds->count; i++)
+		assert_true(result.inProgressXidArray[i] == ds->inProgressXidArray[i]);
+
+	free(result.inProgressXidArray);
+	free(buf);
+}
+
+static void
+test__DistributedSnapshot_Serialize_Empty(void **state)
+{
+	DistributedSnapshot ds;
+
+	will_return_count(GetMaxSnapshotXidCount, MAX_SNAPSHOT_XID_COUNT, -1);
+
+	ds.xminAllDistributedSnapshots = 3;
+	ds.distribSnapshotId = 12345;
+	ds.xmin = 3;
+	ds.xmax = 3;
+	ds.count = 0;
+	ds.inProgressXidArray = NULL;
+
+	assert_int_equal(DistributedSnapshot_SerializeSize(&ds),
+					 sizeof(DistributedSnapshotId) +
+					 3 * sizeof(DistributedTransactionId) + sizeof(int32));
+	check_serialize_roundtrip(&ds);
+}
+
+static void
+test__DistributedSnapshot_Serialize_LargeGaps(void **state)
+{
+	DistributedSnapshot ds;
+	DistributedTransactionId xids[] = {
+		1000,						/* distance 0 */
+		1000 + 0x7F,				/* largest one-byte distance */
+		1000 + 0x80,				/* smallest two-byte distance */
+		1000 + 0x3FFF,
+		1000 + 0x4000,
+		1000 + UINT64CONST(0xFFFFFFFF),
+		1000 + UINT64CONST(0x100000000),
+		999,						/* wraps around, the longest encoding */
+		PG_UINT64_MAX
+	};
+	int			nxids = lengthof(xids);
+
+	will_return_count(GetMaxSnapshotXidCount, MAX_SNAPSHOT_XID_COUNT, -1);
+
+	ds.xminAllDistributedSnapshots = 1000;
+	ds.distribSnapshotId = 12345;
+	ds.xmin = 1000;
+	ds.xmax = PG_UINT64_MAX;
+	ds.count = nxids;
+	ds.inProgressXidArray = xids;
+
+	/* 1 + 1 + 2 + 2 + 3 + 5 + 5 + 10 + 10 bytes for the xids */
+	assert_int_equal(DistributedSnapshot_SerializeSize(&ds),
+					 sizeof(DistributedSnapshotId) +
+					 3 * sizeof(DistributedTransactionId) + sizeof(int32) + 39);
+	check_serialize_roundtrip(&ds);
+}
+
+static void
+test__DistributedSnapshot_Serialize_MaxCount(void **state)
+{
+	DistributedSnapshot ds;
+	DistributedSnapshot result;
+	char	   *buf;
+	int			size;
+	int			i;
+
+	will_return_count(GetMaxSnapshotXidCount, MAX_SNAPSHOT_XID_COUNT, -1);
+
+	ds.xminAllDistributedSnapshots = 100;
+	ds.distribSnapshotId = 12345;
+	ds.xmin = 100;
+	ds.xmax = 100 + 1000 * (MAX_SNAPSHOT_XID_COUNT + 1);
+	ds.count = MAX_SNAPSHOT_XID_COUNT;
+	ds.inProgressXidArray =
+		(DistributedTransactionId *) malloc((MAX_SNAPSHOT_XID_COUNT + 1) * sizeof(DistributedTransactionId));
+	for (i = 0; i < MAX_SNAPSHOT_XID_COUNT + 1; i++)
+		ds.inProgressXidArray[i] = ds.xmin + 1000 * i;
+
+	check_serialize_roundtrip(&ds);
+
+	/* one more xid than a snapshot can hold is rejected */
+	ds.count = MAX_SNAPSHOT_XID_COUNT + 1;
+	size = DistributedSnapshot_SerializeSize(&ds);
+	buf = malloc(size);
+	DistributedSnapshot_Serialize(&ds, buf);
+
+	memset(&result, 0, sizeof(result));
+	PG_TRY();
+	{
+		DistributedSnapshot_Deserialize(buf, size, &result);
+		assert_true(false);		/* should not be reached */
+	}
+	PG_CATCH();
+	{
+		FlushErrorState();
+	}
+	PG_END_TRY();
+
+	assert_true(result.inProgressXidArray == NULL);
+
+	free(buf);
+	free(ds.inProgressXidArray);
+}
+
+static void
+test__DistributedSnapshot_Deserialize_Truncated(void **state)
+{
+	DistributedSnapshot ds;
+	DistributedSnapshot result;
+	DistributedTransactionId xids[] = {1000, 1000 + 0x4000};
+	char	   *buf;
+	int			size;
+	int			len;
+
+	will_return_count(GetMaxSnapshotXidCount, MAX_SNAPSHOT_XID_COUNT, -1);
+
+	ds.xminAllDistributedSnapshots = 1000;
+	ds.distribSnapshotId = 12345;
+	ds.xmin = 1000;
+	ds.xmax = 1000 + 0x5000;
+	ds.count = lengthof(xids);
+	ds.inProgressXidArray = xids;
+
+	size = DistributedSnapshot_SerializeSize(&ds);
+	buf = malloc(size);
+	DistributedSnapshot_Serialize(&ds, buf);
+
+	/*
+	 * Cutting the buffer anywhere, in the fixed-size fields or in the middle
+	 * of the last xid, is an error rather than a read past its end.
+	 */
+	for (len = 0; len < size; len++)
+	{
+		memset(&result, 0, sizeof(result));
+		result.inProgressXidArray =
+			(DistributedTransactionId *) malloc(MAX_SNAPSHOT_XID_COUNT * sizeof(DistributedTransactionId));
+
+		PG_TRY();
+		{
+			DistributedSnapshot_Deserialize(buf, len, &result);
+			assert_true(false);		/* should not be reached */
+		}
+		PG_CATCH();
+		{
+			FlushErrorState();
+		}
+		PG_END_TRY();
+
+		free(result.inProgressXidArray);
+	}
+
+	free(buf);
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -160,7 +344,11 @@ main(int argc, char* argv[])
 
 	const UnitTest tests[] =
 	{
-		unit_test(test__DistributedSnapshotWithLocalMapping_CommittedTest)
+		unit_test(test__DistributedSnapshotWithLocalMapping_CommittedTest),
+		unit_test(test__DistributedSnapshot_Serialize_Empty),
+		unit_test(test__DistributedSnapshot_Serialize_LargeGaps),
+		unit_test(test__DistributedSnapshot_Serialize_MaxCount),
+		unit_test(test__DistributedSnapshot_Deserialize_Truncated)
 	};
 
 	MemoryContextInit();
@@ -124,6 +124,7 @@
 #include "catalog/heap.h"
 #include "catalog/pg_am.h"
 #include "cdb/cdbappendonlyam.h"
+#include "cdb/cdbcardfeedback.h"
 #include "cdb/cdbaocsam.h"
 #include "cdb/cdbdisp_query.h"
 #include "cdb/cdbdispatchresult.h"
@@ -961,6 +962,13 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 							thisdata->attr_cnt, thisdata->vacattrstats);
 		}
 
+		/*
+		 * GPDB: the cardinality corrections learned by GPORCA were relative
+		 * to the statistics we just replaced.
+		 */
+		if (Gp_role == GP_ROLE_DISPATCH)
+			CardFeedbackForgetRelation(RelationGetRelid(onerel));
+
 		/*
 		 * Should we build extended statistics for this relation?
 		 *
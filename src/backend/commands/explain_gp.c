@@ -697,6 +697,45 @@ cdbexplain_recvStatWalker(PlanState *planstate, void *context)
 }								/* cdbexplain_recvStatWalker */
 
 
+/*
+ * cdbexplain_getNodeRows
+ *	  Rows produced by a PlanState node, summed over the qExecs that ran it,
+ *	  from the statistics that cdbexplain_recvExecStats() attached to it.
+ *	  '*nloops' is summed likewise, and '*ninst' is the number of qExecs that
+ *	  sent statistics for the node.  Returns false if there are none.
+ */
+bool
+cdbexplain_getNodeRows(PlanState *planstate, double *ntuples, double *nloops,
+					   int *ninst)
+{
+	CdbExplain_NodeSummary *ns;
+	int			i;
+
+	*ntuples = 0;
+	*nloops = 0;
+	*ninst = 0;
+
+	if (!planstate->instrument || !planstate->instrument->cdbNodeSummary)
+		return false;
+
+	ns = planstate->instrument->cdbNodeSummary;
+	for (i = 0; i < ns->ninst; i++)
+	{
+		CdbExplain_StatInst *nsi = &ns->insts[i];
+
+		/* slots of qExecs that sent nothing are left zeroed */
+		if (nsi->pstype != planstate->type)
+			continue;
+
+		*ntuples += nsi->ntuples;
+		*nloops += nsi->nloops;
+		(*ninst)++;
+	}
+
+	return *ninst > 0;
+}
+
+
 /*
  * cdbexplain_collectSliceStats
  *	  Obtain per-slice statistical observations from the current slice
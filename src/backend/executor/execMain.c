@@ -96,6 +96,7 @@
 #include "executor/nodeSubplan.h"
 #include "foreign/fdwapi.h"
 #include "libpq/pqformat.h"
+#include "cdb/cdbcardfeedback.h"
 #include "cdb/cdbdisp_query.h"
 #include "cdb/cdbdispatchresult.h"
 #include "cdb/cdbexplain.h"             /* cdbexplain_sendExecStats() */
@@ -254,6 +255,13 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 		}
 	}
 
+	/*
+	 * GPDB: with cardinality feedback, have the QEs send back the rows
+	 * produced by each node.
+	 */
+	if (Gp_role == GP_ROLE_DISPATCH && optimizer_cardinality_feedback)
+		CardFeedbackExecutorStart(queryDesc, eflags);
+
 	/*
 	 * If the transaction is read-only, we need to check if any writes are
 	 * planned to non-temporary tables.  EXPLAIN is considered read-only.
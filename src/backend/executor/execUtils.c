@@ -90,6 +90,7 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "storage/ipc.h"
+#include "cdb/cdbcardfeedback.h"
 #include "cdb/cdbexplain.h"
 #include "cdb/cdbllize.h"
 #include "utils/guc.h"
@@ -2147,6 +2148,9 @@ uint64 mppExecutorWait(QueryDesc *queryDesc)
 			cdbexplain_recvExecStats(queryDesc->planstate, ds->primaryResults,
 										LocallyExecutingSliceIndex(queryDesc->estate),
 										estate->showstatctx);
+
+			/* learn from the rows the scans actually produced */
+			CardFeedbackRecord(queryDesc);
 		}
 		/* get num of rows processed from writer QEs. */
 		es_processed +=
@@ -23,13 +23,17 @@
 #include "gpos/_api.h"
 #include "gpos/memory/CMemoryPoolManager.h"
 
+#include "gpdbcost/CCostModelParamsGPDB.h"
 #include "gpopt/gpdbwrappers.h"
 #include "gpopt/init.h"
 #include "naucrates/exception.h"
 #include "naucrates/init.h"
 
+extern "C" {
+#include "optimizer/orca.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
+}
 
 extern MemoryContext MessageContext;
 
@@ -301,4 +305,21 @@ TerminateGPOPT()
 }
 }
 
+//---------------------------------------------------------------------------
+//	@function:
+//		IsValidOptimizerCostParam()
+//
+//	@doc:
+//		Check the name of a cost model parameter, for the GUC check hook of
+//		optimizer_cost_param_factors
+//
+//---------------------------------------------------------------------------
+extern "C" {
+bool
+IsValidOptimizerCostParam(const char *name)
+{
+	return gpopt::CCostModelParamsGPDB::IsValidParamName(name);
+}
+}
+
 // EOF
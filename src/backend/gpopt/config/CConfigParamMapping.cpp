@@ -290,6 +290,10 @@ CConfigParamMapping::SConfigMappingElem CConfigParamMapping::m_elements[] = {
 	 false,	 // m_negate_param
 	 GPOS_WSZ_LIT(
 		 "Explore a nested loop join even if a hash join is possible")},
+	{EopttraceColumnProjectionCost, &optimizer_enable_column_projection_cost,
+	 false,	 // m_negate_param
+	 GPOS_WSZ_LIT(
+		 "Cost scans of column-oriented tables by the width of the columns they read.")},
 
 };
 
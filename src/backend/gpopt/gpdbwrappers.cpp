@@ -33,6 +33,7 @@
 #include "catalog/pg_collation.h"
 extern "C" {
 #include "access/external.h"
+#include "cdb/cdbcardfeedback.h"
 #include "catalog/pg_inherits.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
@@ -2252,6 +2253,28 @@ gpdb::CheckCollation(Node *node)
 	return -1;
 }
 
+bool
+gpdb::HasPartitionwiseJoinCandidate(Query *query)
+{
+	GP_WRAP_START;
+	{
+		return has_partitionwise_join_candidate(query);
+	}
+	GP_WRAP_END;
+	return false;
+}
+
+bool
+gpdb::HasPartitionwiseAggCandidate(Query *query)
+{
+	GP_WRAP_START;
+	{
+		return has_partitionwise_agg_candidate(query);
+	}
+	GP_WRAP_END;
+	return false;
+}
+
 Node *
 gpdb::CoerceToCommonType(ParseState *pstate, Node *node, Oid target_type,
 						 const char *context)
@@ -2848,4 +2871,15 @@ gpdb::GPDBLockRelationOid(Oid reloid, LOCKMODE lockmode)
 	GP_WRAP_END;
 }
 
+CardFeedbackEntry *
+gpdb::GetCardFeedbackEntries(int *nentries)
+{
+	GP_WRAP_START;
+	{
+		return CardFeedbackGetEntries(MyDatabaseId, nentries);
+	}
+	GP_WRAP_END;
+	return nullptr;
+}
+
 // EOF
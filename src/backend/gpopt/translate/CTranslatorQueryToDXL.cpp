@@ -208,6 +208,9 @@ CTranslatorQueryToDXL::CTranslatorQueryToDXL(
 	// check if the query has SIRV functions in the targetlist without a FROM clause
 	CheckSirvFuncsWithoutFromClause(query);
 
+	// check if the planner would join or aggregate partition by partition
+	CheckPartitionwisePlans(query);
+
 	// first normalize the query
 	m_query =
 		CQueryMutators::NormalizeQuery(m_mp, m_md_accessor, query, query_level);
@@ -345,6 +348,35 @@ CTranslatorQueryToDXL::CheckSirvFuncsWithoutFromClause(Query *query)
 	}
 }
 
+//---------------------------------------------------------------------------
+//	@function:
+//		CTranslatorQueryToDXL::CheckPartitionwisePlans
+//
+//	@doc:
+//		ORCA has no partition-wise join or aggregate: it joins or aggregates
+//		all the partitions of a table at once, with one big hash table. When
+//		enable_partitionwise_join or enable_partitionwise_aggregate is on and
+//		the query joins co-partitioned tables on their partition keys, or
+//		groups a partitioned table by its partition key, fall back to the
+//		planner, which processes one partition (pair) at a time
+//
+//---------------------------------------------------------------------------
+void
+CTranslatorQueryToDXL::CheckPartitionwisePlans(Query *query)
+{
+	if (gpdb::HasPartitionwiseJoinCandidate(query))
+	{
+		GPOS_RAISE(gpdxl::ExmaDXL, gpdxl::ExmiQuery2DXLUnsupportedFeature,
+				   GPOS_WSZ_LIT("Partition-wise join"));
+	}
+
+	if (gpdb::HasPartitionwiseAggCandidate(query))
+	{
+		GPOS_RAISE(gpdxl::ExmaDXL, gpdxl::ExmiQuery2DXLUnsupportedFeature,
+				   GPOS_WSZ_LIT("Partition-wise aggregate"));
+	}
+}
+
 //---------------------------------------------------------------------------
 //	@function:
 //		CTranslatorQueryToDXL::HasSirvFunctions
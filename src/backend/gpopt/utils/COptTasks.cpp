@@ -16,6 +16,7 @@
 #include "gpopt/utils/COptTasks.h"
 
 extern "C" {
+#include "cdb/cdbcardfeedback.h"
 #include "cdb/cdbvars.h"
 #include "utils/fmgroids.h"
 #include "utils/guc.h"
@@ -375,13 +376,34 @@ COptTasks::CreateOptimizerConfig(CMemoryPool *mp, ICostModel *cost_model)
 		(ULONG) optimizer_push_group_by_below_setop_threshold;
 	ULONG xform_bind_threshold = (ULONG) optimizer_xform_bind_threshold;
 
+	CStatisticsConfig *stats_config = GPOS_NEW(mp)
+		CStatisticsConfig(mp, damping_factor_filter, damping_factor_join,
+						  damping_factor_groupby, MAX_STATS_BUCKETS);
+
+	// corrections learned from the execution of earlier queries
+	int num_feedback = 0;
+	CardFeedbackEntry *feedback = gpdb::GetCardFeedbackEntries(&num_feedback);
+	for (int i = 0; i < num_feedback; i++)
+	{
+		INT attnos[CARD_FEEDBACK_MAX_ATTS];
+		for (int j = 0; j < feedback[i].key.natts; j++)
+		{
+			attnos[j] = feedback[i].key.attnos[j];
+		}
+		stats_config->AddCardinalityFeedback(
+			feedback[i].key.relid, attnos, feedback[i].key.natts,
+			feedback[i].key.opnos, feedback[i].key.nops,
+			CDouble(exp(feedback[i].logfactor)));
+	}
+	if (nullptr != feedback)
+	{
+		gpdb::GPDBFree(feedback);
+	}
+
 	return GPOS_NEW(mp) COptimizerConfig(
 		GPOS_NEW(mp)
 			CEnumeratorConfig(mp, plan_id, num_samples, cost_threshold),
-		GPOS_NEW(mp)
-			CStatisticsConfig(mp, damping_factor_filter, damping_factor_join,
-							  damping_factor_groupby, MAX_STATS_BUCKETS),
-		GPOS_NEW(mp) CCTEConfig(cte_inlining_cutoff), cost_model,
+		stats_config, GPOS_NEW(mp) CCTEConfig(cte_inlining_cutoff), cost_model,
 		GPOS_NEW(mp)
 			CHint(gpos::int_max /* optimizer_parts_to_force_sort_on_insert */,
 				  join_arity_for_associativity_commutativity,
@@ -430,6 +452,31 @@ COptTasks::SetCostModelParams(ICostModel *cost_model)
 			cost_param->GetLowerBoundVal() * optimizer_sort_factor,
 			cost_param->GetUpperBoundVal() * optimizer_sort_factor);
 	}
+
+	// scale the parameters listed in optimizer_cost_param_factors, usually
+	// the output of a calibration run on this cluster
+	if (nullptr != optimizer_cost_param_factors)
+	{
+		for (int i = 0; i < optimizer_cost_param_factors->nitems; i++)
+		{
+			const OptimizerCostParamFactor *item =
+				&optimizer_cost_param_factors->items[i];
+			ICostModelParams::SCostParam *cost_param =
+				cost_model->GetCostModelParams()->PcpLookup(item->name);
+
+			// the names were checked when the GUC was set
+			GPOS_ASSERT(nullptr != cost_param);
+			if (nullptr == cost_param)
+			{
+				continue;
+			}
+
+			cost_model->GetCostModelParams()->SetParam(
+				cost_param->Id(), cost_param->Get() * item->factor,
+				cost_param->GetLowerBoundVal() * item->factor,
+				cost_param->GetUpperBoundVal() * item->factor);
+		}
+	}
 }
 
 
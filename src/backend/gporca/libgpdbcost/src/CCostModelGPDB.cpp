@@ -1859,8 +1859,20 @@ CCostModelGPDB::CostScan(CMemoryPool *,	 // mp
 		pcmgpdb->GetCostModelParams()
 			->PcpLookup(CCostModelParamsGPDB::EcpInitScanFactor)
 			->Get();
-	const CDouble dTableWidth =
-		CPhysicalScan::PopConvert(pop)->PstatsBaseTable()->Width();
+	CPhysicalScan *popScan = CPhysicalScan::PopConvert(pop);
+	CDouble dTableWidth = popScan->PstatsBaseTable()->Width();
+
+	// a sequential scan of an append-optimized, column-oriented table only
+	// reads the files of the columns it has to produce, so it is charged by
+	// their width rather than by the width of the whole row; at least one
+	// column is always read
+	if (GPOS_FTRACE(EopttraceColumnProjectionCost) &&
+		IMDRelation::ErelstorageAppendOnlyCols ==
+			popScan->Ptabdesc()->RetrieveRelStorageType())
+	{
+		dTableWidth =
+			std::max(std::min(pci->Width(), dTableWidth.Get()), 1.0);
+	}
 
 	// Get total rows for each host to scan
 	const CDouble dTableScanCostUnit =
@@ -494,6 +494,33 @@ CCostModelParamsGPDB::PcpLookup(const CHAR *szName) const
 }
 
 
+//---------------------------------------------------------------------------
+//	@function:
+//		CCostModelParamsGPDB::IsValidParamName
+//
+//	@doc:
+//		Check whether there is a param of the given name; unlike PcpLookup,
+//		this doesn't need an instance, so it can be used to validate names
+//		before the cost model is set up
+//
+//---------------------------------------------------------------------------
+BOOL
+CCostModelParamsGPDB::IsValidParamName(const CHAR *szName)
+{
+	GPOS_ASSERT(nullptr != szName);
+
+	for (ULONG ul = 0; ul < EcpSentinel; ul++)
+	{
+		if (0 == clib::Strcmp(szName, rgszCostParamNames[ul]))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 //---------------------------------------------------------------------------
 //	@function:
 //		CCostModelParamsGPDB::SetParam
@@ -13,19 +13,82 @@
 
 #include "gpos/base.h"
 #include "gpos/common/CDouble.h"
+#include "gpos/common/CDynamicPtrArray.h"
 #include "gpos/common/CRefCount.h"
 #include "gpos/memory/CMemoryPool.h"
 
+#include "naucrates/dxl/gpdb_types.h"
 #include "naucrates/md/CMDIdColStats.h"
 #include "naucrates/md/IMDId.h"
 
 #define MAX_STATS_BUCKETS ULONG(100)
 
+// max number of columns in the filter of a cardinality feedback entry
+#define GPOPT_CARD_FEEDBACK_MAX_COLS ULONG(8)
+
+// max number of distinct operators in the filter of a cardinality feedback
+// entry
+#define GPOPT_CARD_FEEDBACK_MAX_OPS ULONG(8)
+
 namespace gpopt
 {
 using namespace gpos;
 using namespace gpmd;
 
+//---------------------------------------------------------------------------
+//	@struct:
+//		SCardinalityFeedback
+//
+//	@doc:
+//		Correction of the estimated cardinality of a filter on a table,
+//		learned by the host from earlier executions. The filter is
+//		identified by the columns it references and the operators it
+//		applies, its constants are ignored
+//
+//---------------------------------------------------------------------------
+struct SCardinalityFeedback
+{
+	// oid of the table
+	OID m_rel_oid;
+
+	// number of columns referenced by the filter
+	ULONG m_num_attnos;
+
+	// attribute numbers of the columns, in ascending order
+	INT m_attnos[GPOPT_CARD_FEEDBACK_MAX_COLS];
+
+	// number of distinct operators in the filter
+	ULONG m_num_opnos;
+
+	// oids of the operators, in ascending order
+	OID m_opnos[GPOPT_CARD_FEEDBACK_MAX_OPS];
+
+	// actual rows divided by estimated rows
+	CDouble m_factor;
+
+	SCardinalityFeedback(OID rel_oid, const INT *attnos, ULONG num_attnos,
+						 const OID *opnos, ULONG num_opnos, CDouble factor)
+		: m_rel_oid(rel_oid),
+		  m_num_attnos(num_attnos),
+		  m_num_opnos(num_opnos),
+		  m_factor(factor)
+	{
+		GPOS_ASSERT(num_attnos <= GPOPT_CARD_FEEDBACK_MAX_COLS);
+		GPOS_ASSERT(num_opnos <= GPOPT_CARD_FEEDBACK_MAX_OPS);
+		for (ULONG ul = 0; ul < num_attnos; ul++)
+		{
+			m_attnos[ul] = attnos[ul];
+		}
+		for (ULONG ul = 0; ul < num_opnos; ul++)
+		{
+			m_opnos[ul] = opnos[ul];
+		}
+	}
+};
+
+using CardinalityFeedbackArray =
+	CDynamicPtrArray<SCardinalityFeedback, CleanupDelete>;
+
 //---------------------------------------------------------------------------
 //	@class:
 //		CStatisticsConfig
@@ -56,6 +119,9 @@ private:
 	// hash set of md ids for columns with missing statistics
 	MdidHashSet *m_phsmdidcolinfo;
 
+	// cardinality corrections for filters on tables
+	CardinalityFeedbackArray *m_cardinality_feedback;
+
 public:
 	// ctor
 	CStatisticsConfig(CMemoryPool *mp, CDouble damping_factor_filter,
@@ -99,6 +165,17 @@ public:
 	// collect the missing statistics columns
 	void CollectMissingStatsColumns(IMdIdArray *pdrgmdid);
 
+	// add a cardinality correction for a filter on a table
+	void AddCardinalityFeedback(OID rel_oid, const INT *attnos,
+								ULONG num_attnos, const OID *opnos,
+								ULONG num_opnos, CDouble factor);
+
+	// cardinality correction for a filter with the given operators on the
+	// given columns of a table, 1.0 if there is none
+	CDouble DCardinalityFeedback(OID rel_oid, const INT *attnos,
+								 ULONG num_attnos, const OID *opnos,
+								 ULONG num_opnos) const;
+
 	// generate default optimizer configurations
 	static CStatisticsConfig *
 	PstatsconfDefault(CMemoryPool *mp)
@@ -38,6 +38,16 @@ private:
 	// table descriptor
 	CTableDescriptor *m_ptabdesc;
 
+	// collect the sorted, distinct operators of a filter for cardinality
+	// feedback, return false if there are too many
+	static BOOL FCollectFeedbackOperators(CExpression *pexprScalar, OID *opnos,
+										  ULONG *num_opnos);
+
+	// correct the stats of a filter on a table with execution feedback
+	static IStatistics *PstatsApplyCardinalityFeedback(
+		CMemoryPool *mp, CExpressionHandle &exprhdl, CExpression *pexprScalar,
+		IStatistics *child_stats, IStatistics *stats);
+
 public:
 	CLogicalSelect(const CLogicalSelect &) = delete;
 
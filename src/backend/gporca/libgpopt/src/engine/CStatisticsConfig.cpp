@@ -39,7 +39,8 @@ CStatisticsConfig::CStatisticsConfig(CMemoryPool *mp,
 	  m_damping_factor_join(damping_factor_join),
 	  m_damping_factor_groupby(damping_factor_groupby),
 	  m_max_stats_buckets(max_stats_buckets),
-	  m_phsmdidcolinfo(nullptr)
+	  m_phsmdidcolinfo(nullptr),
+	  m_cardinality_feedback(nullptr)
 {
 	GPOS_ASSERT(CDouble(0.0) < damping_factor_filter);
 	GPOS_ASSERT(CDouble(0.0) <= damping_factor_join);
@@ -48,6 +49,7 @@ CStatisticsConfig::CStatisticsConfig(CMemoryPool *mp,
 
 	//m_phmmdidcolinfo = New(m_mp) HMMDIdMissingstatscol(m_mp);
 	m_phsmdidcolinfo = GPOS_NEW(m_mp) MdidHashSet(m_mp);
+	m_cardinality_feedback = GPOS_NEW(m_mp) CardinalityFeedbackArray(m_mp);
 }
 
 
@@ -63,6 +65,7 @@ CStatisticsConfig::CStatisticsConfig(CMemoryPool *mp,
 CStatisticsConfig::~CStatisticsConfig()
 {
 	m_phsmdidcolinfo->Release();
+	m_cardinality_feedback->Release();
 }
 
 //---------------------------------------------------------------------------
@@ -109,5 +112,79 @@ CStatisticsConfig::CollectMissingStatsColumns(IMdIdArray *pdrgmdid)
 	}
 }
 
+//---------------------------------------------------------------------------
+//      @function:
+//              CStatisticsConfig::AddCardinalityFeedback
+//
+//      @doc:
+//              Add a cardinality correction for a filter on a table, the
+//              attribute numbers and the operator oids must be in ascending
+//              order
+//
+//---------------------------------------------------------------------------
+void
+CStatisticsConfig::AddCardinalityFeedback(OID rel_oid, const INT *attnos,
+										  ULONG num_attnos, const OID *opnos,
+										  ULONG num_opnos, CDouble factor)
+{
+	GPOS_ASSERT(nullptr != attnos);
+	GPOS_ASSERT(nullptr != opnos);
+	GPOS_ASSERT(CDouble(0.0) < factor);
+
+	if (0 == num_attnos || GPOPT_CARD_FEEDBACK_MAX_COLS < num_attnos ||
+		GPOPT_CARD_FEEDBACK_MAX_OPS < num_opnos)
+	{
+		return;
+	}
+
+	m_cardinality_feedback->Append(GPOS_NEW(m_mp) SCardinalityFeedback(
+		rel_oid, attnos, num_attnos, opnos, num_opnos, factor));
+}
+
+
+//---------------------------------------------------------------------------
+//      @function:
+//              CStatisticsConfig::DCardinalityFeedback
+//
+//      @doc:
+//              Cardinality correction for a filter with the given operators
+//              on the given columns of a table, 1.0 if there is none
+//
+//---------------------------------------------------------------------------
+CDouble
+CStatisticsConfig::DCardinalityFeedback(OID rel_oid, const INT *attnos,
+										ULONG num_attnos, const OID *opnos,
+										ULONG num_opnos) const
+{
+	const ULONG size = m_cardinality_feedback->Size();
+	for (ULONG ul = 0; ul < size; ul++)
+	{
+		SCardinalityFeedback *feedback = (*m_cardinality_feedback)[ul];
+		if (feedback->m_rel_oid != rel_oid ||
+			feedback->m_num_attnos != num_attnos ||
+			feedback->m_num_opnos != num_opnos)
+		{
+			continue;
+		}
+
+		BOOL matches = true;
+		for (ULONG ulCol = 0; matches && ulCol < num_attnos; ulCol++)
+		{
+			matches = (feedback->m_attnos[ulCol] == attnos[ulCol]);
+		}
+		for (ULONG ulOp = 0; matches && ulOp < num_opnos; ulOp++)
+		{
+			matches = (feedback->m_opnos[ulOp] == opnos[ulOp]);
+		}
+
+		if (matches)
+		{
+			return feedback->m_factor;
+		}
+	}
+
+	return CDouble(1.0);
+}
+
 
 // EOF
@@ -17,11 +17,19 @@
 #include "gpopt/base/CColRefSetIter.h"
 #include "gpopt/base/CColRefTable.h"
 #include "gpopt/base/COptCtxt.h"
+#include "gpopt/base/CUtils.h"
 #include "gpopt/operators/CExpression.h"
 #include "gpopt/operators/CExpressionHandle.h"
 #include "gpopt/operators/CPatternTree.h"
 #include "gpopt/operators/CPredicateUtils.h"
+#include "gpopt/operators/CScalarArrayCmp.h"
+#include "gpopt/operators/CScalarCmp.h"
+#include "gpopt/operators/CScalarIsDistinctFrom.h"
+#include "gpopt/operators/CScalarNullIf.h"
+#include "gpopt/operators/CScalarOp.h"
+#include "naucrates/md/CMDIdGPDB.h"
 #include "naucrates/statistics/CFilterStatsProcessor.h"
+#include "naucrates/statistics/CStatistics.h"
 #include "naucrates/statistics/CStatisticsUtils.h"
 using namespace gpopt;
 
@@ -176,12 +184,185 @@ CLogicalSelect::PstatsDerive(CMemoryPool *mp, CExpressionHandle &exprhdl,
 
 	IStatistics *stats = CFilterStatsProcessor::MakeStatsFilterForScalarExpr(
 		mp, exprhdl, child_stats, local_expr, expr_with_outer_refs, stats_ctxt);
+
+	if (CUtils::FScalarConstTrue(expr_with_outer_refs))
+	{
+		stats = PstatsApplyCardinalityFeedback(mp, exprhdl, pexprScalar,
+											   child_stats, stats);
+	}
 	local_expr->Release();
 	expr_with_outer_refs->Release();
 
 	return stats;
 }
 
+//---------------------------------------------------------------------------
+//	@function:
+//		CLogicalSelect::FCollectFeedbackOperators
+//
+//	@doc:
+//		Add the operators of a filter to the given array, in ascending order
+//		of oid and without duplicates. These are the operators that the host
+//		finds in the quals of the scan; return false if there are more than
+//		GPOPT_CARD_FEEDBACK_MAX_OPS
+//
+//---------------------------------------------------------------------------
+BOOL
+CLogicalSelect::FCollectFeedbackOperators(CExpression *pexprScalar,
+										  OID *opnos, ULONG *num_opnos)
+{
+	GPOS_CHECK_STACK_SIZE;
+
+	COperator *pop = pexprScalar->Pop();
+	IMDId *mdid_op = nullptr;
+	switch (pop->Eopid())
+	{
+		case COperator::EopScalarCmp:
+			mdid_op = CScalarCmp::PopConvert(pop)->MdIdOp();
+			break;
+		case COperator::EopScalarIsDistinctFrom:
+			mdid_op = CScalarIsDistinctFrom::PopConvert(pop)->MdIdOp();
+			break;
+		case COperator::EopScalarArrayCmp:
+			mdid_op = CScalarArrayCmp::PopConvert(pop)->MdIdOp();
+			break;
+		case COperator::EopScalarOp:
+			mdid_op = CScalarOp::PopConvert(pop)->MdIdOp();
+			break;
+		case COperator::EopScalarNullIf:
+			mdid_op = CScalarNullIf::PopConvert(pop)->MdIdOp();
+			break;
+		default:
+			break;
+	}
+
+	if (nullptr != mdid_op && mdid_op->IsValid())
+	{
+		OID opno = CMDIdGPDB::CastMdid(mdid_op)->Oid();
+		ULONG pos = 0;
+		while (pos < *num_opnos && opnos[pos] < opno)
+		{
+			pos++;
+		}
+		if (pos == *num_opnos || opnos[pos] != opno)
+		{
+			if (GPOPT_CARD_FEEDBACK_MAX_OPS == *num_opnos)
+			{
+				return false;
+			}
+			for (ULONG ul = *num_opnos; ul > pos; ul--)
+			{
+				opnos[ul] = opnos[ul - 1];
+			}
+			opnos[pos] = opno;
+			(*num_opnos)++;
+		}
+	}
+
+	const ULONG arity = pexprScalar->Arity();
+	for (ULONG ul = 0; ul < arity; ul++)
+	{
+		if (!FCollectFeedbackOperators((*pexprScalar)[ul], opnos, num_opnos))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+//	@function:
+//		CLogicalSelect::PstatsApplyCardinalityFeedback
+//
+//	@doc:
+//		Scale the stats of a filter directly on a table by the correction
+//		the host learned from earlier executions of a filter with the same
+//		operators on the same columns of that table, if any. The corrected
+//		row count stays between one row and the rows of the table
+//
+//---------------------------------------------------------------------------
+IStatistics *
+CLogicalSelect::PstatsApplyCardinalityFeedback(CMemoryPool *mp,
+											   CExpressionHandle &exprhdl,
+											   CExpression *pexprScalar,
+											   IStatistics *child_stats,
+											   IStatistics *stats)
+{
+	CTableDescriptor *ptabdesc = exprhdl.DeriveTableDescriptor(0);
+	if (nullptr == ptabdesc)
+	{
+		return stats;
+	}
+
+	// the filter is identified by the sorted attnos of its columns
+	CColRefSet *pcrsUsed = exprhdl.DeriveUsedColumns(1);
+	INT attnos[GPOPT_CARD_FEEDBACK_MAX_COLS];
+	ULONG num_attnos = 0;
+	CColRefSetIter crsi(*pcrsUsed);
+	while (crsi.Advance())
+	{
+		CColRef *colref = crsi.Pcr();
+		if (CColRef::EcrtTable != colref->Ecrt() ||
+			GPOPT_CARD_FEEDBACK_MAX_COLS == num_attnos)
+		{
+			return stats;
+		}
+
+		INT attno = CColRefTable::PcrConvert(colref)->AttrNum();
+		if (0 >= attno)
+		{
+			return stats;
+		}
+
+		ULONG pos = num_attnos++;
+		while (0 < pos && attnos[pos - 1] > attno)
+		{
+			attnos[pos] = attnos[pos - 1];
+			pos--;
+		}
+		attnos[pos] = attno;
+	}
+
+	if (0 == num_attnos)
+	{
+		return stats;
+	}
+
+	// and by the sorted oids of its operators, as the host keys it
+	OID opnos[GPOPT_CARD_FEEDBACK_MAX_OPS];
+	ULONG num_opnos = 0;
+	if (!FCollectFeedbackOperators(pexprScalar, opnos, &num_opnos))
+	{
+		return stats;
+	}
+
+	CStatisticsConfig *stats_config =
+		COptCtxt::PoctxtFromTLS()->GetOptimizerConfig()->GetStatsConf();
+	CDouble factor = stats_config->DCardinalityFeedback(
+		CMDIdGPDB::CastMdid(ptabdesc->MDId())->Oid(), attnos, num_attnos,
+		opnos, num_opnos);
+	if (CDouble(1.0) == factor)
+	{
+		return stats;
+	}
+
+	CDouble rows = stats->Rows();
+	CDouble corrected_rows =
+		std::max(CStatistics::MinRows,
+				 std::min(rows * factor, child_stats->Rows()));
+	if (rows <= CDouble(0.0) || corrected_rows == rows)
+	{
+		return stats;
+	}
+
+	IStatistics *corrected_stats =
+		stats->ScaleStats(mp, corrected_rows / rows);
+	stats->Release();
+
+	return corrected_stats;
+}
+
 // compute partition predicate to pass down to n-th child.
 // given an input scalar expression, find out the predicate
 // in the scalar expression which is used for partitioning
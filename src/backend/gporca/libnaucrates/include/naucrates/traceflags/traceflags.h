@@ -215,6 +215,9 @@ enum EOptTraceFlag
 
 	EopttraceForceComprehensiveJoinImplementation = 103041,
 
+	// cost scans of column-oriented tables by the width of the projected columns
+	EopttraceColumnProjectionCost = 103042,
+
 	///////////////////////////////////////////////////////
 	///////////////////// statistics flags ////////////////
 	//////////////////////////////////////////////////////
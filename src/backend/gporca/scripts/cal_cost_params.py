@@ -0,0 +1,357 @@
+#!/usr/bin/env python3
+
+# Optimizer cost model calibration
+#
+# The unit costs of the GPDB cost model (CCostModelParamsGPDB.cpp) were
+# tuned for the hardware of their time. On a cluster with fast storage and
+# a fast network, their ratios no longer match and the optimizer picks, for
+# example, a broadcast where a redistribute is cheaper.
+#
+# This program runs a few microbenchmarks on the cluster, one per family of
+# cost parameters (table scan, gather/redistribute/broadcast motions, hash
+# join, hash aggregate, sort). For every benchmark it runs EXPLAIN ANALYZE
+# and compares, node by node, the actual time with the cost the optimizer
+# estimated for it:
+#
+#     k = actual time of the node / estimated cost of the node
+#
+# (both excluding the node's children). The table scan is the reference: a
+# family whose k is twice the k of the scan is twice as expensive, relative
+# to a scan, as the default parameters assume, so its parameters get a
+# factor of 2.
+#
+# The result is a setting for optimizer_cost_param_factors, which scales the
+# listed parameters when the optimizer sets up its cost model. With --apply
+# it is written to the configuration of all segments with gpconfig.
+#
+# Run this program with the -h or --help option to see argument syntax
+
+import argparse
+import json
+import subprocess
+import sys
+
+try:
+    from gppylib.db import dbconn
+except ImportError as e:
+    sys.exit('ERROR: Cannot import modules.  Please check that you have sourced greenplum_path.sh.  Detail: ' + str(e))
+
+# constants
+# -----------------------------------------------------------------------------
+
+_help = """
+Calibrate the cost model of the optimizer on this cluster. Runs scan, motion,
+hash join, hash aggregate and sort microbenchmarks and prints a value for
+optimizer_cost_param_factors.
+"""
+
+# the reference family, its factor is always 1
+REFERENCE = "scan"
+
+# factors are kept within these bounds, beyond them the measurement is
+# more likely to be wrong than the defaults
+MIN_FACTOR = 0.01
+MAX_FACTOR = 100.0
+
+# global variables
+# -----------------------------------------------------------------------------
+
+glob_verbose = False
+glob_log_file = None
+
+# SQL statements, DDL and DML
+# -----------------------------------------------------------------------------
+
+_drop_tables = """
+DROP TABLE IF EXISTS cal_cp_fact, cal_cp_dim;
+"""
+
+# fact table: k is spread evenly, so joining on it redistributes the whole
+# table; grp has one value per 10 rows for the hash aggregate
+_create_tables = [
+    """
+CREATE TABLE cal_cp_fact(id int, k int, grp int, pad text)
+DISTRIBUTED BY (id);
+""",
+    """
+INSERT INTO cal_cp_fact
+SELECT i, (i * 7919) %% %(dimrows)d, i / 10, repeat('x', 100)
+FROM generate_series(1, %(numrows)d) i;
+""",
+    """
+CREATE TABLE cal_cp_dim(id int, pad text)
+DISTRIBUTED BY (id);
+""",
+    """
+INSERT INTO cal_cp_dim
+SELECT i, repeat('y', 50)
+FROM generate_series(0, %(dimrows)d - 1) i;
+""",
+    "ANALYZE cal_cp_fact;",
+    "ANALYZE cal_cp_dim;",
+]
+
+# Benchmarks. For each family:
+# - settings that force the plan shape to measure
+# - the query
+# - the node types whose time and cost are compared
+# - the cost parameters scaled by the resulting factor
+_benchmarks = [
+    {
+        "family": "scan",
+        "settings": [],
+        "query": "SELECT count(pad) FROM cal_cp_fact",
+        "nodes": ["Seq Scan"],
+        "params": ["TableScanCostUnit"],
+    },
+    {
+        "family": "gather",
+        "settings": [],
+        "query": "SELECT id, pad FROM cal_cp_fact",
+        "nodes": ["Gather Motion"],
+        "params": ["GatherSendCostUnit", "GatherRecvCostUnit"],
+    },
+    {
+        "family": "redistribute",
+        "settings": ["SET optimizer_enable_motion_broadcast = off"],
+        "query": "SELECT count(*) FROM cal_cp_fact f JOIN cal_cp_dim d ON f.k = d.id",
+        "nodes": ["Redistribute Motion"],
+        "params": ["RedistributeSendCostUnit", "RedistributeRecvCostUnit"],
+    },
+    {
+        "family": "broadcast",
+        "settings": ["SET optimizer_enable_motion_redistribute = off"],
+        "query": "SELECT count(*) FROM cal_cp_fact f JOIN cal_cp_dim d ON f.k = d.id",
+        "nodes": ["Broadcast Motion"],
+        "params": ["BroadcastSendCostUnit", "BroadcastRecvCostUnit"],
+    },
+    {
+        "family": "hashjoin",
+        "settings": ["SET optimizer_enable_motion_broadcast = off"],
+        "query": "SELECT count(*) FROM cal_cp_fact f JOIN cal_cp_dim d ON f.k = d.id",
+        "nodes": ["Hash Join", "Hash"],
+        "params": ["HJHashTableInitCostFactor", "HJHashTableColumnCostUnit",
+                   "HJHashTableWidthCostUnit", "HJHashingTupWidthCostUnit",
+                   "HJFeedingTupColumnSpillingCostUnit", "HJFeedingTupWidthSpillingCostUnit",
+                   "HJHashingTupWidthSpillingCostUnit"],
+    },
+    {
+        "family": "hashagg",
+        "settings": ["SET optimizer_enable_groupagg = off"],
+        "query": "SELECT count(*) FROM (SELECT grp, count(*) FROM cal_cp_fact GROUP BY grp) s",
+        "nodes": ["HashAggregate"],
+        "params": ["HashAggInputTupColumnCostUnit", "HashAggInputTupWidthCostUnit",
+                   "HashAggOutputTupWidthCostUnit"],
+    },
+    {
+        "family": "sort",
+        "settings": [],
+        "query": "SELECT id, pad FROM cal_cp_fact ORDER BY k",
+        "nodes": ["Sort"],
+        "params": ["SortTupWidthCostUnit"],
+    },
+]
+
+
+def parseargs():
+    parser = argparse.ArgumentParser(description=_help)
+
+    parser.add_argument("--create", action="store_true",
+                        help="Create the tables to use in the benchmarks")
+    parser.add_argument("--drop", action="store_true",
+                        help="Drop the tables used in the benchmarks when finished")
+    parser.add_argument("--execute", type=int, default="3",
+                        help="Number of times to run each benchmark, the median is used (default is 3)")
+    parser.add_argument("--apply", action="store_true",
+                        help="Set optimizer_cost_param_factors with gpconfig and reload the configuration")
+    parser.add_argument("--verbose", action="store_true",
+                        help="Print more verbose output")
+    parser.add_argument("--logFile", default="",
+                        help="Log diagnostic output to a file")
+    parser.add_argument("--host", default="",
+                        help="Host to connect to (default is localhost or $PGHOST, if set).")
+    parser.add_argument("--port", type=int, default="0",
+                        help="Port on the host to connect to (default is 0 or $PGPORT, if set)")
+    parser.add_argument("--dbName", default="",
+                        help="Database name to connect to")
+    parser.add_argument("--numRows", type=int, default="10000000",
+                        help="Number of rows to INSERT INTO the fact table (default is 10 million)")
+
+    args = parser.parse_args()
+    return args, parser
+
+
+def log_output(str):
+    if glob_verbose:
+        print(str)
+    if glob_log_file != None:
+        glob_log_file.write(str + "\n")
+
+
+# SQL related methods
+# -----------------------------------------------------------------------------
+
+def connect(host, port_num, db_name):
+    try:
+        dburl = dbconn.DbURL(hostname=host, port=port_num, dbname=db_name)
+        conn = dbconn.connect(dburl, encoding="UTF8", unsetSearchPath=False)
+
+    except Exception as e:
+        print(("Exception during connect: %s" % e))
+        quit()
+
+    return conn
+
+
+def execute_sql(conn, sqlStr):
+    log_output("")
+    log_output("Executing query: %s" % sqlStr)
+    dbconn.execSQL(conn, sqlStr)
+
+
+def commit_db(conn):
+    execute_sql(conn, "commit")
+
+
+def createDB(conn, numRows):
+    params = {"numrows": numRows, "dimrows": max(numRows // 10, 1)}
+    execute_sql(conn, _drop_tables)
+    for sqlStr in _create_tables:
+        execute_sql(conn, sqlStr % params)
+    commit_db(conn)
+
+
+def dropDB(conn):
+    execute_sql(conn, _drop_tables)
+    commit_db(conn)
+
+
+# plan analysis
+# -----------------------------------------------------------------------------
+
+def node_name(node):
+    # the JSON format reports hash aggregates as "Aggregate" with a
+    # "Strategy" of "Hashed"
+    if node.get("Node Type") == "Aggregate" and node.get("Strategy") == "Hashed":
+        return "HashAggregate"
+    return node.get("Node Type")
+
+
+# Walk the plan and add up, for the nodes of the given types, the actual
+# time and the estimated cost spent in the node itself, not in its children.
+def self_time_and_cost(node, node_types):
+    children = node.get("Plans", [])
+    time = 0.0
+    cost = 0.0
+    if node_name(node) in node_types:
+        time = node.get("Actual Total Time", 0.0) * node.get("Actual Loops", 1)
+        cost = node.get("Total Cost", 0.0)
+        for child in children:
+            time -= child.get("Actual Total Time", 0.0) * child.get("Actual Loops", 1)
+            cost -= child.get("Total Cost", 0.0)
+    for child in children:
+        child_time, child_cost = self_time_and_cost(child, node_types)
+        time += child_time
+        cost += child_cost
+    return time, cost
+
+
+# Run a benchmark and return the ratio of actual time to estimated cost of
+# its nodes, the median over several executions.
+def run_benchmark(conn, benchmark, execute_n_times):
+    execute_sql(conn, "RESET ALL")
+    execute_sql(conn, "SET optimizer = on")
+    execute_sql(conn, "SET optimizer_cost_param_factors = ''")
+    execute_sql(conn, "SET optimizer_sort_factor = 1.0")
+    for setting in benchmark["settings"]:
+        execute_sql(conn, setting)
+
+    ratios = []
+    for e in range(execute_n_times):
+        log_output("Executing query: %s" % benchmark["query"])
+        curs = dbconn.query(conn, "EXPLAIN (ANALYZE, FORMAT JSON) " + benchmark["query"])
+        result = curs.fetchall()[0][0]
+        if isinstance(result, str):
+            result = json.loads(result)
+        plan = result[0]["Plan"]
+
+        time, cost = self_time_and_cost(plan, benchmark["nodes"])
+        log_output("%s: %.3f ms for a cost of %.3f" % (benchmark["family"], time, cost))
+        if cost <= 0 or time <= 0:
+            print("Benchmark %s: no %s node in the plan, or no time spent in it; skipped" %
+                  (benchmark["family"], " or ".join(benchmark["nodes"])))
+            return None
+        ratios.append(time / cost)
+
+    ratios.sort()
+    return ratios[len(ratios) // 2]
+
+
+def calibrate(conn, execute_n_times):
+    ratios = {}
+    for benchmark in _benchmarks:
+        ratio = run_benchmark(conn, benchmark, execute_n_times)
+        if ratio is not None:
+            ratios[benchmark["family"]] = ratio
+    execute_sql(conn, "RESET ALL")
+
+    if REFERENCE not in ratios:
+        sys.exit("ERROR: the table scan benchmark failed, cannot calibrate")
+
+    print("")
+    print("%-14s %14s %10s" % ("family", "ms per cost", "factor"))
+    factors = []
+    for benchmark in _benchmarks:
+        family = benchmark["family"]
+        if family not in ratios:
+            continue
+        factor = ratios[family] / ratios[REFERENCE]
+        factor = min(max(factor, MIN_FACTOR), MAX_FACTOR)
+        # three significant digits are plenty
+        factor = float("%.3g" % factor)
+        print("%-14s %14.6g %10.3g" % (family, ratios[family], factor))
+        if family == REFERENCE:
+            continue
+        for param in benchmark["params"]:
+            factors.append("%s=%s" % (param, factor))
+
+    return ", ".join(factors)
+
+
+def apply_setting(value):
+    subprocess.check_call(["gpconfig", "-c", "optimizer_cost_param_factors", "-v", "'%s'" % value])
+    subprocess.check_call(["gpstop", "-u"])
+
+
+def main():
+    global glob_verbose
+    global glob_log_file
+
+    args, parser = parseargs()
+    if args.logFile != "":
+        glob_log_file = open(args.logFile, "wt", 1)
+    if args.verbose:
+        glob_verbose = True
+    log_output("Connecting to host %s on port %d, database %s" % (args.host, args.port, args.dbName))
+    conn = connect(args.host, args.port, args.dbName)
+    if args.create:
+        createDB(conn, args.numRows)
+
+    value = calibrate(conn, max(args.execute, 1))
+    print("")
+    print("optimizer_cost_param_factors = '%s'" % value)
+
+    if args.drop:
+        dropDB(conn)
+
+    conn.close()
+
+    if args.apply:
+        apply_setting(value)
+
+    if glob_log_file != None:
+        glob_log_file.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -282,6 +282,13 @@ optimize_query(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	result->oneoffPlan = glob->oneoffPlan;
 	result->transientPlan = glob->transientPlan;
 
+	/*
+	 * Carry the query identifier over, like standard_planner() does. It is
+	 * dispatched to the QEs along with the plan, so that extensions such as
+	 * pg_stat_statements can attribute segment-side work to the statement.
+	 */
+	result->queryId = parse->queryId;
+
 	return result;
 }
 
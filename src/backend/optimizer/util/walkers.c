@@ -10,11 +10,21 @@
 
 #include "postgres.h"
 
+#include "access/stratnum.h"
+#include "access/table.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
 #include "optimizer/walkers.h"
+#include "parser/parsetree.h"
+#include "partitioning/partbounds.h"
+#include "partitioning/partdesc.h"
+#include "utils/lsyscache.h"
+#include "utils/partcache.h"
+#include "utils/rel.h"
 
 /**
  * Plan node walker related methods.
@@ -1002,3 +1012,169 @@ check_collation_walker(Node *node, check_collation_context *context)
 	}
 }
 
+
+/*
+ * ORCA has no partition-wise join or aggregate.  When they are enabled, the
+ * functions below tell whether the Postgres planner would likely use one
+ * for a query level, so that ORCA can leave the query to it.  They are
+ * conservative approximations of the planner's own tests (see
+ * have_partkey_equi_join() and group_by_has_partkey()), limited to tables
+ * with a single-column partition key.
+ */
+
+/*
+ * If 'node' is a Var of this query level referencing the partition key of a
+ * partitioned table, return true and the table's range table index.
+ */
+static bool
+is_partition_key_var(Query *query, Node *node, Index *varno)
+{
+	Var		   *var;
+	RangeTblEntry *rte;
+	Relation	rel;
+	PartitionKey key;
+	bool		result;
+
+	while (node && IsA(node, RelabelType))
+		node = (Node *) ((RelabelType *) node)->arg;
+
+	if (node == NULL || !IsA(node, Var))
+		return false;
+
+	var = (Var *) node;
+	if (var->varlevelsup != 0 || var->varno < 1 ||
+		var->varno > list_length(query->rtable))
+		return false;
+
+	rte = rt_fetch(var->varno, query->rtable);
+	if (rte->rtekind != RTE_RELATION ||
+		rte->relkind != RELKIND_PARTITIONED_TABLE)
+		return false;
+
+	/* the parser has locked the table already */
+	rel = table_open(rte->relid, NoLock);
+	key = RelationGetPartitionKey(rel);
+	result = (key->partnatts == 1 && key->partattrs[0] == var->varattno);
+	table_close(rel, NoLock);
+
+	*varno = var->varno;
+	return result;
+}
+
+/*
+ * Are the two partitioned tables partitioned the same way, with the same
+ * bounds?  If 'opno' is valid, it must also be the equality operator of
+ * their partition key.
+ */
+static bool
+partition_schemes_match(Oid relid1, Oid relid2, Oid opno)
+{
+	Relation	rel1;
+	Relation	rel2;
+	PartitionKey key1;
+	PartitionKey key2;
+	PartitionDesc pd1;
+	PartitionDesc pd2;
+	bool		result;
+
+	rel1 = table_open(relid1, NoLock);
+	rel2 = table_open(relid2, NoLock);
+	key1 = RelationGetPartitionKey(rel1);
+	key2 = RelationGetPartitionKey(rel2);
+	pd1 = RelationGetPartitionDesc(rel1, true);
+	pd2 = RelationGetPartitionDesc(rel2, true);
+
+	result = (key1->strategy == key2->strategy &&
+			  key1->partnatts == 1 && key2->partnatts == 1 &&
+			  key1->parttypid[0] == key2->parttypid[0] &&
+			  key1->partopfamily[0] == key2->partopfamily[0] &&
+			  key1->partcollation[0] == key2->partcollation[0] &&
+			  pd1->nparts > 1 && pd1->nparts == pd2->nparts &&
+			  partition_bounds_equal(key1->partnatts, key1->parttyplen,
+									 key1->parttypbyval,
+									 pd1->boundinfo, pd2->boundinfo));
+
+	if (result && OidIsValid(opno))
+	{
+		int			strategy = get_op_opfamily_strategy(opno, key1->partopfamily[0]);
+
+		if (key1->strategy == PARTITION_STRATEGY_HASH)
+			result = (strategy == HTEqualStrategyNumber);
+		else
+			result = (strategy == BTEqualStrategyNumber);
+	}
+
+	table_close(rel2, NoLock);
+	table_close(rel1, NoLock);
+
+	return result;
+}
+
+static bool
+partitionwise_join_walker(Node *node, Query *query)
+{
+	if (node == NULL)
+		return false;
+
+	/* only look at this query level */
+	if (IsA(node, SubLink) || IsA(node, Query))
+		return false;
+
+	if (IsA(node, OpExpr) && list_length(((OpExpr *) node)->args) == 2)
+	{
+		OpExpr	   *op = (OpExpr *) node;
+		Index		varno1;
+		Index		varno2;
+
+		if (is_partition_key_var(query, linitial(op->args), &varno1) &&
+			is_partition_key_var(query, lsecond(op->args), &varno2) &&
+			varno1 != varno2 &&
+			partition_schemes_match(rt_fetch(varno1, query->rtable)->relid,
+									rt_fetch(varno2, query->rtable)->relid,
+									op->opno))
+			return true;
+	}
+
+	return expression_tree_walker(node, partitionwise_join_walker, (void *) query);
+}
+
+/*
+ * Does this query level join two identically partitioned tables on their
+ * partition keys, with enable_partitionwise_join on?
+ */
+bool
+has_partitionwise_join_candidate(Query *query)
+{
+	if (!enable_partitionwise_join || query->jointree == NULL)
+		return false;
+
+	return partitionwise_join_walker((Node *) query->jointree, query);
+}
+
+/*
+ * Does this query level group the rows of a single partitioned table by its
+ * partition key, with enable_partitionwise_aggregate on?
+ */
+bool
+has_partitionwise_agg_candidate(Query *query)
+{
+	ListCell   *lc;
+
+	if (!enable_partitionwise_aggregate || query->groupClause == NIL ||
+		query->groupingSets != NIL || query->jointree == NULL ||
+		list_length(query->jointree->fromlist) != 1 ||
+		!IsA(linitial(query->jointree->fromlist), RangeTblRef))
+		return false;
+
+	foreach(lc, query->groupClause)
+	{
+		SortGroupClause *sgc = (SortGroupClause *) lfirst(lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+		Index		varno;
+
+		if (is_partition_key_var(query, (Node *) tle->expr, &varno))
+			return true;
+	}
+
+	return false;
+}
@@ -27,6 +27,7 @@
 #include "access/syncscan.h"
 #include "access/twophase.h"
 #include "access/distributedlog.h"
+#include "cdb/cdbcardfeedback.h"
 #include "cdb/cdblocaldistribxact.h"
 #include "cdb/cdbvars.h"
 #include "commands/async.h"
@@ -210,6 +211,7 @@ CreateSharedMemoryAndSemaphores(void)
 		size = add_size(size, CancelBackendMsgShmemSize());
 		size = add_size(size, WorkFileShmemSize());
 		size = add_size(size, ShareInputShmemSize());
+		size = add_size(size, CardFeedbackShmemSize());
 
 #ifdef FAULT_INJECTOR
 		size = add_size(size, FaultInjector_ShmemSize());
@@ -393,6 +395,7 @@ CreateSharedMemoryAndSemaphores(void)
 	BackendCancelShmemInit();
 	WorkFileShmemInit();
 	ShareInputShmemInit();
+	CardFeedbackShmemInit();
 
 	/*
 	 * Set up Instrumentation free list
@@ -31,6 +31,7 @@
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
 
+#include "cdb/cdbtm.h"
 #include "cdb/ml_ipc.h"
 #include "commands/createas.h"
 #include "commands/queue.h"
@@ -596,6 +597,8 @@ PortalStart(Portal portal, ParamListInfo params,
 				/* Must set snapshot before starting executor. */
 				if (snapshot)
 					PushActiveSnapshot(snapshot);
+				else if (canUseLocalSnapshot(linitial_node(PlannedStmt, portal->stmts)))
+					PushActiveSnapshot(GetLocalTransactionSnapshot());
 				else
 					PushActiveSnapshot(GetTransactionSnapshot());
 
@@ -494,6 +494,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_LOGINMONITOR_FINISH:
 			event_name = "LoginMonitorFinish";
 			break;
+		case WAIT_EVENT_DISPATCH_RESULT:
+			event_name = "DispatchResult";
+			break;
 		case WAIT_EVENT_DTX_RECOVERY:
 			event_name = "DtxRecovery";
 			/* no default case, so that compiler will warn */
@@ -1096,6 +1096,12 @@ PG_FUNCTION_INFO_V1(gp_hyperloglog_out);
 
 PG_FUNCTION_INFO_V1(gp_hyperloglog_comp);
 
+PG_FUNCTION_INFO_V1(approx_count_distinct_transfn);
+PG_FUNCTION_INFO_V1(approx_count_distinct_combine);
+PG_FUNCTION_INFO_V1(approx_count_distinct_serialize);
+PG_FUNCTION_INFO_V1(approx_count_distinct_deserialize);
+PG_FUNCTION_INFO_V1(approx_count_distinct_finalfn);
+
 /* ------------- function declarations for local functions --------------- */
 extern Datum gp_hyperloglog_add_item_agg_default(PG_FUNCTION_ARGS);
 
@@ -1107,6 +1113,12 @@ extern Datum gp_hyperloglog_out(PG_FUNCTION_ARGS);
 
 extern Datum gp_hyperloglog_comp(PG_FUNCTION_ARGS);
 
+extern Datum approx_count_distinct_transfn(PG_FUNCTION_ARGS);
+extern Datum approx_count_distinct_combine(PG_FUNCTION_ARGS);
+extern Datum approx_count_distinct_serialize(PG_FUNCTION_ARGS);
+extern Datum approx_count_distinct_deserialize(PG_FUNCTION_ARGS);
+extern Datum approx_count_distinct_finalfn(PG_FUNCTION_ARGS);
+
 static GpHLLCounter pg_check_hll_version(GpHLLCounter hloglog);
 
 /* ---------------------- function definitions --------------------------- */
@@ -1271,3 +1283,197 @@ gp_hyperloglog_comp(PG_FUNCTION_ARGS)
 	PG_RETURN_BYTEA_P(hyperloglog);
 }
 
+/*
+ * approx_count_distinct(anyelement) support.
+ *
+ * The transition state is a dense, bit-packed counter kept in the aggregate
+ * memory context and updated in place, so that adding a value doesn't copy
+ * the whole counter like gp_hyperloglog_accum() does.  The counter is
+ * compressed when it is serialized, so the partial aggregates sent from the
+ * segments to the coordinator are small.
+ */
+typedef struct ApproxCountDistinctState
+{
+	GpHLLCounter counter;
+
+	/* type info of the aggregated values, filled in by the transfn */
+	int16		typlen;
+	bool		typbyval;
+} ApproxCountDistinctState;
+
+static ApproxCountDistinctState *
+approx_count_distinct_new_state(MemoryContext aggcontext, GpHLLCounter counter)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(aggcontext);
+	ApproxCountDistinctState *state;
+
+	state = palloc0(sizeof(ApproxCountDistinctState));
+	if (counter != NULL)
+		state->counter = gp_hll_copy(counter);
+	else
+		state->counter = gp_hll_create(DEFAULT_NDISTINCT, DEFAULT_ERROR, PACKED);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
+Datum
+approx_count_distinct_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	ApproxCountDistinctState *state;
+	Datum		element;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "approx_count_distinct_transfn called in non-aggregate context");
+
+	if (PG_ARGISNULL(0))
+	{
+		char		typalign;
+
+		state = approx_count_distinct_new_state(aggcontext, NULL);
+		get_typlenbyvalalign(get_fn_expr_argtype(fcinfo->flinfo, 1),
+							 &state->typlen, &state->typbyval, &typalign);
+	}
+	else
+		state = (ApproxCountDistinctState *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(state);
+
+	element = PG_GETARG_DATUM(1);
+
+	if (state->typlen == -1)
+	{
+		/* hash the detoasted value, so that equal values hash alike */
+		struct varlena *value = PG_DETOAST_DATUM_PACKED(element);
+
+		gp_hll_add_element(state->counter, VARDATA_ANY(value),
+						   VARSIZE_ANY_EXHDR(value));
+		if ((Pointer) value != DatumGetPointer(element))
+			pfree(value);
+	}
+	else if (state->typlen == -2)
+	{
+		char	   *value = DatumGetCString(element);
+
+		gp_hll_add_element(state->counter, value, strlen(value));
+	}
+	else
+		gp_hyperloglog_add_item(state->counter, element, state->typlen,
+								state->typbyval, 0);
+
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+approx_count_distinct_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	ApproxCountDistinctState *state1;
+	ApproxCountDistinctState *state2;
+	GpHLLCounter counter1;
+	GpHLLCounter counter2;
+	int			nregisters;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "approx_count_distinct_combine called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (ApproxCountDistinctState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (ApproxCountDistinctState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+		PG_RETURN_POINTER(state1);
+
+	if (state1 == NULL)
+	{
+		/* state2 may live in a short-lived context, so copy it */
+		state1 = approx_count_distinct_new_state(aggcontext, state2->counter);
+		state1->typlen = state2->typlen;
+		state1->typbyval = state2->typbyval;
+		PG_RETURN_POINTER(state1);
+	}
+
+	counter1 = state1->counter;
+	counter2 = state2->counter;
+	if (counter1->b != counter2->b || counter1->binbits != counter2->binbits)
+		elog(ERROR, "cannot merge hyperloglog counters with different parameters");
+
+	/*
+	 * Both counters are packed, so merge them register by register rather
+	 * than with gp_hll_merge(), which works on unpacked counters.
+	 */
+	nregisters = POW2(counter1->b);
+	for (int i = 0; i < nregisters; i++)
+	{
+		uint8_t		entry1;
+		uint8_t		entry2;
+
+		GP_HLL_DENSE_GET_REGISTER(entry1, counter1->data, i, counter1->binbits);
+		GP_HLL_DENSE_GET_REGISTER(entry2, counter2->data, i, counter2->binbits);
+		if (entry2 > entry1)
+			GP_HLL_DENSE_SET_REGISTER(counter1->data, i, entry2, counter1->binbits);
+	}
+
+	PG_RETURN_POINTER(state1);
+}
+
+Datum
+approx_count_distinct_serialize(PG_FUNCTION_ARGS)
+{
+	ApproxCountDistinctState *state;
+	GpHLLCounter counter;
+
+	/* Ensure we disallow calling when not in aggregate context */
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (ApproxCountDistinctState *) PG_GETARG_POINTER(0);
+
+	counter = gp_hll_compress(gp_hll_copy(state->counter));
+
+	PG_RETURN_BYTEA_P(counter);
+}
+
+Datum
+approx_count_distinct_deserialize(PG_FUNCTION_ARGS)
+{
+	ApproxCountDistinctState *state;
+	GpHLLCounter counter;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	counter = PG_GETARG_HLL_P_COPY(0);
+	counter = gp_hll_decompress(counter);
+
+	state = palloc0(sizeof(ApproxCountDistinctState));
+	state->counter = counter;
+
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+approx_count_distinct_finalfn(PG_FUNCTION_ARGS)
+{
+	ApproxCountDistinctState *state;
+	GpHLLCounter counter;
+	double		estimate;
+
+	/* like count(DISTINCT), an empty input counts as zero */
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT64(0);
+
+	state = (ApproxCountDistinctState *) PG_GETARG_POINTER(0);
+
+	/*
+	 * gp_hyperloglog_estimate() scribbles on the format of the counter it is
+	 * given, and the final function must leave the state intact.
+	 */
+	counter = gp_hll_copy(state->counter);
+	estimate = gp_hyperloglog_estimate(counter);
+	pfree(counter);
+
+	PG_RETURN_INT64((int64) rint(estimate));
+}
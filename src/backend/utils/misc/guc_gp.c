@@ -18,6 +18,7 @@
 #include "postgres.h"
 
 #include <float.h>
+#include <math.h>
 #include <sys/stat.h>
 #include <sys/unistd.h>
 
@@ -39,6 +40,7 @@
 #include "commands/variable.h"
 #include "miscadmin.h"
 #include "optimizer/cost.h"
+#include "optimizer/orca.h"
 #include "optimizer/planmain.h"
 #include "pgstat.h"
 #include "parser/scansup.h"
@@ -95,6 +97,8 @@ bool gpvars_check_gp_resqueue_priority_default_value(char **newval,
 
 static bool check_gp_default_storage_options(char **newval, void **extra, GucSource source);
 static void assign_gp_default_storage_options(const char *newval, void *extra);
+static bool check_optimizer_cost_param_factors(char **newval, void **extra, GucSource source);
+static void assign_optimizer_cost_param_factors(const char *newval, void *extra);
 
 
 static bool check_pljava_classpath_insecure(bool *newval, void **extra, GucSource source);
@@ -142,10 +146,12 @@ int			gp_max_local_distributed_cache = 1024;
 bool		gp_appendonly_verify_block_checksums = true;
 bool		gp_appendonly_verify_write_block = false;
 bool		gp_appendonly_compaction = true;
+bool		gp_appendonly_mmap_read = false;
 int			gp_appendonly_compaction_threshold = 0;
 bool		enable_parallel = false;
 int			gp_appendonly_insert_files = 0;
 int			gp_appendonly_insert_files_tuples_range = 0;
+int			gp_appendonly_insert_mem_limit = 0;
 bool		gp_heap_require_relhasoids_match = true;
 bool		gp_local_distributed_cache_stats = false;
 bool		debug_xlog_record_read = false;
@@ -160,6 +166,7 @@ bool		Debug_datumstream_write_use_small_initial_buffers = false;
 bool		gp_create_table_random_default_distribution = true;
 bool		gp_allow_non_uniform_partitioning_ddl = true;
 int			dtx_phase2_retry_second = 0;
+bool		gp_enable_direct_dispatch_local_snapshot = false;
 
 bool		log_dispatch_stats = false;
 
@@ -355,6 +362,9 @@ double		optimizer_damping_factor_join;
 double		optimizer_damping_factor_groupby;
 bool		optimizer_dpe_stats;
 bool		optimizer_enable_derive_stats_all_groups;
+bool		optimizer_cardinality_feedback;
+int			optimizer_cardinality_feedback_entries;
+int			optimizer_cardinality_feedback_half_life;
 
 /* Costing related GUCs used by the Optimizer */
 int			optimizer_segments;
@@ -362,6 +372,8 @@ int			optimizer_penalize_broadcast_threshold;
 double		optimizer_cost_threshold;
 double		optimizer_nestloop_factor;
 double		optimizer_sort_factor;
+char	   *optimizer_cost_param_factors_str = NULL;
+OptimizerCostParamFactors *optimizer_cost_param_factors = NULL;
 
 /* Optimizer hints */
 int			optimizer_join_arity_for_associativity_commutativity;
@@ -376,6 +388,7 @@ bool		optimizer_force_three_stage_scalar_dqa;
 bool		optimizer_force_expanded_distinct_aggs;
 bool		optimizer_force_agg_skew_avoidance;
 bool		optimizer_penalize_skew;
+bool		optimizer_enable_column_projection_cost;
 bool		optimizer_prune_computed_columns;
 bool		optimizer_push_requirements_from_consumer_to_producer;
 bool		optimizer_enforce_subplans;
@@ -429,6 +442,7 @@ bool		gp_enable_global_deadlock_detector = false;
 
 bool gp_enable_predicate_pushdown;
 int  gp_predicate_pushdown_sample_rows;
+bool gp_enable_ao_count_from_metadata = false;
 
 bool enable_answer_query_using_materialized_views = false;
 
@@ -516,6 +530,7 @@ static const struct config_enum_entry gp_interconnect_fc_methods[] = {
 static const struct config_enum_entry gp_interconnect_types[] = {
 	{"udpifc", INTERCONNECT_TYPE_UDPIFC},
 	{"tcp", INTERCONNECT_TYPE_TCP},
+	{"shm", INTERCONNECT_TYPE_SHM},
 #ifdef ENABLE_IC_PROXY
 	{"proxy", INTERCONNECT_TYPE_PROXY},
 #endif  /* ENABLE_IC_PROXY */
@@ -625,6 +640,18 @@ struct config_bool ConfigureNamesBool_gp[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"gp_enable_direct_dispatch_local_snapshot", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Run read-only statements dispatched to a single segment with a local snapshot."),
+			gettext_noop("Applies to autocommit READ COMMITTED statements that need no "
+						 "distributed transaction. The coordinator then takes no distributed "
+						 "snapshot for them. A distributed transaction that is committing "
+						 "can then be seen as committed on one segment before another.")
+		},
+		&gp_enable_direct_dispatch_local_snapshot,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"gp_enable_predicate_propagation", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("When two expressions are equivalent (such as with "
@@ -645,6 +672,17 @@ struct config_bool ConfigureNamesBool_gp[] =
 		&gp_enable_predicate_pushdown,
 		true, NULL, NULL
 	},
+	{
+		{"gp_enable_ao_count_from_metadata", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Count the rows of AO tables from segment file metadata when a scan needs no column."),
+			gettext_noop("A scan without quals that references no column, as for count(*), "
+						 "returns the number of visible rows recorded in the segment files "
+						 "and the visibility map instead of reading the data files."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_enable_ao_count_from_metadata,
+		false, NULL, NULL
+	},
 	{
 		{"debug_print_prelim_plan", PGC_USERSET, LOGGING_WHAT,
 			gettext_noop("Prints the preliminary execution plan to server log."),
@@ -917,6 +955,18 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_appendonly_mmap_read", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Read append-only segment files through a memory mapping instead of private buffers."),
+			gettext_noop("Scans of the same segment file then share the pages of the "
+						 "OS page cache, rather than each copying them into its own "
+						 "buffer. Only use it on local storage.")
+		},
+		&gp_appendonly_mmap_read,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_heap_require_relhasoids_match", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Issue an error on discovery of a mismatch between relhasoids and a tuple header."),
@@ -1046,6 +1096,18 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_interconnect_udp_segmentation_offload", PGC_BACKEND, GP_ARRAY_TUNING,
+			gettext_noop("Use UDP segmentation offload in the UDP interconnect."),
+			gettext_noop("Batches outgoing packets with UDP_SEGMENT and receives "
+						 "coalesced packets with UDP_GRO. Only available on Linux."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_interconnect_udp_segmentation_offload,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_interconnect_log_stats", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Emit statistics from the UDP-IC at the end of every statement."),
@@ -2302,6 +2364,30 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"optimizer_cardinality_feedback", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Correct the estimates of GPORCA with the rows actually produced by earlier queries."),
+			gettext_noop("Queries planned by GPORCA report the rows produced by their scans, and GPORCA "
+						 "scales its estimate of a later filter with the same operators on the same "
+						 "columns of the same table accordingly."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&optimizer_cardinality_feedback,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"optimizer_enable_column_projection_cost", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Cost scans of append-optimized, column-oriented tables by the width of the columns they read."),
+			NULL,
+			GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE
+		},
+		&optimizer_enable_column_projection_cost,
+		true,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"optimizer_multilevel_partitioning", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Enable optimization of queries on multilevel partitioned tables."),
@@ -3204,6 +3290,19 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_appendonly_insert_mem_limit", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Sets the memory limit for the insert descriptors of append-optimized, column-oriented tables within a statement."),
+			gettext_noop("When an insert touches many partitions and the limit is exceeded, the least "
+						 "recently used partitions have their buffers flushed and files closed until half "
+						 "of the limit is in use, and are resumed when needed again. Zero means no limit."),
+			GUC_UNIT_KB
+		},
+		&gp_appendonly_insert_mem_limit,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_workfile_max_entries", PGC_POSTMASTER, RESOURCES,
 			gettext_noop("Sets the maximum number of entries that can be stored in the workfile directory"),
@@ -3389,6 +3488,17 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_interconnect_shm_ring_size", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Sets the size of the shared memory ring of each same-host connection in the shm interconnect."),
+			NULL,
+			GUC_UNIT_KB
+		},
+		&gp_interconnect_shm_ring_size,
+		1024, 64, 1048576,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_interconnect_timer_period", PGC_USERSET, GP_ARRAY_TUNING,
 			gettext_noop("Sets the timer period (in ms) for UDP interconnect"),
@@ -3608,6 +3718,17 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_interconnect_tcp_keep_connections", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Sets the maximum number of idle TCP interconnect connections kept open by a backend for later statements."),
+			gettext_noop("Connections between the same two processes are reused by the next statement instead of being set up again. "
+						 "Zero closes every connection at the end of the statement.")
+		},
+		&gp_interconnect_tcp_keep_connections,
+		0, 0, 65535,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_interconnect_tcp_listener_backlog", PGC_USERSET, GP_ARRAY_TUNING,
 			gettext_noop("Size of the listening queue for each TCP interconnect socket"),
@@ -4080,6 +4201,28 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"optimizer_cardinality_feedback_entries", PGC_POSTMASTER, QUERY_TUNING_METHOD,
+			gettext_noop("Sets the maximum number of filters for which cardinality feedback is kept."),
+			NULL,
+			GUC_NOT_IN_SAMPLE
+		},
+		&optimizer_cardinality_feedback_entries,
+		1000, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"optimizer_cardinality_feedback_half_life", PGC_SUSET, QUERY_TUNING_METHOD,
+			gettext_noop("Sets the time after which a cardinality correction has lost half of its effect."),
+			gettext_noop("Zero means that corrections don't decay."),
+			GUC_UNIT_S | GUC_NOT_IN_SAMPLE
+		},
+		&optimizer_cardinality_feedback_half_life,
+		604800, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"optimizer_join_order_threshold", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Maximum number of join children to use dynamic programming based join ordering algorithm."),
@@ -4541,6 +4684,19 @@ struct config_string ConfigureNamesString_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"optimizer_cost_param_factors", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Scales cost model parameters of the optimizer by the given factors."),
+			gettext_noop("A comma-separated list of name=factor items, where name is a cost "
+						 "parameter such as RedistributeSendCostUnit. Such a list is produced "
+						 "by the cal_cost_params.py calibration script."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&optimizer_cost_param_factors_str,
+		"",
+		check_optimizer_cost_param_factors, assign_optimizer_cost_param_factors, NULL
+	},
+
 	{
 		{"gp_default_storage_options", PGC_USERSET, APPENDONLY_TABLES,
 			gettext_noop("default options for appendonly storage."),
@@ -4814,7 +4970,7 @@ struct config_enum ConfigureNamesEnum_gp[] =
 	{
 		{"gp_interconnect_type", PGC_BACKEND, GP_ARRAY_TUNING,
 			gettext_noop("Sets the protocol used for inter-node communication."),
-			gettext_noop("Valid values are \"tcp\", \"udpifc\""
+			gettext_noop("Valid values are \"tcp\", \"udpifc\", \"shm\""
 #ifdef ENABLE_IC_PROXY
 						 " and \"proxy\""
 #endif  /* ENABLE_IC_PROXY */
@@ -5194,6 +5350,104 @@ assign_gp_default_storage_options(const char *newval, void *extra)
 	setDefaultAOStorageOpts(newopts);
 }
 
+/*
+ * Parse optimizer_cost_param_factors, "Name=factor[, Name=factor ...]".
+ *
+ * The names are those of the cost model parameters in ORCA, see
+ * COptTasks::SetCostModelParams(). Without ORCA the setting has no effect,
+ * and only its syntax is checked.
+ */
+static bool
+check_optimizer_cost_param_factors(char **newval, void **extra, GucSource source)
+{
+	OptimizerCostParamFactors *factors;
+	const char *p = *newval;
+	int			maxitems = 1;
+
+	for (const char *c = p; *c; c++)
+		if (*c == ',')
+			maxitems++;
+
+	factors = malloc(offsetof(OptimizerCostParamFactors, items) +
+					 sizeof(OptimizerCostParamFactor) * maxitems);
+	if (!factors)
+		return false;
+	factors->nitems = 0;
+
+	while (*p)
+	{
+		OptimizerCostParamFactor *item = &factors->items[factors->nitems];
+		const char *name;
+		int			namelen;
+		char	   *end;
+
+		while (isspace((unsigned char) *p))
+			p++;
+		if (*p == '\0')
+			break;
+
+		name = p;
+		while (isalnum((unsigned char) *p) || *p == '_')
+			p++;
+		namelen = p - name;
+		while (isspace((unsigned char) *p))
+			p++;
+
+		if (namelen == 0 || namelen >= sizeof(item->name) || *p != '=')
+		{
+			GUC_check_errdetail("Expected a list of name=factor items.");
+			free(factors);
+			return false;
+		}
+		memcpy(item->name, name, namelen);
+		item->name[namelen] = '\0';
+
+#ifdef USE_ORCA
+		if (!IsValidOptimizerCostParam(item->name))
+		{
+			GUC_check_errdetail("Unrecognized cost parameter \"%s\".", item->name);
+			free(factors);
+			return false;
+		}
+#endif
+
+		/* strtod() accepts "inf" and "nan", and NaN fails the test below */
+		errno = 0;
+		item->factor = strtod(p + 1, &end);
+		if (end == p + 1 || errno != 0 || isinf(item->factor) ||
+			!(item->factor > 0))
+		{
+			GUC_check_errdetail("The factor of \"%s\" must be a positive, finite number.",
+								item->name);
+			free(factors);
+			return false;
+		}
+		factors->nitems++;
+
+		p = end;
+		while (isspace((unsigned char) *p))
+			p++;
+		if (*p == ',')
+			p++;
+		else if (*p != '\0')
+		{
+			GUC_check_errdetail("Expected a list of name=factor items.");
+			free(factors);
+			return false;
+		}
+	}
+
+	*extra = factors;
+
+	return true;
+}
+
+static void
+assign_optimizer_cost_param_factors(const char *newval, void *extra)
+{
+	optimizer_cost_param_factors = (OptimizerCostParamFactors *) extra;
+}
+
 /*
  * Set GUC value in GP_REPLICATION_CONFIG_FILENAME.
  *
@@ -354,6 +354,46 @@ GetTransactionSnapshot(void)
 	return CurrentSnapshot;
 }
 
+/*
+ * GetLocalTransactionSnapshot
+ *		Get the appropriate snapshot for a new query in a READ COMMITTED
+ *		transaction, like GetTransactionSnapshot(), but without a distributed
+ *		snapshot on the QD.
+ *
+ * Only for statements that canUseLocalSnapshot() accepts. Their QE then
+ * takes a local snapshot too, see setupQEDtxContext().
+ */
+Snapshot
+GetLocalTransactionSnapshot(void)
+{
+	Assert(!HistoricSnapshotActive());
+	Assert(!IsolationUsesXactSnapshot());
+
+	/* Don't allow catalog snapshot to be older than xact snapshot. */
+	InvalidateCatalogSnapshot();
+
+	if (!FirstSnapshotSet)
+	{
+		Assert(pairingheap_is_empty(&RegisteredSnapshots));
+		Assert(FirstXactSnapshot == NULL);
+
+		if (IsInParallelMode())
+			elog(ERROR,
+				 "cannot take query snapshot during a parallel operation");
+	}
+
+	CurrentSnapshot = GetSnapshotData(&CurrentSnapshotData, DTX_CONTEXT_LOCAL_ONLY);
+	FirstSnapshotSet = true;
+
+	elog((Debug_print_snapshot_dtm ? LOG : DEBUG5),
+		 "[Local Snapshot] xmin = %u, xmax = %u (gxid = "UINT64_FORMAT", '%s')",
+		 CurrentSnapshot->xmin, CurrentSnapshot->xmax,
+		 getDistributedTransactionId(),
+		 DtxContextToString(DistributedTransactionContext));
+
+	return CurrentSnapshot;
+}
+
 /*
  * GetLatestSnapshot
  *		Get a snapshot that is up-to-date as of the current instant,
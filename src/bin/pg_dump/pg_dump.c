@@ -161,6 +161,9 @@ static bool gp_partitioning_available = false;
 /* flag indicating whether or not this GP database supports column encoding */
 static bool gp_attribute_encoding_available = false;
 
+/* flag indicating whether or not this GP database has zstd dictionaries */
+static bool gp_zstd_dictionary_available = false;
+
 static DumpId binary_upgrade_dumpid;
 
 /* override for standard extra_float_digits setting */
@@ -378,6 +381,9 @@ static bool is_returns_table_function(int nallargs, char **argmodes);
 static bool testGPbackend(Archive *fout);
 static bool testPartitioningSupport(Archive *fout);
 static bool testAttributeEncodingSupport(Archive *fout);
+static bool testZstdDictionarySupport(Archive *fout);
+static void dumpZstdDictionaries(Archive *fout, PQExpBuffer q,
+								 const TableInfo *tbinfo);
 
 static char *nextToken(register char **stringp, register const char *delim);
 static void addDistributedBy(Archive *fout, PQExpBuffer q, const TableInfo *tbinfo, int actual_atts);
@@ -1063,6 +1069,11 @@ main(int argc, char **argv)
 	 */
 	gp_attribute_encoding_available = testAttributeEncodingSupport(fout);
 
+	/*
+	 * Remember whether or not this GP database has trained zstd dictionaries.
+	 */
+	gp_zstd_dictionary_available = testZstdDictionarySupport(fout);
+
 	/* check the version for the synchronized snapshots feature */
 	if (numWorkers > 1 && fout->remoteVersion < 90200
 		&& !dopt.no_synchronized_snapshots)
@@ -9503,6 +9514,14 @@ getEventTriggers(Archive *fout, int *numEventTriggers)
 		/* Decide whether we want to dump it */
 		selectDumpableObject(&(evtinfo[i].dobj), fout);
 
+		/*
+		 * GPDB: event triggers created by initdb, such as the one that
+		 * removes the zstd dictionaries of dropped tables, already exist in
+		 * the database restored into.
+		 */
+		if (evtinfo[i].dobj.catId.oid <= (Oid) g_last_builtin_oid)
+			evtinfo[i].dobj.dump = DUMP_COMPONENT_NONE;
+
 		/* Event Triggers do not currently have ACLs. */
 		evtinfo[i].dobj.dump &= ~DUMP_COMPONENT_ACL;
 	}
@@ -18952,6 +18971,15 @@ dumpTableSchema(Archive *fout, const TableInfo *tbinfo)
 								  tbinfo->attfdwoptions[j]);
 		}						/* end loop over columns */
 
+		/*
+		 * Restore the trained zstd dictionaries of the columns, before any
+		 * data is loaded.
+		 */
+		if (gp_zstd_dictionary_available &&
+			(tbinfo->relkind == RELKIND_RELATION ||
+			 tbinfo->relkind == RELKIND_MATVIEW))
+			dumpZstdDictionaries(fout, q, tbinfo);
+
 		if (ftoptions)
 			free(ftoptions);
 		if (srvname)
@@ -21382,6 +21410,91 @@ testAttributeEncodingSupport(Archive *fout)
 }
 
 
+/*
+ * testZstdDictionarySupport - tests whether or not the current GP
+ * database has trained zstd dictionaries.
+ */
+static bool
+testZstdDictionarySupport(Archive *fout)
+{
+	PQExpBuffer query;
+	PGresult   *res;
+	bool		isSupported;
+
+	query = createPQExpBuffer();
+
+	appendPQExpBuffer(query, "SELECT 1 from pg_catalog.pg_class where relnamespace = 11 and relname  = 'gp_zstd_dictionary';");
+	res = ExecuteSqlQuery(fout, query->data, PGRES_TUPLES_OK);
+
+	isSupported = (PQntuples(res) == 1);
+
+	PQclear(res);
+
+	/* Skip the per-table queries if there is nothing to dump */
+	if (isSupported)
+	{
+		resetPQExpBuffer(query);
+		appendPQExpBuffer(query, "SELECT 1 FROM pg_catalog.gp_zstd_dictionary LIMIT 1;");
+		res = ExecuteSqlQuery(fout, query->data, PGRES_TUPLES_OK);
+
+		isSupported = (PQntuples(res) == 1);
+
+		PQclear(res);
+	}
+
+	destroyPQExpBuffer(query);
+
+	return isSupported;
+}
+
+/*
+ * dumpZstdDictionaries
+ *
+ * The zstd frames of a column refer to the dictionary they were compressed
+ * with by dictid, which is recorded in the dictionary itself. Restore the
+ * dictionaries of the table's columns with gp_zstd_store_dictionary(), which
+ * keeps their dictids: that is what the segment files carried over by a
+ * binary upgrade need, and data loaded by a normal restore is compressed
+ * with the latest version again. Columns are referred to by name, since a
+ * normal restore renumbers them.
+ */
+static void
+dumpZstdDictionaries(Archive *fout, PQExpBuffer q, const TableInfo *tbinfo)
+{
+	PQExpBuffer query = createPQExpBuffer();
+	PGresult   *res;
+	int			ntups;
+	int			i;
+
+	appendPQExpBuffer(query,
+					  "SELECT a.attname, d.dictversion, d.dict "
+					  "FROM pg_catalog.gp_zstd_dictionary d "
+					  "JOIN pg_catalog.pg_attribute a "
+					  "ON a.attrelid = d.relid AND a.attnum = d.attnum "
+					  "WHERE d.relid = '%u'::pg_catalog.oid AND NOT a.attisdropped "
+					  "ORDER BY d.attnum, d.dictversion",
+					  tbinfo->dobj.catId.oid);
+	res = ExecuteSqlQuery(fout, query->data, PGRES_TUPLES_OK);
+
+	ntups = PQntuples(res);
+	if (ntups > 0)
+		appendPQExpBufferStr(q, "\n-- Restore zstd dictionaries\n");
+	for (i = 0; i < ntups; i++)
+	{
+		appendPQExpBufferStr(q, "SELECT pg_catalog.gp_zstd_store_dictionary(");
+		appendStringLiteralAH(q, fmtQualifiedDumpable(tbinfo), fout);
+		appendPQExpBufferStr(q, "::pg_catalog.regclass, ");
+		appendStringLiteralAH(q, PQgetvalue(res, i, 0), fout);
+		appendPQExpBuffer(q, ", %s, ", PQgetvalue(res, i, 1));
+		appendStringLiteralAH(q, PQgetvalue(res, i, 2), fout);
+		appendPQExpBufferStr(q, "::pg_catalog.bytea);\n");
+	}
+
+	PQclear(res);
+	destroyPQExpBuffer(query);
+}
+
+
 bool
 testExtProtocolSupport(Archive *fout)
 {
@@ -119,6 +119,28 @@ typedef struct BMBuildState
 	bool			use_wal;	/* whether or not we write WAL records */
 } BMBuildState;
 
+/*
+ * the state for inserts into an existing index, kept in the IndexInfo's
+ * ii_AmCache for the duration of a statement.
+ */
+typedef struct BMInsertState
+{
+	MemoryContext	bm_cxt;		/* where the state lives */
+	RegProcedure   *bm_eq_funcs;	/* equality function of each attribute */
+
+	/*
+	 * The LOV item of the last value inserted, and the LOV heap it was found
+	 * in. Loads often insert runs of the same value, which then don't need
+	 * a search of the LOV btree.
+	 */
+	bool			bm_have_last;
+	Datum		   *bm_last_values;
+	bool		   *bm_last_nulls;
+	Oid				bm_last_lovHeapId;
+	BlockNumber		bm_last_lovBlock;
+	OffsetNumber	bm_last_lovOffset;
+} BMInsertState;
+
 /**
  * The key used inside BMBuildState's lovitem_hash hashtable
  *
@@ -288,8 +310,11 @@ extern void _bitmap_init(Relation indexrel, bool use_wal, bool for_empty);
 extern void _bitmap_buildinsert(Relation rel, ItemPointerData ht_ctid, 
 								Datum *attdata, bool *nulls,
 							 	BMBuildState *state);
+extern BMInsertState *_bitmap_init_insertstate(Relation rel,
+												MemoryContext cxt);
 extern void _bitmap_doinsert(Relation rel, ItemPointerData ht_ctid, 
-							 Datum *attdata, bool *nulls);
+							 Datum *attdata, bool *nulls,
+							 BMInsertState *state);
 extern void _bitmap_write_alltids(Relation rel, BMTidBuildBuf *tids,
 						  		  bool use_wal);
 
@@ -56,6 +56,6 @@
  */
 
 /*							3yyymmddN */
-#define CATALOG_VERSION_NO	302206171
+#define CATALOG_VERSION_NO	302610185
 
 #endif
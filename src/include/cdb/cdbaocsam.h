@@ -68,6 +68,8 @@ typedef struct AOCSInsertDescData
     Oid         visimaprelid;
     Oid         visimapidxid;
 	struct DatumStreamWrite **ds;
+	/* eof/eofUncompress per column while suspended (ds == NULL), else NULL */
+	int64	   *suspendedEofs;
 
 	AppendOnlyBlockDirectory blockDirectory;
 
@@ -204,6 +206,23 @@ typedef struct AOCSScanDescData
 	int				aos_scaned_rows;
 	int				*aos_qual_rows;
 
+	/*
+	 * Result of each pushed-down qual on the last value it was evaluated
+	 * on, reused while its column stays inside an RLE_TYPE run. Only used
+	 * if the quals are stable and don't look at system columns.
+	 */
+	bool			aos_qual_run_cache;
+	bool			*aos_qual_run_valid;
+	bool			*aos_qual_run_result;
+
+	/*
+	 * Set if the scan only has to return the right number of rows, see
+	 * appendonly_scan_counts_only().
+	 */
+	bool			aos_count_only;
+	int				aos_count_nextseg;		/* next segfile to count */
+	int64			aos_count_remaining;	/* rows left in the current one */
+
 } AOCSScanDescData;
 
 typedef AOCSScanDescData *AOCSScanDesc;
@@ -365,6 +384,8 @@ static inline void aocs_insert(AOCSInsertDesc idesc, TupleTableSlot *slot)
 	aocs_insert_values(idesc, slot->tts_values, slot->tts_isnull, (AOTupleId *) &slot->tts_tid);
 }
 extern void aocs_insert_finish(AOCSInsertDesc idesc, dlist_head *head);
+extern void aocs_insert_suspend(AOCSInsertDesc idesc);
+extern void aocs_insert_resume(AOCSInsertDesc idesc);
 extern AOCSFetchDesc aocs_fetch_init(Relation relation,
 									 Snapshot snapshot,
 									 Snapshot appendOnlyMetaDataSnapshot,
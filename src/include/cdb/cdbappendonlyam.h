@@ -259,6 +259,14 @@ typedef struct AppendOnlyScanDescData
 	ExprContext		*aos_pushdown_econtext;
 	ExprState		*aos_pushdown_qual;
 
+	/*
+	 * Set if the scan only has to return the right number of rows, see
+	 * appendonly_scan_counts_only().
+	 */
+	bool		aos_count_only;
+	int			aos_count_nextseg;		/* next segfile to count */
+	int64		aos_count_remaining;	/* rows left in the current one */
+
 }	AppendOnlyScanDescData;
 
 typedef AppendOnlyScanDescData *AppendOnlyScanDesc;
@@ -432,6 +440,10 @@ extern TableScanDesc appendonly_beginscan(Relation relation,
 										  int nkeys, struct ScanKeyData *key,
 										  ParallelTableScanDesc pscan,
 										  uint32 flags);
+extern bool appendonly_scan_counts_only(PlanState *ps,
+										ParallelTableScanDesc parallel_scan,
+										Snapshot snapshot,
+										uint32 flags);
 extern TableScanDesc appendonly_beginscan_extractcolumns(Relation rel,
 														 Snapshot snapshot,
 														 int nkeys, struct ScanKeyData *key,
@@ -135,6 +135,20 @@ typedef struct AppendOnlyBlockDirectory
 	ScanKey scanKeys;
 	StrategyNumber *strategyNumbers;
 
+	/*
+	 * Rows covered by the last committed block directory entry found by a
+	 * uniqueness check, and the snapshot type and command it was found with.
+	 * Consecutive checks of a load mostly hit the same blocks, see
+	 * blkdir_entry_exists().
+	 */
+	bool coveredValid;
+	SnapshotType coveredSnapshotType;
+	CommandId coveredCommandId;
+	int coveredSegmentFileNum;
+	int coveredColumnGroupNo;
+	int64 coveredFirstRowNum;
+	int64 coveredLastRowNum;
+
 }	AppendOnlyBlockDirectory;
 
 
@@ -73,6 +73,14 @@ typedef struct BufferedRead
 	/* current read position */
 	off_t				 fileOff;
 
+	/*
+	 * Mapping of the whole file when gp_appendonly_mmap_read is on, NULL
+	 * otherwise.  The large reads then just move largeReadMemory around in
+	 * the mapping, and the before memory is not used.
+	 */
+	uint8				*mappedMemory;
+	struct BufferedReadMapping *mapping;
+
 	RelFileNode 		relFileNode;
 	/*
 	 * Temporary limit support for random reading.
@@ -0,0 +1,66 @@
+/*-------------------------------------------------------------------------
+ *
+ * cdbcardfeedback.h
+ *	  Cardinality feedback from query execution to GPORCA.
+ *
+ * Portions Copyright (c) 2023, HashData Technology Limited.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/cdb/cdbcardfeedback.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef CDBCARDFEEDBACK_H
+#define CDBCARDFEEDBACK_H
+
+#include "executor/execdesc.h"
+#include "utils/timestamp.h"
+
+/*
+ * Max number of columns in a filter for which we keep feedback.  This must
+ * match GPOPT_CARD_FEEDBACK_MAX_COLS in GPORCA.
+ */
+#define CARD_FEEDBACK_MAX_ATTS	8
+
+/*
+ * Max number of distinct operators in a filter for which we keep feedback.
+ * This must match GPOPT_CARD_FEEDBACK_MAX_OPS in GPORCA.
+ */
+#define CARD_FEEDBACK_MAX_OPS	8
+
+/*
+ * A filter on a table, identified by the columns it references and the
+ * operators it applies to them: "a < 10" and "a > 10" have very different
+ * selectivities and get separate entries.  The constants in the filter are
+ * ignored, like pg_stat_statements ignores them when it normalizes a query:
+ * a report that runs every night with a different date still hits the same
+ * entry.
+ */
+typedef struct CardFeedbackKey
+{
+	Oid			dbid;
+	Oid			relid;
+	int			natts;
+	AttrNumber	attnos[CARD_FEEDBACK_MAX_ATTS];	/* ascending */
+	int			nops;
+	Oid			opnos[CARD_FEEDBACK_MAX_OPS];	/* ascending, distinct */
+} CardFeedbackKey;
+
+typedef struct CardFeedbackEntry
+{
+	CardFeedbackKey key;			/* hash key, must be first */
+	double		logfactor;			/* log of actual rows / estimated rows */
+	TimestampTz	updated;			/* time of the last observation */
+	int64		nobservations;
+} CardFeedbackEntry;
+
+extern Size CardFeedbackShmemSize(void);
+extern void CardFeedbackShmemInit(void);
+
+extern void CardFeedbackExecutorStart(QueryDesc *queryDesc, int eflags);
+extern void CardFeedbackRecord(QueryDesc *queryDesc);
+extern void CardFeedbackForgetRelation(Oid relid);
+extern CardFeedbackEntry *CardFeedbackGetEntries(Oid dbid, int *nentries);
+
+#endif   /* CDBCARDFEEDBACK_H */
@@ -62,6 +62,7 @@ typedef struct DispatcherInternalFuncs
 	void (*checkResults)(struct CdbDispatcherState *ds, DispatchWaitMode waitMode);
 	void (*dispatchToGang)(struct CdbDispatcherState *ds, struct Gang *gp, int sliceIndex);
 	void (*waitDispatchFinish)(struct CdbDispatcherState *ds);
+	void (*destroyDispatchParams)(void *dispatchParams);
 
 }DispatcherInternalFuncs;
 
@@ -85,6 +85,6 @@ extern int
 DistributedSnapshot_Serialize(DistributedSnapshot *ds, char *buf);
 
 extern int
-DistributedSnapshot_Deserialize(const char *buf, DistributedSnapshot *ds);
+DistributedSnapshot_Deserialize(const char *buf, int len, DistributedSnapshot *ds);
 
 #endif   /* CDBDISTRIBUTEDSNAPSHOT_H */
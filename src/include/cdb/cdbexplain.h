@@ -107,6 +107,15 @@ cdbexplain_recvExecStats(struct PlanState              *planstate,
                          int                            sliceIndex,
                          struct CdbExplain_ShowStatCtx *showstatctx);
 
+/*
+ * cdbexplain_getNodeRows
+ *    Called by qDisp, after cdbexplain_recvExecStats(), to get the rows
+ *    produced by a node over all the qExecs that ran it.
+ */
+bool
+cdbexplain_getNodeRows(struct PlanState *planstate, double *ntuples,
+                       double *nloops, int *ninst);
+
 /*
  * cdbexplain_showExecStatsBegin
  *    Called by qDisp process to create a CdbExplain_ShowStatCtx structure
@@ -329,6 +329,7 @@ extern void tmShmemInit(void);
 extern int	tmShmemSize(void);
 
 extern void verify_shared_snapshot_ready(int cid);
+extern bool canUseLocalSnapshot(struct PlannedStmt *stmt);
 
 int			mppTxnOptions(bool needDtx);
 int			mppTxOptions_IsoLevel(int txnOptions);
@@ -304,10 +304,28 @@ typedef enum GpVars_Interconnect_Type
 	INTERCONNECT_TYPE_TCP = 0,
 	INTERCONNECT_TYPE_UDPIFC,
 	INTERCONNECT_TYPE_PROXY,
+	INTERCONNECT_TYPE_SHM,
 } GpVars_Interconnect_Type;
 
 extern int Gp_interconnect_type;
 
+/*
+ * Parameter gp_interconnect_shm_ring_size
+ *
+ * Size, in kB, of the shared-memory ring of each same-host connection when
+ * gp_interconnect_type is "shm".
+ */
+extern int gp_interconnect_shm_ring_size;
+
+/*
+ * Parameter gp_interconnect_tcp_keep_connections
+ *
+ * Maximum number of idle outgoing connections a backend keeps open when
+ * gp_interconnect_type is "tcp", so that later statements of the session
+ * can reuse them instead of connecting again.  Zero disables reuse.
+ */
+extern int gp_interconnect_tcp_keep_connections;
+
 extern char *gp_interconnect_proxy_addresses;
 
 typedef enum GpVars_Interconnect_Method
@@ -367,6 +385,15 @@ extern bool gp_interconnect_aggressive_retry; /* fast-track app-level retry */
  */
 extern bool gp_interconnect_full_crc;
 
+/*
+ * Parameter gp_interconnect_udp_segmentation_offload
+ *
+ * Let the kernel segment outgoing and coalesce incoming UDP interconnect
+ * packets (UDP_SEGMENT/UDP_GRO, Linux only) to cut the per-packet syscall
+ * cost.  Senders fall back to one packet per call where it is refused.
+ */
+extern bool gp_interconnect_udp_segmentation_offload;
+
 /*
  * Parameter gp_interconnect_log_stats
  *
@@ -57,6 +57,7 @@ struct Motion;
 struct Var;
 struct Const;
 struct ArrayExpr;
+struct CardFeedbackEntry;
 
 #include "gpopt/utils/RelationWrapper.h"
 
@@ -649,6 +650,11 @@ int FindNodes(Node *node, List *nodeTags);
 // look for nodes with non-default collation; returns 1 if any exist, -1 otherwise
 int CheckCollation(Node *node);
 
+// would the planner use a partition-wise join or aggregate for this query level
+bool HasPartitionwiseJoinCandidate(Query *query);
+
+bool HasPartitionwiseAggCandidate(Query *query);
+
 Node *CoerceToCommonType(ParseState *pstate, Node *node, Oid target_type,
 						 const char *context);
 
@@ -750,6 +756,9 @@ List *GetRelChildIndexes(Oid reloid);
 
 void GPDBLockRelationOid(Oid reloid, int lockmode);
 
+// cardinality feedback entries of the current database
+CardFeedbackEntry *GetCardFeedbackEntries(int *nentries);
+
 }  //namespace gpdb
 
 #define ForEach(cell, l) \
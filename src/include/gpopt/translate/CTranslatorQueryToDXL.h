@@ -147,6 +147,10 @@ private:
 	// throw an exception when found
 	void CheckSirvFuncsWithoutFromClause(Query *query);
 
+	// throw an exception if the planner would use a partition-wise join or
+	// aggregate for the query
+	static void CheckPartitionwisePlans(Query *query);
+
 	// check for SIRV functions in the tree rooted at the given node
 	BOOL HasSirvFunctions(Node *node) const;
 
@@ -23,10 +23,13 @@
 
 extern PlannedStmt * optimize_query(Query *parse, int cursorOptions, ParamListInfo boundParams);
 
+/* in gpopt/CGPOptimizer.cpp */
+extern bool IsValidOptimizerCostParam(const char *name);
+
 #else
 
 /* Keep compilers quiet in case the build used --disable-orca */
-static PlannedStmt *
+static inline PlannedStmt *
 optimize_query(Query *parse, int cursorOptions, ParamListInfo boundParams)
 {
 	Assert(false);
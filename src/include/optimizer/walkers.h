@@ -43,5 +43,7 @@ extern List *extract_nodes_plan(Plan *pl, int nodeTag, bool descendIntoSubquerie
 extern List *extract_nodes_expression(Node *node, int nodeTag, bool descendIntoSubqueries);
 extern int find_nodes(Node *node, List *nodeTags);
 extern int check_collation(Node *node);
+extern bool has_partitionwise_join_candidate(Query *query);
+extern bool has_partitionwise_agg_candidate(Query *query);
 
 #endif /* WALKERS_H_ */
@@ -226,6 +226,18 @@ datumstreamread_advance(DatumStreamRead * acc)
 	}
 }
 
+/*
+ * Is the current datum a repeat of the previous one, in the middle of an
+ * RLE_TYPE run? Callers can reuse whatever they computed from the previous
+ * datum.
+ */
+inline static bool
+datumstreamread_rle_repeats_previous(DatumStreamRead * acc)
+{
+	return acc->largeObjectState == DatumStreamLargeObjectState_None &&
+		acc->blockRead.rle_repeats_previous;
+}
+
 extern int	datumstreamread_nthlarge(DatumStreamRead * ds);
 inline static int
 datumstreamread_nth(DatumStreamRead * acc)
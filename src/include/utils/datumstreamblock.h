@@ -1160,6 +1160,8 @@ typedef struct DatumStreamBlockRead
 	int32		rle_repeatcounts_index;
 	bool		rle_in_repeated_item;
 	int32		rle_repeated_item_count;
+	bool		rle_repeats_previous;	/* current item is a copy of the
+										 * previous one */
 
 	int32		rle_total_repeat_items_read;
 
@@ -1729,6 +1731,8 @@ DatumStreamBlockRead_AdvanceDense(DatumStreamBlockRead * dsr)
 	++dsr->nth;
 	//Initially, -1.
 
+	dsr->rle_repeats_previous = false;
+
 	/* Advance out of bounds? */
 		if (dsr->nth >= dsr->logical_row_count)
 		return 0;
@@ -1831,6 +1835,7 @@ DatumStreamBlockRead_AdvanceDense(DatumStreamBlockRead * dsr)
 			/*
 			 * Item pointers are already setup.
 			 */
+			dsr->rle_repeats_previous = true;
 			return 1;
 		}
 
@@ -274,6 +274,7 @@ extern bool Debug_print_ivm;
 extern bool	Debug_print_full_dtm;
 extern bool	Debug_print_snapshot_dtm;
 extern bool Debug_disable_distributed_snapshot;
+extern bool gp_enable_direct_dispatch_local_snapshot;
 extern bool Debug_abort_after_distributed_prepared;
 extern bool Debug_appendonly_print_insert;
 extern bool Debug_appendonly_print_insert_tuple;
@@ -297,9 +298,11 @@ extern bool gp_local_distributed_cache_stats;
 extern bool gp_appendonly_verify_block_checksums;
 extern bool gp_appendonly_verify_write_block;
 extern bool gp_appendonly_compaction;
+extern bool gp_appendonly_mmap_read;
 extern bool enable_parallel;
 extern int  gp_appendonly_insert_files;
 extern int  gp_appendonly_insert_files_tuples_range;
+extern int  gp_appendonly_insert_mem_limit;
 extern bool enable_answer_query_using_materialized_views;
 /*
  * gp_enable_multiphase_limit is not cost based.
@@ -549,6 +552,9 @@ extern double optimizer_damping_factor_join;
 extern double optimizer_damping_factor_groupby;
 extern bool optimizer_dpe_stats;
 extern bool optimizer_enable_derive_stats_all_groups;
+extern bool optimizer_cardinality_feedback;
+extern int optimizer_cardinality_feedback_entries;
+extern int optimizer_cardinality_feedback_half_life;
 
 /* Costing or tuning related GUCs used by the Optimizer */
 extern int optimizer_segments;
@@ -557,6 +563,22 @@ extern double optimizer_cost_threshold;
 extern double optimizer_nestloop_factor;
 extern double optimizer_sort_factor;
 
+/* optimizer_cost_param_factors, parsed */
+typedef struct OptimizerCostParamFactor
+{
+	char		name[64];
+	double		factor;
+} OptimizerCostParamFactor;
+
+typedef struct OptimizerCostParamFactors
+{
+	int			nitems;
+	OptimizerCostParamFactor items[FLEXIBLE_ARRAY_MEMBER];
+} OptimizerCostParamFactors;
+
+extern char *optimizer_cost_param_factors_str;
+extern OptimizerCostParamFactors *optimizer_cost_param_factors;
+
 /* Optimizer hints */
 extern int optimizer_array_expansion_threshold;
 extern int optimizer_join_order_threshold;
@@ -570,6 +592,7 @@ extern bool optimizer_force_three_stage_scalar_dqa;
 extern bool optimizer_force_expanded_distinct_aggs;
 extern bool optimizer_force_agg_skew_avoidance;
 extern bool optimizer_penalize_skew;
+extern bool optimizer_enable_column_projection_cost;
 extern bool optimizer_prune_computed_columns;
 extern bool optimizer_push_requirements_from_consumer_to_producer;
 extern bool optimizer_enforce_subplans;
@@ -625,6 +648,7 @@ extern bool gp_enable_global_deadlock_detector;
 
 extern bool gp_enable_predicate_pushdown;
 extern int  gp_predicate_pushdown_sample_rows;
+extern bool gp_enable_ao_count_from_metadata;
 
 typedef enum
 {
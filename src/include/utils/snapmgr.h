@@ -105,6 +105,7 @@ OldSnapshotThresholdActive(void)
 }
 
 extern Snapshot GetTransactionSnapshot(void);
+extern Snapshot GetLocalTransactionSnapshot(void);
 extern Snapshot GetLatestSnapshot(void);
 extern void SnapshotSetCommandId(CommandId curcid);
 extern Snapshot GetOldestSnapshot(void);
@@ -32,6 +32,7 @@
 		"gp_debug_linger",
 		"gp_default_storage_options",
 		"gp_disable_tuple_hints",
+		"gp_enable_ao_count_from_metadata",
 		"gp_enable_runtime_filter",
 		"gp_enable_segment_copy_checking",
 		"gp_external_enable_filter_pushdown",
@@ -51,12 +52,15 @@
 		"gp_interconnect_proxy_addresses",
 		"gp_interconnect_queue_depth",
 		"gp_interconnect_setup_timeout",
+		"gp_interconnect_shm_ring_size",
 		"gp_interconnect_snd_queue_depth",
+		"gp_interconnect_tcp_keep_connections",
 		"gp_interconnect_tcp_listener_backlog",
 		"gp_interconnect_timer_checking_period",
 		"gp_interconnect_timer_period",
 		"gp_interconnect_transmit_timeout",
 		"gp_interconnect_type",
+		"gp_interconnect_udp_segmentation_offload",
 		"gp_log_interconnect",
 		"gp_log_resgroup_memory",
 		"gp_log_resqueue_memory",
@@ -152,3 +156,5 @@
 		"gp_resgroup_debug_wait_queue",
 		"gp_appendonly_insert_files",
 		"gp_appendonly_insert_files_tuples_range",
+		"gp_appendonly_insert_mem_limit",
+		"gp_appendonly_mmap_read",
@@ -199,6 +199,7 @@
 		"gp_enable_agg_pushdown",
 		"gp_enable_ao_indexscan",
 		"gp_enable_direct_dispatch",
+		"gp_enable_direct_dispatch_local_snapshot",
 		"gp_enable_explain_allstat",
 		"gp_enable_fast_sri",
 		"gp_enable_global_deadlock_detector",
@@ -396,8 +397,12 @@
 		"optimizer_apply_left_outer_to_union_all_disregarding_stats",
 		"optimizer_array_constraints",
 		"optimizer_array_expansion_threshold",
+		"optimizer_cardinality_feedback",
+		"optimizer_cardinality_feedback_entries",
+		"optimizer_cardinality_feedback_half_life",
 		"optimizer_control",
 		"optimizer_cost_model",
+		"optimizer_cost_param_factors",
 		"optimizer_cost_threshold",
 		"optimizer_cte_inlining",
 		"optimizer_damping_factor_filter",
@@ -408,6 +413,7 @@
 		"optimizer_enable_associativity",
 		"optimizer_enable_bitmapscan",
 		"optimizer_enable_broadcast_nestloop_outer_child",
+		"optimizer_enable_column_projection_cost",
 		"optimizer_enable_constant_expression_evaluation",
 		"optimizer_enable_ctas",
 		"optimizer_enable_derive_stats_all_groups",
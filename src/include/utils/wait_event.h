@@ -145,6 +145,7 @@ typedef enum
 	/* GPDB additions */
 	,
 	WAIT_EVENT_DTX_RECOVERY,
+	WAIT_EVENT_DISPATCH_RESULT,
 	WAIT_EVENT_SHAREINPUT_SCAN,
 	WAIT_EVENT_INTERCONNECT,
 	WAIT_EVENT_LOGINMONITOR_FINISH
@@ -145,6 +145,35 @@ CREATE TABLE unique_index_ao_row (a INT unique) USING ao_row
 5: INSERT INTO unique_index_ao_row VALUES(202);
 DROP TABLE unique_index_ao_row;
 
+-- Case 6b: Many checks against the same block directory entry ---------------
+CREATE TABLE unique_index_ao_row (a INT unique) USING ao_row
+    DISTRIBUTED REPLICATED;
+-- 1. Tx 1 commits rows 1-1000, which share a few block directory entries, and
+--    deletes rows 1-500.
+-- 2. Tx 2 re-inserts rows 1-500. Each check finds a deleted row, most of them
+--    in the entry remembered by the previous check, without scanning the
+--    block directory, and the insert succeeds.
+-- 3. Tx 3 deletes rows 1-10 again and tries to insert 1, 2, 3 and then 600,
+--    which is covered by the entry remembered for 1, 2 and 3, and raises unique
+--    constraint violation.
+-- 4. Tx 4 inserts rows 1001-1100 and does not commit yet.
+-- 5. Tx 5 tries to insert the deleted key 5, then the in-progress key 1050,
+--    which is not covered by the remembered entry, and blocks on tx 4.
+-- 6. Tx 4 commits and tx 5 raises unique constraint violation.
+1: INSERT INTO unique_index_ao_row SELECT generate_series(1, 1000);
+1: DELETE FROM unique_index_ao_row WHERE a <= 500;
+2: INSERT INTO unique_index_ao_row SELECT generate_series(1, 500);
+3: DELETE FROM unique_index_ao_row WHERE a <= 10;
+3: INSERT INTO unique_index_ao_row VALUES (1), (2), (3), (600);
+4: BEGIN;
+4: INSERT INTO unique_index_ao_row SELECT generate_series(1001, 1100);
+5&: INSERT INTO unique_index_ao_row VALUES (5), (1050);
+4: COMMIT;
+5<:
+SELECT count(*) FROM unique_index_ao_row;
+SELECT count(*) FROM unique_index_ao_row WHERE a <= 10;
+DROP TABLE unique_index_ao_row;
+
 --------------------------------------------------------------------------------
 ----------------- More concurrent tests with fault injection ------------------
 --------------------------------------------------------------------------------
@@ -263,3 +263,26 @@ SELECT count(*) FROM bmupdate WHERE id >= 97 and id <= 99 and gp_segment_id = 0;
 
 DROP TABLE bmupdate;
 
+
+-- Inserts of a run of the same value remember the LOV item of the value and
+-- only set the bits of the later rows (see _bitmap_doinsert()). A VACUUM of
+-- the index in the middle of such a run must not lose any of them.
+CREATE TABLE bm_same_value (id int, v int) DISTRIBUTED BY (id);
+CREATE INDEX bm_same_value_v ON bm_same_value USING bitmap (v);
+INSERT INTO bm_same_value SELECT i, i % 3 FROM generate_series(1, 3000) i;
+DELETE FROM bm_same_value WHERE id <= 1500;
+
+SELECT gp_inject_fault('bitmap_insert_same_value', 'suspend', '', '', '', 100, 100, 0, dbid) FROM gp_segment_configuration where role = 'p' and content = 0;
+1&: INSERT INTO bm_same_value SELECT i, 7 FROM generate_series(3001, 6000) i;
+SELECT gp_wait_until_triggered_fault('bitmap_insert_same_value', 100, dbid) FROM gp_segment_configuration where role = 'p' and content = 0;
+2: VACUUM bm_same_value;
+SELECT gp_inject_fault('bitmap_insert_same_value', 'reset', dbid) FROM gp_segment_configuration where role = 'p' and content = 0;
+1<:
+
+-- The index scan and a sequential scan find the same rows.
+1: SET enable_seqscan = off;
+1: SET optimizer_enable_tablescan = off;
+1: SELECT v, count(*) FROM bm_same_value WHERE v IN (0, 1, 2, 7) GROUP BY v ORDER BY v;
+2: SELECT v, count(*) FROM bm_same_value WHERE v + 0 IN (0, 1, 2, 7) GROUP BY v ORDER BY v;
+
+DROP TABLE bm_same_value;
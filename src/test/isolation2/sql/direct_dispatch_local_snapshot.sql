@@ -0,0 +1,37 @@
+--
+-- With gp_enable_direct_dispatch_local_snapshot, a read-only statement that
+-- is direct-dispatched to one segment runs with a local snapshot. Show it by
+-- reading a row that a distributed transaction has committed on every
+-- segment, while the coordinator still has the transaction in progress.
+--
+create extension if not exists gp_inject_fault;
+
+create table dd_local_snap (a int, b int) distributed by (a);
+insert into dd_local_snap select i, 0 from generate_series(1, 10) i;
+
+select gp_inject_fault('dtm_before_insert_forget_comitted', 'suspend', dbid) from gp_segment_configuration where role = 'p' and content = -1;
+1&: update dd_local_snap set b = 1;
+select gp_wait_until_triggered_fault('dtm_before_insert_forget_comitted', 1, dbid) from gp_segment_configuration where role = 'p' and content = -1;
+
+-- A distributed snapshot still has the update in progress.
+2: select b from dd_local_snap where a = 1;
+
+-- A local snapshot sees what the segment has committed.
+2: set gp_enable_direct_dispatch_local_snapshot = on;
+2: select b from dd_local_snap where a = 1;
+
+-- Statements that read more than one segment, or run in a transaction
+-- block, keep the distributed snapshot.
+2: select count(*) from dd_local_snap where b = 1;
+2: begin;
+2: select b from dd_local_snap where a = 1;
+2: end;
+
+select gp_inject_fault('dtm_before_insert_forget_comitted', 'reset', dbid) from gp_segment_configuration where role = 'p' and content = -1;
+1<:
+
+2: reset gp_enable_direct_dispatch_local_snapshot;
+2: select b from dd_local_snap where a = 1;
+2q:
+
+drop table dd_local_snap;
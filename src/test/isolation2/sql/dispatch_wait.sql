@@ -0,0 +1,43 @@
+--
+-- The dispatcher waits for the results of the QEs on a WaitEventSet, and
+-- reports the wait as the DispatchResult wait event.
+--
+create extension if not exists gp_inject_fault;
+
+create function wait_for_dispatch_result(pattern text) returns bool as $$
+begin	/* in func */
+  for i in 1..600 loop	/* in func */
+    perform pg_stat_clear_snapshot();	/* in func */
+    if exists (select 1 from pg_stat_activity	/* in func */
+               where query like pattern and wait_event = 'DispatchResult') then	/* in func */
+      return true;	/* in func */
+    end if;	/* in func */
+    perform pg_sleep(0.1);	/* in func */
+  end loop;	/* in func */
+  return false;	/* in func */
+end;	/* in func */
+$$ language plpgsql;
+
+-- A QE that has not started the command keeps the dispatcher waiting.
+select gp_inject_fault('exec_mpp_query_start', 'suspend', dbid) from gp_segment_configuration where role = 'p' and content = 0;
+1&: create table dispatch_wait_cancel (a int);
+select wait_for_dispatch_result('create table dispatch_wait_cancel%');
+
+-- A cancel request wakes the dispatcher up through its latch.
+select pg_cancel_backend(pid) from pg_stat_activity where query like 'create table dispatch_wait_cancel%';
+select gp_inject_fault('exec_mpp_query_start', 'reset', dbid) from gp_segment_configuration where role = 'p' and content = 0;
+1<:
+select count(*) from pg_class where relname = 'dispatch_wait_cancel';
+
+-- A failure of the wait itself is logged, FTS is asked for a probe, and the
+-- dispatcher goes on waiting for the results.
+select gp_inject_fault('check_dispatch_result_wait', 'error', '', '', '', 1, 1, 0, dbid) from gp_segment_configuration where role = 'p' and content = -1;
+1: create table dispatch_wait_error (a int);
+select gp_wait_until_triggered_fault('check_dispatch_result_wait', 1, dbid) from gp_segment_configuration where role = 'p' and content = -1;
+select gp_inject_fault('check_dispatch_result_wait', 'reset', dbid) from gp_segment_configuration where role = 'p' and content = -1;
+1: insert into dispatch_wait_error select generate_series(1, 10);
+1: select count(*) from dispatch_wait_error;
+1: drop table dispatch_wait_error;
+1q:
+
+drop function wait_for_dispatch_result(text);
@@ -0,0 +1,53 @@
+-- count(*) of append-only tables answered from the segment file metadata
+-- and the visimap (gp_enable_ao_count_from_metadata).
+CREATE TABLE ao_count_meta (a int, b text) WITH (appendonly=true) DISTRIBUTED BY (a);
+CREATE TABLE aocs_count_meta (a int, b text) WITH (appendonly=true, orientation=column) DISTRIBUTED BY (a);
+INSERT INTO ao_count_meta SELECT i, repeat('x', i % 10) FROM generate_series(1, 1000) i;
+INSERT INTO aocs_count_meta SELECT * FROM ao_count_meta;
+
+-- deleted rows are hidden by the visimap
+DELETE FROM ao_count_meta WHERE a <= 100;
+DELETE FROM aocs_count_meta WHERE a <= 100;
+
+-- rows of an aborted insert are not in the segment file metadata
+BEGIN;
+INSERT INTO ao_count_meta SELECT i, 'y' FROM generate_series(1, 50) i;
+ABORT;
+
+SET gp_enable_ao_count_from_metadata = on;
+SELECT count(*) FROM ao_count_meta;
+SELECT count(*) FROM aocs_count_meta;
+
+-- scans with quals still read the rows
+SELECT count(*) FROM ao_count_meta WHERE a > 500;
+SELECT count(*) FROM aocs_count_meta WHERE b = 'xx';
+
+-- changes of the current transaction are counted
+BEGIN;
+INSERT INTO aocs_count_meta SELECT i, 'z' FROM generate_series(1001, 1100) i;
+DELETE FROM aocs_count_meta WHERE a > 1050;
+SELECT count(*) FROM aocs_count_meta;
+COMMIT;
+
+-- Only scans that look at no column count from the metadata, with either
+-- planner. An error fault where a segment file gets counted shows which
+-- scans do.
+CREATE EXTENSION IF NOT EXISTS gp_inject_fault;
+SELECT gp_inject_fault('ao_count_from_metadata', 'error', '', '', 'ao_count_meta', 1, -1, 0, dbid)
+  FROM gp_segment_configuration WHERE role = 'p' AND content = 0;
+SELECT gp_inject_fault('ao_count_from_metadata', 'error', '', '', 'aocs_count_meta', 1, -1, 0, dbid)
+  FROM gp_segment_configuration WHERE role = 'p' AND content = 0;
+SELECT count(*) FROM ao_count_meta;
+SELECT count(*) FROM aocs_count_meta;
+SELECT count(*) FROM aocs_count_meta WHERE a > 500;
+SELECT count(a) FROM ao_count_meta;
+SELECT count(b) FROM aocs_count_meta;
+SELECT gp_inject_fault('ao_count_from_metadata', 'reset', dbid)
+  FROM gp_segment_configuration WHERE role = 'p' AND content = 0;
+
+-- same results as a regular scan
+RESET gp_enable_ao_count_from_metadata;
+SELECT count(*) FROM ao_count_meta;
+SELECT count(*) FROM aocs_count_meta;
+
+DROP TABLE ao_count_meta, aocs_count_meta;
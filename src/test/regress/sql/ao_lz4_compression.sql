@@ -0,0 +1,29 @@
+--
+-- lz4 compression for append-optimized tables.
+--
+-- skip test if the server was built without lz4 support
+SELECT setting !~ '--with-lz4' AS skip_test
+  FROM pg_config WHERE name = 'CONFIGURE' \gset
+\if :skip_test
+\quit
+\endif
+
+CREATE TABLE lz4_ao_row (a int, b text)
+  WITH (appendonly=true, compresstype=lz4, compresslevel=1) DISTRIBUTED BY (a);
+CREATE TABLE lz4_aoco (a int, b text)
+  WITH (appendonly=true, orientation=column, compresstype=lz4, compresslevel=9) DISTRIBUTED BY (a);
+
+INSERT INTO lz4_ao_row SELECT i, repeat('lz4 row ', 20) || i FROM generate_series(1, 10000) i;
+INSERT INTO lz4_aoco SELECT i, repeat('lz4 column ', 20) || i FROM generate_series(1, 10000) i;
+
+SELECT count(*), sum(length(b)) FROM lz4_ao_row;
+SELECT count(*), sum(length(b)) FROM lz4_aoco;
+SELECT get_ao_compression_ratio('lz4_ao_row') > 1 AS compressed;
+SELECT get_ao_compression_ratio('lz4_aoco') > 1 AS compressed;
+
+-- Levels above 12 are rejected
+CREATE TABLE lz4_bad_level (a int)
+  WITH (appendonly=true, compresstype=lz4, compresslevel=13) DISTRIBUTED BY (a);
+
+DROP TABLE lz4_ao_row;
+DROP TABLE lz4_aoco;
@@ -0,0 +1,22 @@
+-- Scans of append-only tables reading the segment files through a memory
+-- mapping (gp_appendonly_mmap_read).
+CREATE TABLE ao_mmap_read (a int, b text) WITH (appendonly=true) DISTRIBUTED BY (a);
+CREATE TABLE aocs_mmap_read (a int, b text) WITH (appendonly=true, orientation=column, compresstype=zlib) DISTRIBUTED BY (a);
+INSERT INTO ao_mmap_read SELECT i, repeat('x', i % 100) FROM generate_series(1, 10000) i;
+INSERT INTO aocs_mmap_read SELECT * FROM ao_mmap_read;
+
+SET gp_appendonly_mmap_read = on;
+SELECT count(*), sum(length(b)) FROM ao_mmap_read;
+SELECT count(*), sum(length(b)) FROM aocs_mmap_read;
+
+-- index scans read the blocks at random offsets
+CREATE INDEX aocs_mmap_read_a ON aocs_mmap_read (a);
+SET enable_seqscan = off;
+SELECT a, length(b) FROM aocs_mmap_read WHERE a IN (1, 5000, 9999) ORDER BY a;
+RESET enable_seqscan;
+
+-- same results as regular reads
+RESET gp_appendonly_mmap_read;
+SELECT count(*), sum(length(b)) FROM aocs_mmap_read;
+
+DROP TABLE ao_mmap_read, aocs_mmap_read;
@@ -0,0 +1,44 @@
+--
+-- gp_aocs_recommend_encoding() trial-compresses sampled column data.  Timings
+-- and the set of available compresstypes depend on the build, so only check
+-- properties that hold everywhere.
+--
+CREATE TABLE codec_advisor (id int, padded text, flag bool)
+WITH (appendonly=true, orientation=column) DISTRIBUTED BY (id);
+INSERT INTO codec_advisor
+SELECT i, repeat('abcdefgh', 32), i % 2 = 0 FROM generate_series(1, 5000) i;
+
+-- exactly one recommendation per column
+SELECT attname, count(*) FILTER (WHERE recommended) AS recommended
+FROM gp_aocs_recommend_encoding('codec_advisor', 5000)
+GROUP BY attname ORDER BY attname;
+
+-- the uncompressed baseline is always reported, and is the current encoding
+SELECT attname, compresslevel, compression_ratio, is_current
+FROM gp_aocs_recommend_encoding('codec_advisor', 5000)
+WHERE compresstype = 'none' ORDER BY attname;
+
+-- highly repetitive data gets a compressing recommendation
+SELECT compresstype <> 'none' AS compressed, compression_ratio > 2 AS worthwhile
+FROM gp_aocs_recommend_encoding('codec_advisor', 5000)
+WHERE attname = 'padded' AND recommended;
+
+-- the current encoding of a compressed column is flagged
+ALTER TABLE codec_advisor ADD COLUMN z int DEFAULT 0 ENCODING (compresstype=zlib, compresslevel=5);
+SELECT compresstype, compresslevel FROM gp_aocs_recommend_encoding('codec_advisor', 100)
+WHERE attname = 'z' AND is_current;
+
+-- dropped columns are skipped and don't shift the columns sampled after them
+ALTER TABLE codec_advisor DROP COLUMN padded;
+ALTER TABLE codec_advisor ADD COLUMN padded2 text DEFAULT repeat('abcdefgh', 32);
+SELECT attname, compresstype <> 'none' AS compressed, compression_ratio > 2 AS worthwhile
+FROM gp_aocs_recommend_encoding('codec_advisor', 5000)
+WHERE attname IN ('padded', 'padded2') AND recommended;
+
+-- only AOCS tables are accepted
+CREATE TABLE codec_advisor_heap (id int) DISTRIBUTED BY (id);
+SELECT * FROM gp_aocs_recommend_encoding('codec_advisor_heap', 100);
+SELECT * FROM gp_aocs_recommend_encoding('codec_advisor', 0);
+
+DROP TABLE codec_advisor;
+DROP TABLE codec_advisor_heap;
@@ -0,0 +1,44 @@
+-- Inserts into many column-oriented partitions with the insert descriptors
+-- capped by gp_appendonly_insert_mem_limit. Evicted descriptors are only
+-- suspended: they keep their segment files, and pg_aocsseg is updated once
+-- at the end of the statement, so the modcount of each segment file goes up
+-- by one per statement however often the descriptors were evicted.
+CREATE TABLE aocs_insert_mem_limit (a int, d int, b text)
+  WITH (appendonly=true, orientation=column, compresstype=zlib)
+  DISTRIBUTED BY (a)
+  PARTITION BY RANGE (d) (START (0) END (3) EVERY (1));
+CREATE UNIQUE INDEX aocs_insert_mem_limit_a_d ON aocs_insert_mem_limit (a, d);
+CREATE VIEW aocs_insert_mem_limit_modcount AS
+  SELECT 1 AS part, segment_id, segno, column_num, modcount FROM gp_toolkit.__gp_aocsseg('aocs_insert_mem_limit_1_prt_1')
+  UNION ALL
+  SELECT 2, segment_id, segno, column_num, modcount FROM gp_toolkit.__gp_aocsseg('aocs_insert_mem_limit_1_prt_2')
+  UNION ALL
+  SELECT 3, segment_id, segno, column_num, modcount FROM gp_toolkit.__gp_aocsseg('aocs_insert_mem_limit_1_prt_3');
+
+-- The limit only fits one partition at a time. With the rows in partition
+-- order, every partition is suspended once, when the rows move on to the next.
+SET gp_appendonly_insert_mem_limit = '1kB';
+INSERT INTO aocs_insert_mem_limit SELECT i, (i - 1) / 400, repeat('x', i % 50) FROM generate_series(1, 1200) i;
+SELECT part, min(modcount), max(modcount) FROM aocs_insert_mem_limit_modcount GROUP BY part ORDER BY part;
+
+-- With the rows alternating between the partitions, the descriptors are
+-- suspended and resumed over and over, appending to the same segment files.
+INSERT INTO aocs_insert_mem_limit SELECT i, i % 3, repeat('y', i % 50) FROM generate_series(1201, 2400) i;
+SELECT part, bool_and(modcount = 2) AS updated_once FROM aocs_insert_mem_limit_modcount GROUP BY part ORDER BY part;
+
+-- Without a limit, each partition is closed once at the end of the statement.
+RESET gp_appendonly_insert_mem_limit;
+CREATE TEMP TABLE aocs_insert_mem_limit_before AS SELECT * FROM aocs_insert_mem_limit_modcount DISTRIBUTED RANDOMLY;
+INSERT INTO aocs_insert_mem_limit SELECT i, i % 3, repeat('z', i % 50) FROM generate_series(2401, 3600) i;
+SELECT part, bool_and(m.modcount = b.modcount + 1) AS closed_once
+  FROM aocs_insert_mem_limit_before b JOIN aocs_insert_mem_limit_modcount m USING (part, segment_id, segno, column_num)
+  GROUP BY part ORDER BY part;
+
+SELECT d, count(*), sum(length(b)) FROM aocs_insert_mem_limit GROUP BY d ORDER BY d;
+
+SET enable_seqscan = off;
+SELECT a, d, b FROM aocs_insert_mem_limit WHERE a IN (7, 1503) ORDER BY a;
+RESET enable_seqscan;
+
+DROP VIEW aocs_insert_mem_limit_modcount;
+DROP TABLE aocs_insert_mem_limit;
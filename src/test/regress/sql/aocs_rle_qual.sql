@@ -0,0 +1,31 @@
+-- Quals pushed down to scans of column-oriented tables
+-- (gp_enable_predicate_pushdown) are evaluated once per run of an RLE_TYPE
+-- compressed column. Each INSERT ends its blocks, so the runs of r that
+-- straddle the two INSERTs cross a block boundary. n has runs of NULLs
+-- between its runs of values, and m has no runs at all.
+CREATE TABLE aocs_rle_qual (id int, r int, n int, m int)
+  WITH (appendonly=true, orientation=column, compresstype=rle_type) DISTRIBUTED BY (id);
+INSERT INTO aocs_rle_qual
+  SELECT i, i / 20000, CASE WHEN (i / 7000) % 2 = 1 THEN NULL ELSE i / 7000 END, i % 3
+  FROM generate_series(1, 30000) i;
+INSERT INTO aocs_rle_qual
+  SELECT i, i / 20000, CASE WHEN (i / 7000) % 2 = 1 THEN NULL ELSE i / 7000 END, i % 3
+  FROM generate_series(30001, 60000) i;
+
+SET gp_enable_predicate_pushdown = on;
+SELECT count(*) FROM aocs_rle_qual WHERE r = 1;
+SELECT count(*) FROM aocs_rle_qual WHERE n IS NULL;
+SELECT count(*) FROM aocs_rle_qual WHERE n > 2;
+-- quals that are true for some runs and false for others, and a qual on a
+-- column without runs
+SELECT count(*) FROM aocs_rle_qual WHERE r = 1 AND n IS NULL AND m = 0;
+SELECT r, count(*), count(n), sum(m) FROM aocs_rle_qual
+  WHERE r <> 1 AND n IN (2, 8) GROUP BY r ORDER BY r;
+
+-- same results without the pushdown
+RESET gp_enable_predicate_pushdown;
+SELECT count(*) FROM aocs_rle_qual WHERE r = 1 AND n IS NULL AND m = 0;
+SELECT r, count(*), count(n), sum(m) FROM aocs_rle_qual
+  WHERE r <> 1 AND n IN (2, 8) GROUP BY r ORDER BY r;
+
+DROP TABLE aocs_rle_qual;
@@ -0,0 +1,42 @@
+--
+-- approx_count_distinct() estimates COUNT(DISTINCT) with a hyperloglog
+-- counter per segment, merged on the coordinator.
+--
+CREATE TABLE acd_test (id int, visitor text, grp int) DISTRIBUTED BY (id);
+INSERT INTO acd_test
+SELECT i, 'visitor' || (i % 5000), i % 3 FROM generate_series(1, 30000) i;
+ANALYZE acd_test;
+
+-- low cardinalities are counted exactly
+SELECT approx_count_distinct(x) FROM (VALUES (1), (2), (2), (NULL)) v(x);
+SELECT approx_count_distinct(grp) FROM acd_test;
+
+-- empty and all-NULL input count as zero, like count(DISTINCT)
+SELECT approx_count_distinct(id) FROM acd_test WHERE false;
+SELECT approx_count_distinct(NULL::text) FROM acd_test;
+
+-- every visitor appears on every segment; the partial counters must be
+-- merged rather than added up
+SELECT approx_count_distinct(visitor) BETWEEN 4800 AND 5200 AS close FROM acd_test;
+SELECT grp, approx_count_distinct(visitor) BETWEEN 4800 AND 5200 AS close
+FROM acd_test GROUP BY grp ORDER BY grp;
+SELECT approx_count_distinct(id) BETWEEN 29000 AND 31000 AS close FROM acd_test;
+
+-- grouping on a column other than the distribution key
+SET enable_hashagg = off;
+SELECT grp, approx_count_distinct(id) BETWEEN 9600 AND 10400 AS close
+FROM acd_test GROUP BY grp ORDER BY grp;
+RESET enable_hashagg;
+
+-- the grouped counts are aggregated in two stages: Partial on the rows of
+-- each segment, serialized through the motion, and Finalize after the
+-- counters of each group are combined
+SET optimizer = off;
+EXPLAIN (costs off)
+SELECT grp, approx_count_distinct(visitor) BETWEEN 4800 AND 5200 AS close
+FROM acd_test GROUP BY grp ORDER BY grp;
+SELECT grp, approx_count_distinct(visitor) BETWEEN 4800 AND 5200 AS close
+FROM acd_test GROUP BY grp ORDER BY grp;
+RESET optimizer;
+
+DROP TABLE acd_test;
@@ -0,0 +1,50 @@
+-- Cardinality feedback (optimizer_cardinality_feedback): GPORCA corrects
+-- its estimate of a filter with the rows that earlier executions of a
+-- filter with the same operators on the same columns produced.  The
+-- planner doesn't use the feedback.
+CREATE TABLE cardfeedback (a int, b int) DISTRIBUTED BY (a);
+INSERT INTO cardfeedback SELECT i, i FROM generate_series(1, 10000) i;
+ANALYZE cardfeedback;
+
+-- estimated rows of the scan of cardfeedback, for all segments
+CREATE FUNCTION cardfeedback_scan_rows(query text) RETURNS int AS $$
+DECLARE
+	line text;
+	nsegs int;
+BEGIN
+	SELECT count(*) INTO nsegs FROM gp_segment_configuration WHERE role = 'p' AND content >= 0;
+	FOR line IN EXECUTE 'EXPLAIN ' || query LOOP
+		IF line ~ 'Scan on cardfeedback' THEN
+			RETURN substring(line from 'rows=(\d+)')::int * nsegs;
+		END IF;
+	END LOOP;
+	RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+SET optimizer_cardinality_feedback = on;
+
+-- a and b are correlated, the estimate assumes they are not
+SELECT cardfeedback_scan_rows('SELECT count(*) FROM cardfeedback WHERE a <= 1000 AND b <= 1000') < 500 AS underestimated;
+SELECT count(*) FROM cardfeedback WHERE a <= 1000 AND b <= 1000;
+
+-- the same filter is now estimated right
+SELECT cardfeedback_scan_rows('SELECT count(*) FROM cardfeedback WHERE a <= 1000 AND b <= 1000') BETWEEN 900 AND 1100 AS corrected;
+-- whatever its constants
+SELECT cardfeedback_scan_rows('SELECT count(*) FROM cardfeedback WHERE a <= 2000 AND b <= 2000') > 1500 AS corrected;
+-- a filter with other operators is not corrected
+SELECT cardfeedback_scan_rows('SELECT count(*) FROM cardfeedback WHERE a >= 9001 AND b >= 9001') < 500 AS underestimated;
+
+-- ANALYZE drops the corrections of the table
+ANALYZE cardfeedback;
+SELECT cardfeedback_scan_rows('SELECT count(*) FROM cardfeedback WHERE a <= 1000 AND b <= 1000') < 500 AS underestimated;
+
+-- nothing is learned with the feedback off
+SET optimizer_cardinality_feedback = off;
+SELECT count(*) FROM cardfeedback WHERE a <= 1000 AND b <= 1000;
+SET optimizer_cardinality_feedback = on;
+SELECT cardfeedback_scan_rows('SELECT count(*) FROM cardfeedback WHERE a <= 1000 AND b <= 1000') < 500 AS underestimated;
+
+RESET optimizer_cardinality_feedback;
+DROP FUNCTION cardfeedback_scan_rows(text);
+DROP TABLE cardfeedback;
@@ -436,6 +436,22 @@ insert into t_hash_partition_1_prt_region1 values(1,'CHINA');
 abort;
 
 
+-- single-segment read-only statements can use a local snapshot
+set test_print_direct_dispatch_info=off;
+create table direct_dispatch_local_snap (a int, b int) distributed by (a);
+insert into direct_dispatch_local_snap select i, i from generate_series(1, 10) i;
+set gp_enable_direct_dispatch_local_snapshot=on;
+select * from direct_dispatch_local_snap where a = 1;
+-- an open transaction must still see its own writes
+begin;
+update direct_dispatch_local_snap set b = 100 where a = 1;
+select * from direct_dispatch_local_snap where a = 1;
+abort;
+select * from direct_dispatch_local_snap where a = 1;
+reset gp_enable_direct_dispatch_local_snapshot;
+drop table direct_dispatch_local_snap;
+set test_print_direct_dispatch_info=on;
+
 -- cleanup
 set test_print_direct_dispatch_info=off;
 set allow_system_table_mods=off;
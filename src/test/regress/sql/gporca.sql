@@ -3435,6 +3435,68 @@ DROP TABLE IF EXISTS dist_tab_a;
 DROP TABLE IF EXISTS dist_tab_b;
 DROP TABLE IF EXISTS result_tab;
 
+-- ORCA charges sequential scans of column-oriented tables by the width of
+-- the columns they read (optimizer_enable_column_projection_cost). Make the
+-- table look big and wide, so that a scan of two narrow columns beats the
+-- bitmap scan only when the projected width is used.
+CREATE TABLE aocs_projection_cost (a int, b int, pad text)
+  WITH (appendonly=true, orientation=column) DISTRIBUTED BY (a);
+INSERT INTO aocs_projection_cost SELECT i, i, 'x' FROM generate_series(1, 1000) i;
+CREATE INDEX aocs_projection_cost_a ON aocs_projection_cost (a);
+CREATE INDEX aocs_projection_cost_b ON aocs_projection_cost (b);
+ANALYZE aocs_projection_cost;
+SET allow_system_table_mods = true;
+UPDATE pg_class SET reltuples = 1e7 WHERE oid = 'aocs_projection_cost'::regclass;
+UPDATE pg_statistic SET stawidth = 2000 WHERE starelid = 'aocs_projection_cost'::regclass AND staattnum = 3;
+RESET allow_system_table_mods;
+CREATE FUNCTION aocs_projection_cost_scan(query text) RETURNS text AS $$
+DECLARE
+	line text;
+BEGIN
+	FOR line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+		IF line ~ 'Bitmap Heap Scan' THEN
+			RETURN 'bitmap';
+		ELSIF line ~ 'Seq Scan' THEN
+			RETURN 'seq';
+		END IF;
+	END LOOP;
+	RETURN 'other';
+END;
+$$ LANGUAGE plpgsql;
+
+SET optimizer_enable_column_projection_cost = off;
+SELECT aocs_projection_cost_scan('SELECT a, b FROM aocs_projection_cost WHERE a < 340 OR b < 340') AS scan_off \gset
+SELECT count(*) FROM aocs_projection_cost WHERE a < 340 OR b < 340;
+RESET optimizer_enable_column_projection_cost;
+SELECT aocs_projection_cost_scan('SELECT a, b FROM aocs_projection_cost WHERE a < 340 OR b < 340') <> :'scan_off' AS plan_changed;
+SELECT count(*) FROM aocs_projection_cost WHERE a < 340 OR b < 340;
+DROP FUNCTION aocs_projection_cost_scan(text);
+DROP TABLE aocs_projection_cost;
+
+-- ORCA has no partition-wise join or aggregate. When they are enabled, a
+-- join of co-partitioned tables on their partition keys, or a grouping by
+-- the partition key, is left to the planner, with the same results.
+CREATE TABLE pwj_t1 (a int, b int) DISTRIBUTED BY (a) PARTITION BY RANGE (a) (START (0) END (30) EVERY (10));
+CREATE TABLE pwj_t2 (a int, b int) DISTRIBUTED BY (a) PARTITION BY RANGE (a) (START (0) END (30) EVERY (10));
+INSERT INTO pwj_t1 SELECT i, i % 7 FROM generate_series(0, 29) i;
+INSERT INTO pwj_t2 SELECT * FROM pwj_t1;
+ANALYZE pwj_t1;
+ANALYZE pwj_t2;
+SET optimizer_trace_fallback = on;
+SELECT count(*), sum(t1.b + t2.b) FROM pwj_t1 t1 JOIN pwj_t2 t2 ON t1.a = t2.a;
+SELECT a, sum(b) FROM pwj_t1 GROUP BY a HAVING a < 3 ORDER BY a;
+SET enable_partitionwise_join = on;
+SET enable_partitionwise_aggregate = on;
+SELECT count(*), sum(t1.b + t2.b) FROM pwj_t1 t1 JOIN pwj_t2 t2 ON t1.a = t2.a;
+SELECT a, sum(b) FROM pwj_t1 GROUP BY a HAVING a < 3 ORDER BY a;
+-- not on the partition keys: still planned by ORCA
+SELECT count(*) FROM pwj_t1 t1 JOIN pwj_t2 t2 ON t1.b = t2.b;
+SELECT b, count(*) FROM pwj_t1 GROUP BY b HAVING b < 2 ORDER BY b;
+RESET enable_partitionwise_join;
+RESET enable_partitionwise_aggregate;
+RESET optimizer_trace_fallback;
+DROP TABLE pwj_t1, pwj_t2;
+
 -- start_ignore
 DROP SCHEMA orca CASCADE;
 -- end_ignore
@@ -290,3 +290,18 @@ explain (costs off) insert into t2_dist_rand select * from t_dist_hash;
 
 reset gp_force_random_redistribution;
 reset optimizer;
+
+-- optimizer_cost_param_factors is a list of name=factor items, where the
+-- factors are positive, finite numbers
+SET optimizer_cost_param_factors = 'BroadcastSendCostUnit=1.8, SortTupWidthCostUnit=0.7';
+SHOW optimizer_cost_param_factors;
+SET optimizer_cost_param_factors = ' SortTupWidthCostUnit = 2 ,';
+SET optimizer_cost_param_factors = 'BroadcastSendCostUnit';
+SET optimizer_cost_param_factors = 'SortTupWidthCostUnit=1.5x';
+SET optimizer_cost_param_factors = 'NoSuchCostUnit=2';
+SET optimizer_cost_param_factors = 'SortTupWidthCostUnit=0';
+SET optimizer_cost_param_factors = 'SortTupWidthCostUnit=-1';
+SET optimizer_cost_param_factors = 'SortTupWidthCostUnit=inf';
+SET optimizer_cost_param_factors = 'SortTupWidthCostUnit=nan';
+SHOW optimizer_cost_param_factors;
+RESET optimizer_cost_param_factors;
@@ -0,0 +1,44 @@
+--
+-- TCP interconnect connections kept open across statements
+--
+-- gp_interconnect_type can only be set at connection start.
+\c "dbname=regression options='-c gp_interconnect_type=tcp'"
+show gp_interconnect_type;
+set gp_interconnect_tcp_keep_connections = 8;
+
+create table ic_keep_conn (a int, b int) distributed by (a);
+insert into ic_keep_conn select i, i from generate_series(1, 1000) i;
+analyze ic_keep_conn;
+
+-- The join redistributes one side, so every statement sets up streams
+-- between the segments as well as to the coordinator. The later statements
+-- run on the connections kept by the earlier ones.
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b where t1.a % 2 = 0;
+
+-- A LIMIT stops the streams before their end, which closes them.
+select t1.a from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b order by 1 limit 3;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+
+-- An error on one segment tears the streams down on every side, and the
+-- next statement doesn't pick up what was left of them.
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b where 1 / (t2.a - 500) > -1;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+
+-- The same for a cancel while the streams are open.
+set statement_timeout = '500ms';
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b, pg_sleep(5) s;
+reset statement_timeout;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+
+-- Fewer kept connections than streams, and none at all.
+set gp_interconnect_tcp_keep_connections = 1;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+reset gp_interconnect_tcp_keep_connections;
+select count(*) from ic_keep_conn t1 join ic_keep_conn t2 on t1.a = t2.b;
+
+drop table ic_keep_conn;
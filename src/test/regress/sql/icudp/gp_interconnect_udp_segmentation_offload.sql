@@ -0,0 +1,27 @@
+--
+-- @description Interconnect test case: UDP segmentation offload
+-- @tags executor
+--
+-- The GUC can only be set at connection start.
+\c -reuse-previous=on "options='-c gp_interconnect_udp_segmentation_offload=on'"
+SHOW gp_interconnect_udp_segmentation_offload;
+
+-- Create a table
+CREATE TEMP TABLE small_table(dkey INT, jkey INT, rval REAL, tval TEXT default 'abcdefghijklmnopqrstuvwxyz') DISTRIBUTED BY (dkey);
+
+-- Generate some data
+INSERT INTO small_table VALUES(generate_series(1, 5000), generate_series(5001, 10000), sqrt(generate_series(5001, 10000)));
+
+-- Full packets in a row, sent in batches and maybe received coalesced
+SELECT COUNT(*), SUM(length(tval)) FROM (SELECT tval FROM small_table ORDER BY dkey) foo;
+
+-- Skew with gather+redistribute
+SELECT ROUND(foo.rval * foo.rval)::INT % 30 AS rval2, COUNT(*) AS count, SUM(length(foo.tval)) AS sum_len_tval
+  FROM (SELECT 5001 AS jkey, rval, tval FROM small_table ORDER BY dkey LIMIT 3000) foo
+    JOIN small_table USING(jkey)
+  GROUP BY rval2
+  ORDER BY rval2;
+
+-- A queue depth of one leaves a single packet to each batch
+SET gp_interconnect_queue_depth = 1;
+SELECT COUNT(*), SUM(length(tval)) FROM (SELECT tval FROM small_table ORDER BY dkey) foo;